@@ -0,0 +1,12 @@
+// Latest trend statistics reported with the device status heartbeat
+exports.up = function(knex) {
+  return knex.schema.alterTable('devices', function(table) {
+    table.jsonb('trend');
+  });
+};
+
+exports.down = function(knex) {
+  return knex.schema.alterTable('devices', function(table) {
+    table.dropColumn('trend');
+  });
+};
@@ -0,0 +1,15 @@
+// Device-assigned reading sequence numbers; (deviceId, seq) identifies a
+// reading, so repeats are rejected by the index
+exports.up = function(knex) {
+  return knex.schema.alterTable('temperature_readings', function(table) {
+    table.bigInteger('seq');
+    table.unique(['deviceId', 'seq']);
+  });
+};
+
+exports.down = function(knex) {
+  return knex.schema.alterTable('temperature_readings', function(table) {
+    table.dropUnique(['deviceId', 'seq']);
+    table.dropColumn('seq');
+  });
+};
@@ -0,0 +1,12 @@
+// Sensor health scores reported with the device status heartbeat
+exports.up = function(knex) {
+  return knex.schema.alterTable('devices', function(table) {
+    table.jsonb('sensorHealth');
+  });
+};
+
+exports.down = function(knex) {
+  return knex.schema.alterTable('devices', function(table) {
+    table.dropColumn('sensorHealth');
+  });
+};
@@ -0,0 +1,18 @@
+// A device restarts its reading sequence under a new epoch when it loses
+// its stored sequence bound, so (deviceId, seqEpoch, seq) identifies a
+// reading. Readings stored before epochs are in epoch 0.
+exports.up = function(knex) {
+  return knex.schema.alterTable('temperature_readings', function(table) {
+    table.bigInteger('seqEpoch').notNullable().defaultTo(0);
+    table.dropUnique(['deviceId', 'seq']);
+    table.unique(['deviceId', 'seqEpoch', 'seq']);
+  });
+};
+
+exports.down = function(knex) {
+  return knex.schema.alterTable('temperature_readings', function(table) {
+    table.dropUnique(['deviceId', 'seqEpoch', 'seq']);
+    table.unique(['deviceId', 'seq']);
+    table.dropColumn('seqEpoch');
+  });
+};
@@ -45,9 +45,15 @@ const config = {
     username: process.env.MQTT_USERNAME,
     password: process.env.MQTT_PASSWORD,
     clientId: process.env.MQTT_CLIENT_ID || 'botcareu-backend',
+    // Must match the firmware's DEVICE_ENCRYPTION_KEY when ENCRYPTION_ENABLED is set there
+    payloadKey: process.env.DEVICE_ENCRYPTION_KEY,
     topics: {
       temperatureReading: 'botcareu/device/+/temperature/reading',
+      temperatureReadingBinary: 'botcareu/device/+/temperature/reading/bin',
+      temperatureReplay: 'botcareu/device/+/temperature/replay',
+      temperatureBatch: 'botcareu/device/+/temperature/batch',
       deviceStatus: 'botcareu/device/+/status',
+      deviceStatusBinary: 'botcareu/device/+/status/bin',
       deviceConfig: 'botcareu/device/+/config',
       deviceAlerts: 'botcareu/device/+/alerts'
     }
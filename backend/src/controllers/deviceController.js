@@ -1,5 +1,6 @@
 const Device = require('../models/Device');
 const User = require('../models/User');
+const mqttService = require('../services/mqttService');
 const logger = require('../utils/logger');
 const { validationResult } = require('express-validator');
 const { v4: uuidv4 } = require('uuid');
@@ -307,6 +308,62 @@ class DeviceController {
     }
   }
 
+  // Ask a device to pull and install a signed firmware image (admin only).
+  // The device reports progress as ota_* alerts.
+  async updateFirmware(req, res, next) {
+    try {
+      const errors = validationResult(req);
+      if (!errors.isEmpty()) {
+        return res.status(400).json({
+          success: false,
+          error: {
+            code: 'VALIDATION_ERROR',
+            message: 'Invalid input data',
+            details: errors.array()
+          }
+        });
+      }
+
+      const { deviceId } = req.params;
+      const { url, version, signature, compressed = false } = req.body;
+
+      const device = await Device.query()
+        .findById(deviceId)
+        .where('isActive', true);
+
+      if (!device) {
+        return res.status(404).json({
+          success: false,
+          error: {
+            code: 'DEVICE_NOT_FOUND',
+            message: 'Device not found'
+          }
+        });
+      }
+
+      await mqttService.sendDeviceCommand(device.deviceId, 'ota_update', {
+        url,
+        version,
+        signature,
+        compressed
+      });
+
+      logger.info(`Firmware ${version} requested for device ${device.deviceId} by ${req.user.email}`);
+
+      res.status(202).json({
+        success: true,
+        data: {
+          deviceId: device.deviceId,
+          currentVersion: device.firmwareVersion,
+          requestedVersion: version
+        }
+      });
+    } catch (error) {
+      logger.error('Update firmware error:', error);
+      next(error);
+    }
+  }
+
   // Generate pairing code for device (admin only)
   async generatePairingCode(req, res, next) {
     try {
@@ -54,6 +54,29 @@ class Device extends Model {
             lastCalibrated: { type: 'string', format: 'date-time' }
           }
         },
+        // Device-side running statistics from the last status heartbeat
+        trend: {
+          type: ['object', 'null'],
+          properties: {
+            ewma: { type: 'number' },
+            min: { type: 'number' },
+            max: { type: 'number' },
+            slope: { type: 'number' },
+            feverTime: { type: 'integer', minimum: 0 },
+            samples: { type: 'integer', minimum: 0 },
+            onset: { type: 'boolean' },
+            reportedAt: { type: 'string', format: 'date-time' }
+          }
+        },
+        // Per-sensor health in percent behind the device's fused readings
+        sensorHealth: {
+          type: ['object', 'null'],
+          properties: {
+            infrared: { type: 'integer', minimum: 0, maximum: 100 },
+            contact: { type: 'integer', minimum: 0, maximum: 100 },
+            reportedAt: { type: 'string', format: 'date-time' }
+          }
+        },
         isActive: { type: 'boolean', default: true },
         createdAt: { type: 'string', format: 'date-time' },
         updatedAt: { type: 'string', format: 'date-time' }
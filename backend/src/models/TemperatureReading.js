@@ -17,9 +17,12 @@ class TemperatureReading extends Model {
         id: { type: 'string', format: 'uuid' },
         deviceId: { type: 'string', format: 'uuid' },
         userId: { type: 'string', format: 'uuid' },
-        infraredTemp: { type: 'number', minimum: 20, maximum: 50 },
-        contactTemp: { type: 'number', minimum: 20, maximum: 50 },
-        ambientTemp: { type: 'number', minimum: -10, maximum: 60 },
+        seq: { type: ['integer', 'null'], minimum: 1 },
+        seqEpoch: { type: 'integer', minimum: 0, maximum: 4294967295, default: 0 },
+        // Raw sensor values are null when the sensor failed or is absent
+        infraredTemp: { type: ['number', 'null'], minimum: 20, maximum: 50 },
+        contactTemp: { type: ['number', 'null'], minimum: 20, maximum: 50 },
+        ambientTemp: { type: ['number', 'null'], minimum: -10, maximum: 60 },
         temperature: { type: 'number', minimum: 20, maximum: 50 },
         measurementType: { 
           type: 'string', 
@@ -57,7 +60,17 @@ class TemperatureReading extends Model {
             firmwareVersion: { type: 'string' },
             calibrationOffset: { type: 'number' },
             measurementDuration: { type: 'number' },
-            retryCount: { type: 'number', default: 0 }
+            retryCount: { type: 'number', default: 0 },
+            infraredVariance: { type: ['number', 'null'] },
+            // Every DS18B20 probe on the device, in bus address order
+            probes: {
+              type: 'array',
+              items: { type: ['number', 'null'] },
+              maxItems: 3
+            },
+            sequence: { type: 'integer', minimum: 1 },
+            replayed: { type: 'boolean', default: false },
+            clockSynced: { type: 'boolean', default: true }
           }
         },
         timestamp: { type: 'string', format: 'date-time' },
@@ -116,8 +129,11 @@ class TemperatureReading extends Model {
     this.detectFever();
   }
 
-  // Determine the primary temperature reading
+  // Determine the primary temperature reading, unless the device already
+  // fused one
   determinePrimaryTemperature() {
+    if (this.temperature !== undefined && this.temperature !== null) return;
+
     if (this.measurementType === 'combined') {
       // Use contact temperature if available, otherwise infrared
       this.temperature = this.contactTemp || this.infraredTemp;
@@ -193,6 +209,23 @@ class TemperatureReading extends Model {
     return this.query().insert(readingData);
   }
 
+  // A reading with a device sequence number is stored once per
+  // (deviceId, seqEpoch, seq): a repeat, such as a replay whose
+  // acknowledgement was lost, is dropped by the unique index rather than
+  // looked for first. A device whose numbering restarted does so under a
+  // new epoch, so its readings aren't taken for repeats. Returns null for a
+  // repeat, keeping the stored copy.
+  static async upsertReading(readingData) {
+    if (!readingData.seq) {
+      return this.createReading(readingData);
+    }
+    const reading = await this.query()
+      .insert(readingData)
+      .onConflict(['deviceId', 'seqEpoch', 'seq'])
+      .ignore();
+    return reading.id ? reading : null;
+  }
+
   static async getReadingsByDevice(deviceId, limit = 100, offset = 0) {
     return this.query()
       .where('deviceId', deviceId)
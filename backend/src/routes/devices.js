@@ -18,6 +18,13 @@ const updateDeviceValidation = [
   body('location').optional().isObject(),
 ];
 
+const firmwareUpdateValidation = [
+  body('url').isURL({ protocols: ['https'], require_protocol: true }).isLength({ max: 255 }),
+  body('version').trim().isLength({ min: 1, max: 23 }),
+  body('signature').isBase64().isLength({ min: 1, max: 96 }),
+  body('compressed').optional().isBoolean(),
+];
+
 // Routes
 router.get('/', authenticate, deviceController.getDevices);
 router.get('/:deviceId', authenticate, deviceController.getDevice);
@@ -31,5 +38,6 @@ router.put('/:deviceId/status', authenticateDevice, deviceController.updateDevic
 // Admin routes
 router.get('/stats', authenticate, authorize('admin'), deviceController.getDeviceStats);
 router.post('/pairing-code', authenticate, authorize('admin'), deviceController.generatePairingCode);
+router.post('/:deviceId/firmware', authenticate, authorize('admin'), firmwareUpdateValidation, deviceController.updateFirmware);
 
 module.exports = router;
@@ -185,11 +185,23 @@ router.get('/analytics', authenticate, [
     // Get hourly averages
     const hourlyAverages = await TemperatureReading.getHourlyAverages(userId, 7);
 
+    // The device keeps its own running trend, so the current one needs no
+    // window query
+    let currentTrend = null;
+    if (deviceId) {
+      const device = await Device.query()
+        .select('trend')
+        .where({ id: deviceId, userId })
+        .first();
+      currentTrend = device ? device.trend : null;
+    }
+
     res.json({
       success: true,
       data: {
         summary: stats,
         hourlyPattern: hourlyAverages,
+        currentTrend,
         period,
         dateRange: {
           start: startDate.toISOString(),
@@ -5,6 +5,42 @@ const TemperatureReading = require('../models/TemperatureReading');
 const Device = require('../models/Device');
 const notificationService = require('./notificationService');
 const websocketService = require('./websocketService');
+const telemetryCodec = require('../utils/telemetryCodec');
+const payloadCrypto = require('../utils/payloadCrypto');
+
+// Fever alert types published by the firmware's alert state machine
+const DEVICE_FEVER_ALERTS = {
+  fever_detected: 'Fever Detected',
+  fever_escalated: 'Fever Escalated',
+  fever_reminder: 'Fever Ongoing',
+  fever_cleared: 'Fever Cleared'
+};
+
+const DEVICE_OTA_ALERTS = {
+  ota_started: 'Firmware Update Started',
+  ota_installed: 'Firmware Update Installed',
+  ota_failed: 'Firmware Update Failed'
+};
+
+// Commands the firmware can queue from one message (COMMAND_QUEUE_LENGTH)
+const DEVICE_COMMAND_BATCH_MAX = 8;
+
+// How long a device alert ID is remembered for duplicate suppression
+const ALERT_DEDUP_WINDOW = 60 * 60 * 1000;
+
+const FEVER_SEVERITY_PRIORITY = {
+  none: 'low',
+  moderate: 'normal',
+  high: 'high',
+  critical: 'critical'
+};
+
+// A raw sensor value outside what a reading can store, such as the -127 the
+// firmware reports for a missing contact probe, means the sensor failed
+function sensorValue(value, field) {
+  const { minimum, maximum } = TemperatureReading.jsonSchema.properties[field];
+  return typeof value === 'number' && value >= minimum && value <= maximum ? value : null;
+}
 
 class MQTTService {
   constructor() {
@@ -12,6 +48,10 @@ class MQTTService {
     this.isConnected = false;
     this.reconnectAttempts = 0;
     this.maxReconnectAttempts = 10;
+    // Recently handled device alerts, so a repeat whose ack was lost
+    // doesn't notify twice
+    this.recentAlerts = new Map();
+    this.payloadKey = payloadCrypto.payloadKey(config.mqtt.payloadKey);
   }
 
   async initialize() {
@@ -72,7 +112,11 @@ class MQTTService {
   subscribeToTopics() {
     const topics = [
       config.mqtt.topics.temperatureReading,
+      config.mqtt.topics.temperatureReadingBinary,
+      config.mqtt.topics.temperatureReplay,
+      config.mqtt.topics.temperatureBatch,
       config.mqtt.topics.deviceStatus,
+      config.mqtt.topics.deviceStatusBinary,
       config.mqtt.topics.deviceAlerts
     ];
 
@@ -89,7 +133,7 @@ class MQTTService {
 
   async handleMessage(topic, message) {
     try {
-      const data = JSON.parse(message.toString());
+      const data = this.decodePayload(topic, message);
       const deviceId = this.extractDeviceIdFromTopic(topic);
 
       if (!deviceId) {
@@ -104,7 +148,9 @@ class MQTTService {
         return;
       }
 
-      if (topic.includes('/temperature/reading')) {
+      if (topic.endsWith('/temperature/replay') || topic.endsWith('/temperature/batch')) {
+        await this.handleReadingBatch(device, data);
+      } else if (topic.includes('/temperature/reading')) {
         await this.handleTemperatureReading(device, data);
       } else if (topic.includes('/status')) {
         await this.handleDeviceStatus(device, data);
@@ -116,14 +162,40 @@ class MQTTService {
     }
   }
 
+  // Devices in binary telemetry mode publish on a /bin suffix of the JSON topic
+  decodePayload(topic, message) {
+    if (this.payloadKey) {
+      message = payloadCrypto.openPayload(message, topic, this.payloadKey);
+    }
+    if (topic.endsWith('/temperature/reading/bin')) {
+      return telemetryCodec.decodeTemperatureReading(message);
+    }
+    if (topic.endsWith('/temperature/replay')) {
+      return telemetryCodec.decodeReplayBatch(message);
+    }
+    if (topic.endsWith('/temperature/batch')) {
+      return telemetryCodec.decodeReadingBatch(message);
+    }
+    if (topic.endsWith('/status/bin')) {
+      return telemetryCodec.decodeDeviceStatus(message);
+    }
+    return JSON.parse(message.toString());
+  }
+
   async handleTemperatureReading(device, data) {
     try {
       const {
+        temperature,
+        confidence,
         infraredTemp,
         contactTemp,
         ambientTemp,
+        infraredVariance,
         measurementType,
-        timestamp,
+        seq,
+        seqEpoch,
+        clockSynced,
+        probes,
         metadata
       } = data;
 
@@ -131,22 +203,43 @@ class MQTTService {
       const readingData = {
         deviceId: device.id,
         userId: device.userId,
-        infraredTemp,
-        contactTemp,
-        ambientTemp,
+        // Fused on the device by firmware that sends it; raw values only
+        // come along when the device is set to send them
+        temperature,
+        accuracy: confidence,
+        infraredTemp: sensorValue(infraredTemp, 'infraredTemp'),
+        contactTemp: sensorValue(contactTemp, 'contactTemp'),
+        ambientTemp: sensorValue(ambientTemp, 'ambientTemp'),
         measurementType,
-        timestamp: timestamp || new Date().toISOString(),
+        seq: seq || null,
+        seqEpoch: seqEpoch || 0,
+        timestamp: this.readingTimestamp(data),
         metadata: {
           batteryLevel: metadata?.batteryLevel,
           signalStrength: metadata?.signalStrength,
           firmwareVersion: metadata?.firmwareVersion,
           calibrationOffset: metadata?.calibrationOffset || 0,
           measurementDuration: metadata?.measurementDuration,
-          retryCount: metadata?.retryCount || 0
+          retryCount: metadata?.retryCount || 0,
+          infraredVariance,
+          probes,
+          sequence: metadata?.sequence,
+          replayed: metadata?.replayed || false,
+          clockSynced: clockSynced !== false
         }
       };
 
-      const reading = await TemperatureReading.createReading(readingData);
+      // Every sensor failed, so there is nothing to store
+      if (temperature == null && readingData.infraredTemp === null && readingData.contactTemp === null) {
+        logger.info(`Reading ${seq} from device ${device.deviceId} has no usable temperature`);
+        return;
+      }
+
+      const reading = await TemperatureReading.upsertReading(readingData);
+      if (!reading) {
+        logger.debug(`Reading ${seq} from device ${device.deviceId} already stored`);
+        return;
+      }
 
       // Update device last seen
       await device.updateStatus(device.status, {
@@ -155,8 +248,11 @@ class MQTTService {
         signalStrength: metadata?.signalStrength
       });
 
-      // Check for fever and send notifications
-      if (reading.feverDetected) {
+      // Check for fever and send notifications. Firmware that numbers its
+      // readings debounces fever on the device and sends fever_* alerts
+      // instead, and a replayed reading is too old to notify about.
+      const deviceAlertsFever = seq !== undefined || confidence !== undefined;
+      if (reading.feverDetected && !deviceAlertsFever && !readingData.metadata.replayed) {
         await this.handleFeverDetection(device, reading);
       }
 
@@ -176,6 +272,25 @@ class MQTTService {
     }
   }
 
+  // Firmware that reports clockSynced stamps readings in ms since the epoch,
+  // older firmware in seconds. Until its clock syncs a device only knows
+  // the time since it powered up, so the receive time stands in.
+  readingTimestamp(data) {
+    const { timestamp, clockSynced } = data;
+    if (!timestamp || clockSynced === false) {
+      return new Date().toISOString();
+    }
+    return new Date(clockSynced === undefined ? timestamp * 1000 : timestamp).toISOString();
+  }
+
+  // Batched or replayed readings, oldest first
+  async handleReadingBatch(device, readings) {
+    for (const reading of readings) {
+      await this.handleTemperatureReading(device, reading);
+    }
+    logger.info(`Processed batch of ${readings.length} readings from device ${device.deviceId}`);
+  }
+
   async handleDeviceStatus(device, data) {
     try {
       const {
@@ -184,16 +299,27 @@ class MQTTService {
         signalStrength,
         firmwareVersion,
         uptime,
-        freeMemory
+        freeMemory,
+        trend,
+        sensorHealth
       } = data;
 
-      // Update device status
-      await device.updateStatus(status, {
+      // Trend statistics are kept only when the firmware reports them
+      const additionalData = {
         batteryLevel,
         signalStrength,
         firmwareVersion,
         lastSeen: new Date().toISOString()
-      });
+      };
+      if (trend) {
+        additionalData.trend = { ...trend, reportedAt: additionalData.lastSeen };
+      }
+      if (sensorHealth) {
+        additionalData.sensorHealth = { ...sensorHealth, reportedAt: additionalData.lastSeen };
+      }
+
+      // Update device status
+      await device.updateStatus(status, additionalData);
 
       // Check for low battery
       if (batteryLevel && batteryLevel < 20) {
@@ -216,7 +342,9 @@ class MQTTService {
         status,
         batteryLevel,
         signalStrength,
-        lastSeen: new Date().toISOString()
+        trend: additionalData.trend,
+        sensorHealth: additionalData.sensorHealth,
+        lastSeen: additionalData.lastSeen
       });
 
       logger.debug(`Device status updated: ${device.deviceId} - ${status}`);
@@ -227,7 +355,19 @@ class MQTTService {
 
   async handleDeviceAlert(device, data) {
     try {
-      const { alertType, message, severity, timestamp } = data;
+      const { alertType, message, severity, timestamp, alertId } = data;
+
+      // The firmware repeats alerts that carry an ID until they are acked
+      if (alertId !== undefined) {
+        const duplicate = this.rememberAlert(device.deviceId, alertId, timestamp);
+        this.sendDeviceCommand(device.deviceId, 'ack_alert', { alertId }).catch((error) => {
+          logger.warn(`Could not ack alert ${alertId} from device ${device.deviceId}:`, error);
+        });
+        if (duplicate) {
+          logger.debug(`Duplicate alert ${alertId} from device ${device.deviceId} ignored`);
+          return;
+        }
+      }
 
       // Send notification based on alert type
       let notificationData = {
@@ -248,6 +388,33 @@ class MQTTService {
         notificationData.type = 'device_offline';
         notificationData.title = 'Sensor Error';
         notificationData.priority = 'high';
+      } else if (alertType === 'fever_onset') {
+        notificationData.type = 'fever_alert';
+        notificationData.title = 'Rising Temperature';
+        notificationData.message = `Temperature on device "${device.name}" is rising towards fever ` +
+          `(${Number(data.temperature).toFixed(1)}°C, +${Number(data.slope * 60).toFixed(1)}°C/h)`;
+        notificationData.data.temperature = data.temperature;
+        notificationData.data.slope = data.slope;
+      } else if (DEVICE_FEVER_ALERTS[alertType]) {
+        // The device announces each fever episode once, escalations, and
+        // reminders after its suppression window
+        notificationData.type = alertType === 'fever_cleared' ? 'info' : 'fever_alert';
+        notificationData.title = DEVICE_FEVER_ALERTS[alertType];
+        notificationData.priority = FEVER_SEVERITY_PRIORITY[severity] || 'normal';
+        notificationData.message = alertType === 'fever_cleared'
+          ? `Temperature on device "${device.name}" is back below the fever threshold`
+          : `Temperature of ${Number(data.temperature).toFixed(1)}°C (${severity}) on device "${device.name}"`;
+        notificationData.data.temperature = data.temperature;
+        notificationData.data.severity = severity;
+      } else if (DEVICE_OTA_ALERTS[alertType]) {
+        notificationData.type = 'info';
+        notificationData.title = DEVICE_OTA_ALERTS[alertType];
+        notificationData.priority = alertType === 'ota_failed' ? 'high' : 'low';
+        notificationData.message = alertType === 'ota_failed'
+          ? `Device "${device.name}" could not install firmware ${data.version}: ${message}`
+          : `Device "${device.name}": firmware ${data.currentVersion} to ${data.version}`;
+        notificationData.data.version = data.version;
+        notificationData.data.currentVersion = data.currentVersion;
       } else if (alertType === 'calibration_needed') {
         notificationData.title = 'Calibration Required';
         notificationData.message = `Device "${device.name}" requires calibration for accurate readings`;
@@ -261,6 +428,21 @@ class MQTTService {
     }
   }
 
+  // Returns true if this alert was already handled. The timestamp is part
+  // of the key because alert IDs restart when the device reboots.
+  rememberAlert(deviceId, alertId, timestamp) {
+    const now = Date.now();
+    for (const [key, seenAt] of this.recentAlerts) {
+      if (now - seenAt < ALERT_DEDUP_WINDOW) break;
+      this.recentAlerts.delete(key);
+    }
+
+    const key = `${deviceId}:${alertId}:${timestamp}`;
+    if (this.recentAlerts.has(key)) return true;
+    this.recentAlerts.set(key, now);
+    return false;
+  }
+
   async handleFeverDetection(device, reading) {
     try {
       // Create fever alert notification
@@ -338,6 +520,21 @@ class MQTTService {
     return this.publishToDevice(deviceId, 'commands', message);
   }
 
+  // Send several commands in one message, carried out in order. A
+  // "configure" command takes the same keys as the config topic.
+  async sendDeviceCommands(deviceId, commands) {
+    if (commands.length > DEVICE_COMMAND_BATCH_MAX) {
+      throw new Error(`A command batch holds at most ${DEVICE_COMMAND_BATCH_MAX} commands`);
+    }
+
+    const message = {
+      commands: commands.map(({ command, params = {} }) => ({ command, params })),
+      timestamp: new Date().toISOString()
+    };
+
+    return this.publishToDevice(deviceId, 'commands', message);
+  }
+
   async close() {
     if (this.client) {
       this.client.end();
@@ -0,0 +1,41 @@
+// Opens MQTT payloads sealed by the firmware (firmware/src/payload_crypto.h):
+// AES-256-GCM with the topic as associated data, laid out as
+// ciphertext | nonce(12) | tag(16).
+
+const crypto = require('crypto');
+
+const KEY_SIZE = 32;
+const NONCE_SIZE = 12;
+const TAG_SIZE = 16;
+
+function openPayload(buffer, topic, key) {
+  if (buffer.length < NONCE_SIZE + TAG_SIZE) {
+    throw new Error(`Sealed payload too short: ${buffer.length} bytes`);
+  }
+
+  const length = buffer.length - NONCE_SIZE - TAG_SIZE;
+  const nonce = buffer.subarray(length, length + NONCE_SIZE);
+  const tag = buffer.subarray(length + NONCE_SIZE);
+
+  const decipher = crypto.createDecipheriv('aes-256-gcm', key, nonce, { authTagLength: TAG_SIZE });
+  decipher.setAAD(Buffer.from(topic, 'utf8'));
+  decipher.setAuthTag(tag);
+
+  // final() throws if the tag doesn't match
+  return Buffer.concat([decipher.update(buffer.subarray(0, length)), decipher.final()]);
+}
+
+// The firmware uses the 32 characters of DEVICE_ENCRYPTION_KEY as raw key bytes
+function payloadKey(value) {
+  if (!value) return null;
+  const key = Buffer.from(value, 'utf8');
+  if (key.length !== KEY_SIZE) {
+    throw new Error(`DEVICE_ENCRYPTION_KEY must be ${KEY_SIZE} bytes, got ${key.length}`);
+  }
+  return key;
+}
+
+module.exports = {
+  openPayload,
+  payloadKey
+};
@@ -0,0 +1,310 @@
+// Decoder for the compact binary telemetry frames published by the firmware
+// on the .../temperature/reading/bin, .../temperature/replay,
+// .../temperature/batch and .../status/bin topics.
+// Layout mirrors firmware/lib/botcareu_core/src/telemetry_codec.h; all
+// fields are little-endian.
+//
+// Version 2 added reading sequence numbers and millisecond timestamps,
+// version 3 a channel per DS18B20 contact probe, version 4 the fused
+// temperature with its confidence and sensor health in the status, version
+// 5 the epoch the reading's seq belongs to. Older frames are still
+// accepted; version 1 readings have no seq and timestamps in epoch seconds,
+// and readings before version 5 are in seq epoch 0.
+
+const TELEMETRY_BINARY_VERSIONS = [1, 2, 3, 4, 5];
+const TEMP_MISSING = -32768;
+const READING_PROBE_MAX = 3;
+
+const READING_FRAME_SIZE = {
+  1: 17,
+  2: 23,
+  3: 24 + 2 * READING_PROBE_MAX,
+  4: 27 + 2 * READING_PROBE_MAX,
+  5: 31 + 2 * READING_PROBE_MAX
+};
+const STATUS_FRAME_FIXED_SIZE = 22;
+const STATUS_TREND_SIZE = 16;
+
+const MEASUREMENT_TYPES = ['combined', 'contact', 'infrared'];
+
+const fromCentiDegrees = (value) => (value === TEMP_MISSING ? null : value / 100);
+
+function checkVersion(buffer, minSize, kind) {
+  if (buffer.length < 1) {
+    throw new Error(`Binary ${kind} frame is empty`);
+  }
+  const version = buffer.readUInt8(0);
+  if (!TELEMETRY_BINARY_VERSIONS.includes(version)) {
+    throw new Error(`Unsupported binary ${kind} frame version: ${version}`);
+  }
+  const size = typeof minSize === 'object' ? minSize[version] : minSize;
+  if (buffer.length < size) {
+    throw new Error(`Binary ${kind} frame too short: ${buffer.length} bytes`);
+  }
+  return version;
+}
+
+const readUInt48LE = (buffer, offset) => buffer.readUIntLE(offset, 6);
+
+// Flag bits shared by reading frames and batch entries
+function readingFlags(flags) {
+  return {
+    isValid: (flags & 0x01) !== 0,
+    measurementType: MEASUREMENT_TYPES[(flags >> 1) & 0x03] || 'combined',
+    clockSynced: (flags & 0x08) !== 0
+  };
+}
+
+// Returns an object shaped like the JSON reading payload
+function decodeTemperatureReading(buffer) {
+  const version = checkVersion(buffer, READING_FRAME_SIZE, 'reading');
+
+  const flags = buffer.readUInt8(1);
+  let reading;
+  let offset;
+  if (version === 1) {
+    const { isValid, measurementType } = readingFlags(flags);
+    reading = { isValid, measurementType, timestamp: buffer.readUInt32LE(2) };
+    offset = 6;
+  } else if (version < 5) {
+    reading = {
+      ...readingFlags(flags),
+      seq: buffer.readUInt32LE(2),
+      timestamp: readUInt48LE(buffer, 6)
+    };
+    offset = 12;
+  } else {
+    reading = {
+      ...readingFlags(flags),
+      seq: buffer.readUInt32LE(2),
+      seqEpoch: buffer.readUInt32LE(6),
+      timestamp: readUInt48LE(buffer, 10)
+    };
+    offset = 16;
+  }
+
+  // Probe channels follow the signal strength from version 3
+  if (version >= 3) {
+    const probeCount = Math.min(buffer.readUInt8(offset + 11), READING_PROBE_MAX);
+    reading.probes = [];
+    for (let i = 0; i < probeCount; i++) {
+      reading.probes.push(fromCentiDegrees(buffer.readInt16LE(offset + 12 + i * 2)));
+    }
+  }
+
+  // Then the fused temperature and its confidence in percent
+  if (version >= 4) {
+    const fusedOffset = offset + 12 + 2 * READING_PROBE_MAX;
+    reading.temperature = fromCentiDegrees(buffer.readInt16LE(fusedOffset));
+    reading.confidence = buffer.readUInt8(fusedOffset + 2) / 100;
+  }
+
+  const variance = buffer.readUInt16LE(offset + 6);
+  return {
+    ...reading,
+    infraredTemp: fromCentiDegrees(buffer.readInt16LE(offset)),
+    contactTemp: fromCentiDegrees(buffer.readInt16LE(offset + 2)),
+    ambientTemp: fromCentiDegrees(buffer.readInt16LE(offset + 4)),
+    infraredVariance: variance === 0xFFFF ? null : variance / 10000,
+    metadata: {
+      batteryLevel: buffer.readUInt16LE(offset + 8) / 1000,
+      signalStrength: buffer.readInt8(offset + 10)
+    }
+  };
+}
+
+// Replay batches carry readings stored while the device was offline:
+// version(1) count(1) then count x [sequence(4) reading frame].
+// Returns the decoded readings, each tagged with its offline log sequence
+// number.
+function decodeReplayBatch(buffer) {
+  const version = checkVersion(buffer, 2, 'replay');
+
+  const recordSize = 4 + READING_FRAME_SIZE[version];
+  const count = buffer.readUInt8(1);
+  if (buffer.length < 2 + count * recordSize) {
+    throw new Error(`Replay batch truncated: ${count} records in ${buffer.length} bytes`);
+  }
+
+  const readings = [];
+  for (let i = 0; i < count; i++) {
+    const offset = 2 + i * recordSize;
+    const reading = decodeTemperatureReading(buffer.subarray(offset + 4, offset + recordSize));
+    reading.metadata.sequence = buffer.readUInt32LE(offset);
+    reading.metadata.replayed = true;
+    readings.push(reading);
+  }
+  return readings;
+}
+
+function readVarint(buffer, cursor) {
+  let value = 0;
+  let shift = 0;
+  let byte;
+  do {
+    if (cursor.offset >= buffer.length) {
+      throw new Error('Batch frame truncated inside a varint');
+    }
+    byte = buffer.readUInt8(cursor.offset++);
+    value += (byte & 0x7F) * 2 ** shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return value;
+}
+
+const unzigzag = (value) => (value % 2 === 0 ? value / 2 : -(value + 1) / 2);
+
+function readString(buffer, cursor) {
+  const length = buffer.readUInt8(cursor.offset);
+  const value = buffer.toString('utf8', cursor.offset + 1, cursor.offset + 1 + length);
+  cursor.offset += 1 + length;
+  return value;
+}
+
+// Batch frames carry several readings behind one shared header, with
+// timestamps and temperatures delta-encoded as varints.
+// Returns the decoded readings in order.
+function decodeReadingBatch(buffer) {
+  const version = checkVersion(buffer, 1, 'batch');
+
+  const cursor = { offset: 1 };
+  const deviceId = readString(buffer, cursor);
+  const firmwareVersion = readString(buffer, cursor);
+  const batteryLevel = buffer.readUInt16LE(cursor.offset) / 1000;
+  const signalStrength = buffer.readInt8(cursor.offset + 2);
+  cursor.offset += 3;
+
+  let seq;
+  let seqEpoch = 0;
+  let timestamp;
+  if (version === 1) {
+    timestamp = buffer.readUInt32LE(cursor.offset);
+    cursor.offset += 4;
+  } else {
+    seq = buffer.readUInt32LE(cursor.offset);
+    cursor.offset += 4;
+    // Shared by every reading in the batch
+    if (version >= 5) {
+      seqEpoch = buffer.readUInt32LE(cursor.offset);
+      cursor.offset += 4;
+    }
+    timestamp = readUInt48LE(buffer, cursor.offset);
+    cursor.offset += 6;
+  }
+  const count = buffer.readUInt8(cursor.offset++);
+
+  let infrared = 0;
+  let contact = 0;
+  let ambient = 0;
+  const probes = new Array(READING_PROBE_MAX).fill(0);
+  let fused = 0;
+  const readings = [];
+
+  for (let i = 0; i < count; i++) {
+    const { isValid, measurementType, clockSynced } = readingFlags(buffer.readUInt8(cursor.offset++));
+    const reading = { deviceId, isValid, measurementType };
+    if (version === 1) {
+      // Timestamp deltas wrap modulo 2^32, matching the firmware's uint32 math
+      timestamp = (timestamp + readVarint(buffer, cursor)) >>> 0;
+    } else {
+      // Sequence deltas wrap the same way; timestamp deltas are signed
+      seq = (seq + readVarint(buffer, cursor)) >>> 0;
+      timestamp += unzigzag(readVarint(buffer, cursor));
+      Object.assign(reading, { seq, seqEpoch, clockSynced });
+    }
+    infrared += unzigzag(readVarint(buffer, cursor));
+    contact += unzigzag(readVarint(buffer, cursor));
+    ambient += unzigzag(readVarint(buffer, cursor));
+    const variance = readVarint(buffer, cursor);
+
+    if (version >= 3) {
+      const probeCount = buffer.readUInt8(cursor.offset++);
+      if (probeCount > READING_PROBE_MAX) {
+        throw new Error(`Batch entry has ${probeCount} probes`);
+      }
+      for (let j = 0; j < probeCount; j++) {
+        probes[j] += unzigzag(readVarint(buffer, cursor));
+      }
+      reading.probes = probes.slice(0, probeCount).map(fromCentiDegrees);
+    }
+
+    if (version >= 4) {
+      fused += unzigzag(readVarint(buffer, cursor));
+      reading.temperature = fromCentiDegrees(fused);
+      reading.confidence = buffer.readUInt8(cursor.offset++) / 100;
+    }
+
+    readings.push({
+      ...reading,
+      timestamp,
+      infraredTemp: fromCentiDegrees(infrared),
+      contactTemp: fromCentiDegrees(contact),
+      ambientTemp: fromCentiDegrees(ambient),
+      infraredVariance: variance === 0xFFFF ? null : variance / 10000,
+      metadata: {
+        batteryLevel,
+        signalStrength,
+        firmwareVersion
+      }
+    });
+  }
+  return readings;
+}
+
+// Returns an object shaped like the JSON status payload
+function decodeDeviceStatus(buffer) {
+  checkVersion(buffer, STATUS_FRAME_FIXED_SIZE, 'status');
+
+  const flags = buffer.readUInt8(1);
+  const versionLength = buffer.readUInt8(21);
+  const trendOffset = 22 + versionLength;
+
+  const status = {
+    status: (flags & 0x01) !== 0 ? 'online' : 'error',
+    uptime: buffer.readUInt32LE(2),
+    batteryLevel: buffer.readUInt16LE(6) / 1000,
+    signalStrength: buffer.readInt8(8),
+    freeMemory: buffer.readUInt32LE(9),
+    minFreeMemory: buffer.readUInt32LE(13),
+    maxAllocMemory: buffer.readUInt32LE(17),
+    firmwareVersion: buffer.toString('utf8', 22, trendOffset)
+  };
+
+  // Trend statistics follow the firmware version when flag 0x02 is set
+  let healthOffset = trendOffset;
+  if ((flags & 0x02) !== 0) {
+    if (buffer.length < trendOffset + STATUS_TREND_SIZE) {
+      throw new Error(`Binary status frame too short for trend: ${buffer.length} bytes`);
+    }
+    status.trend = {
+      ewma: fromCentiDegrees(buffer.readInt16LE(trendOffset)),
+      min: fromCentiDegrees(buffer.readInt16LE(trendOffset + 2)),
+      max: fromCentiDegrees(buffer.readInt16LE(trendOffset + 4)),
+      slope: buffer.readInt16LE(trendOffset + 6) / 1000,
+      feverTime: buffer.readUInt32LE(trendOffset + 8),
+      samples: buffer.readUInt32LE(trendOffset + 12),
+      onset: (flags & 0x04) !== 0
+    };
+    healthOffset += STATUS_TREND_SIZE;
+  }
+
+  // Sensor health in percent comes last when flag 0x08 is set
+  if ((flags & 0x08) !== 0) {
+    if (buffer.length < healthOffset + 2) {
+      throw new Error(`Binary status frame too short for sensor health: ${buffer.length} bytes`);
+    }
+    status.sensorHealth = {
+      infrared: buffer.readUInt8(healthOffset),
+      contact: buffer.readUInt8(healthOffset + 1)
+    };
+  }
+
+  return status;
+}
+
+module.exports = {
+  decodeTemperatureReading,
+  decodeReplayBatch,
+  decodeReadingBatch,
+  decodeDeviceStatus
+};
@@ -0,0 +1,274 @@
+// Binary readings decoded and validated the way handleTemperatureReading
+// stores them, without a broker or database behind it
+jest.mock('mqtt', () => ({ connect: jest.fn() }));
+jest.mock('../../src/utils/logger', () => ({
+  info: jest.fn(),
+  warn: jest.fn(),
+  error: jest.fn(),
+  debug: jest.fn()
+}));
+jest.mock('../../src/services/notificationService', () => ({
+  createFeverAlert: jest.fn(),
+  sendNotification: jest.fn()
+}));
+jest.mock('../../src/services/websocketService', () => ({ sendToUser: jest.fn() }));
+
+const TemperatureReading = require('../../src/models/TemperatureReading');
+const telemetryCodec = require('../../src/utils/telemetryCodec');
+const logger = require('../../src/utils/logger');
+const mqttService = require('../../src/services/mqttService');
+
+const TEMP_MISSING = -32768;
+
+// A version 4 or 5 reading frame, laid out as in firmware telemetry_codec.h
+function readingFrame({ version = 4, seq = 42, seqEpoch = 0, flags = 0x01 | 0x08, infrared,
+  contact, ambient, variance, probes = [], fused, confidence = 90 }) {
+  const epochSize = version >= 5 ? 4 : 0;
+  const frame = Buffer.alloc(33 + epochSize);
+  frame.writeUInt8(version, 0);
+  frame.writeUInt8(flags, 1);
+  frame.writeUInt32LE(seq, 2);
+  if (epochSize) frame.writeUInt32LE(seqEpoch, 6);
+  let offset = 6 + epochSize;
+  frame.writeUIntLE(1760000000000, offset, 6);
+  offset += 6;
+  frame.writeInt16LE(infrared, offset);
+  frame.writeInt16LE(contact, offset + 2);
+  frame.writeInt16LE(ambient, offset + 4);
+  frame.writeUInt16LE(variance, offset + 6);
+  frame.writeUInt16LE(3700, offset + 8);
+  frame.writeInt8(-61, offset + 10);
+  frame.writeUInt8(probes.length, offset + 11);
+  for (let i = 0; i < 3; i++) {
+    frame.writeInt16LE(i < probes.length ? probes[i] : TEMP_MISSING, offset + 12 + i * 2);
+  }
+  frame.writeInt16LE(fused, offset + 18);
+  frame.writeUInt8(confidence, offset + 20);
+  return frame;
+}
+
+function testDevice() {
+  return {
+    id: '5f0c1a52-3b7e-4c61-9a57-1d2b3c4d5e6f',
+    userId: '0d9e8f7a-6b5c-4d3e-8f1a-2b3c4d5e6f70',
+    deviceId: 'botcareu_0123456789ab',
+    name: 'Test thermometer',
+    status: 'online',
+    updateStatus: jest.fn().mockResolvedValue()
+  };
+}
+
+describe('binary reading ingest', () => {
+  beforeEach(() => {
+    jest.clearAllMocks();
+    // Validates exactly as an insert would, then stands in for the stored row
+    jest.spyOn(TemperatureReading, 'upsertReading')
+      .mockImplementation(async (data) => TemperatureReading.fromJson(data));
+  });
+
+  afterEach(() => {
+    jest.restoreAllMocks();
+  });
+
+  test('a reading from an IR-only device is stored with the missing channels null', async () => {
+    const data = telemetryCodec.decodeTemperatureReading(readingFrame({
+      flags: 0x01 | (2 << 1) | 0x08,
+      infrared: 3652,
+      contact: TEMP_MISSING,
+      ambient: 2210,
+      variance: 12,
+      fused: 3701
+    }));
+    expect(data.contactTemp).toBeNull();
+
+    await mqttService.handleTemperatureReading(testDevice(), data);
+
+    expect(logger.error).not.toHaveBeenCalled();
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.temperature).toBeCloseTo(37.01);
+    expect(stored.infraredTemp).toBeCloseTo(36.52);
+    expect(stored.contactTemp).toBeNull();
+    expect(stored.measurementType).toBe('infrared');
+    expect(stored.seq).toBe(42);
+  });
+
+  test('a failed IR read and unknown variance are stored as null', async () => {
+    const data = telemetryCodec.decodeTemperatureReading(readingFrame({
+      flags: 0x01 | (1 << 1) | 0x08,
+      infrared: TEMP_MISSING,
+      contact: 3688,
+      ambient: TEMP_MISSING,
+      variance: 0xFFFF,
+      probes: [3688],
+      fused: 3688
+    }));
+
+    await mqttService.handleTemperatureReading(testDevice(), data);
+
+    expect(logger.error).not.toHaveBeenCalled();
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.infraredTemp).toBeNull();
+    expect(stored.ambientTemp).toBeNull();
+    expect(stored.metadata.infraredVariance).toBeNull();
+    expect(stored.metadata.probes).toEqual([36.88]);
+  });
+
+  test('a disconnected contact probe value is stored as null', async () => {
+    const data = telemetryCodec.decodeTemperatureReading(readingFrame({
+      infrared: 3652,
+      contact: -12700,
+      ambient: 2210,
+      variance: 12,
+      fused: 3701
+    }));
+
+    await mqttService.handleTemperatureReading(testDevice(), data);
+
+    expect(logger.error).not.toHaveBeenCalled();
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.contactTemp).toBeNull();
+  });
+
+  test('batch and replay readings with a missing channel are stored', async () => {
+    const record = readingFrame({
+      infrared: 3652,
+      contact: TEMP_MISSING,
+      ambient: 2210,
+      variance: 12,
+      fused: 3701
+    });
+    const replay = Buffer.concat([Buffer.from([4, 1, 7, 0, 0, 0]), record]);
+
+    await mqttService.handleReadingBatch(testDevice(), telemetryCodec.decodeReplayBatch(replay));
+
+    expect(logger.error).not.toHaveBeenCalled();
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.contactTemp).toBeNull();
+    expect(stored.metadata.replayed).toBe(true);
+  });
+
+  test('a reading with no usable temperature is skipped, not rejected', async () => {
+    const data = telemetryCodec.decodeTemperatureReading(readingFrame({
+      flags: 0x08,
+      infrared: TEMP_MISSING,
+      contact: TEMP_MISSING,
+      ambient: TEMP_MISSING,
+      variance: 0xFFFF,
+      fused: TEMP_MISSING,
+      confidence: 0
+    }));
+
+    await mqttService.handleTemperatureReading(testDevice(), data);
+
+    expect(TemperatureReading.upsertReading).not.toHaveBeenCalled();
+    expect(logger.error).not.toHaveBeenCalled();
+  });
+});
+
+describe('reading sequence epochs', () => {
+  beforeEach(() => {
+    jest.clearAllMocks();
+    jest.spyOn(TemperatureReading, 'upsertReading')
+      .mockImplementation(async (data) => TemperatureReading.fromJson(data));
+  });
+
+  afterEach(() => {
+    jest.restoreAllMocks();
+  });
+
+  const sensors = { infrared: 3652, contact: 3688, ambient: 2210, variance: 12, fused: 3688 };
+
+  test('a version 5 frame carries its seq epoch into the stored reading', async () => {
+    const data = telemetryCodec.decodeTemperatureReading(readingFrame({
+      ...sensors,
+      version: 5,
+      seq: 1,
+      seqEpoch: 0xA1B2C3D4
+    }));
+    expect(data.timestamp).toBe(1760000000000);
+    expect(data.temperature).toBeCloseTo(36.88);
+
+    await mqttService.handleTemperatureReading(testDevice(), data);
+
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.seq).toBe(1);
+    expect(stored.seqEpoch).toBe(0xA1B2C3D4);
+  });
+
+  test('readings from before epochs are in epoch 0', async () => {
+    await mqttService.handleTemperatureReading(testDevice(),
+      telemetryCodec.decodeTemperatureReading(readingFrame(sensors)));
+
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.seqEpoch).toBe(0);
+  });
+
+  test('a version 5 replay decodes every record in its epoch', async () => {
+    const record = readingFrame({ ...sensors, version: 5, seq: 9, seqEpoch: 77 });
+    const replay = Buffer.concat([Buffer.from([5, 2]),
+      Buffer.from([1, 0, 0, 0]), record, Buffer.from([2, 0, 0, 0]), record]);
+
+    const readings = telemetryCodec.decodeReplayBatch(replay);
+
+    expect(readings.length).toBe(2);
+    expect(readings[1].seqEpoch).toBe(77);
+    expect(readings[1].metadata.sequence).toBe(2);
+  });
+});
+
+describe('per-reading fever notifications', () => {
+  const notificationService = require('../../src/services/notificationService');
+
+  beforeEach(() => {
+    jest.clearAllMocks();
+    // Stands in for the stored row, with the fever status set on insert
+    jest.spyOn(TemperatureReading, 'upsertReading').mockImplementation(async (data) => {
+      const reading = TemperatureReading.fromJson(data);
+      reading.id = '9a8b7c6d-5e4f-4a3b-8c2d-1e0f9a8b7c6d';
+      reading.detectFever();
+      return reading;
+    });
+  });
+
+  afterEach(() => {
+    jest.restoreAllMocks();
+  });
+
+  test('firmware with device fever alerts is not notified per reading', async () => {
+    const data = telemetryCodec.decodeTemperatureReading(readingFrame({
+      infrared: 3852,
+      contact: 3861,
+      ambient: 2210,
+      variance: 12,
+      fused: 3861
+    }));
+
+    await mqttService.handleTemperatureReading(testDevice(), data);
+
+    const stored = await TemperatureReading.upsertReading.mock.results[0].value;
+    expect(stored.feverDetected).toBe(true);
+    expect(notificationService.createFeverAlert).not.toHaveBeenCalled();
+  });
+
+  test('replayed fever readings are not notified', async () => {
+    await mqttService.handleTemperatureReading(testDevice(), {
+      temperature: 38.6,
+      measurementType: 'contact',
+      metadata: { replayed: true }
+    });
+
+    expect(TemperatureReading.upsertReading).toHaveBeenCalled();
+    expect(notificationService.createFeverAlert).not.toHaveBeenCalled();
+  });
+
+  test('older firmware is still notified per reading', async () => {
+    await mqttService.handleTemperatureReading(testDevice(), {
+      temperature: 38.6,
+      contactTemp: 38.6,
+      measurementType: 'contact',
+      metadata: { batteryLevel: 3.9 }
+    });
+
+    expect(notificationService.createFeverAlert).toHaveBeenCalledTimes(1);
+  });
+});
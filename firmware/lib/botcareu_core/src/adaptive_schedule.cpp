@@ -0,0 +1,53 @@
+#include "adaptive_schedule.h"
+
+#include <math.h>
+
+static uint32_t clampInterval(uint32_t interval, uint32_t low, uint32_t high) {
+  if (interval < low) return low;
+  if (interval > high) return high;
+  return interval;
+}
+
+void scheduleReset(ScheduleState& state) {
+  state.lastTemperature = 0;
+  state.lastAt = 0;
+  state.steadySince = 0;
+  state.slope = 0;
+  state.hasReading = false;
+}
+
+uint32_t scheduleNextInterval(ScheduleState& state, float temperature, unsigned long now,
+                              const ScheduleBounds& bounds) {
+  if (state.hasReading && now != state.lastAt) {
+    state.slope = (temperature - state.lastTemperature) * 60000.0f / (float)(now - state.lastAt);
+  } else {
+    state.slope = 0;
+  }
+
+  bool steady = temperature < bounds.feverThreshold && fabsf(state.slope) < bounds.steadySlope;
+  if (!steady || !state.hasReading) {
+    state.steadySince = now;
+  }
+
+  state.lastTemperature = temperature;
+  state.lastAt = now;
+  state.hasReading = true;
+
+  // Fever bands never slow the cadence below the base interval
+  uint32_t interval;
+  if (temperature >= bounds.criticalTempThreshold) {
+    interval = bounds.minInterval;
+  } else if (temperature >= bounds.highFeverThreshold) {
+    interval = bounds.minInterval * 2;
+  } else if (temperature >= bounds.feverThreshold) {
+    interval = bounds.minInterval * 4;
+  } else if (state.slope >= bounds.risingSlope) {
+    interval = bounds.baseInterval / 2;
+  } else if (now - state.steadySince >= bounds.stablePeriod) {
+    return bounds.maxInterval;
+  } else {
+    return bounds.baseInterval;
+  }
+
+  return clampInterval(interval, bounds.minInterval, bounds.baseInterval);
+}
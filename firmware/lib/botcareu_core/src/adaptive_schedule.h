@@ -0,0 +1,40 @@
+#ifndef ADAPTIVE_SCHEDULE_H
+#define ADAPTIVE_SCHEDULE_H
+
+#include <stdint.h>
+
+// Chooses the time to the next measurement from the latest reading.
+//
+// Fever bands shorten the interval towards minInterval: critical uses it
+// as is, high fever doubles it, fever quadruples it. A temperature rising
+// faster than risingSlope halves the base interval. Readings that stay
+// normal and flat for stablePeriod stretch it to maxInterval. Everything
+// else uses baseInterval. Setting minInterval and maxInterval to
+// baseInterval turns the adaptation off.
+struct ScheduleBounds {
+  uint32_t minInterval;       // ms
+  uint32_t baseInterval;      // ms
+  uint32_t maxInterval;       // ms
+  uint32_t stablePeriod;      // ms of steady normal readings before slowing down
+  float risingSlope;          // °C per minute
+  float steadySlope;          // °C per minute, |slope| below this counts as flat
+  float feverThreshold;
+  float highFeverThreshold;
+  float criticalTempThreshold;
+};
+
+struct ScheduleState {
+  float lastTemperature;
+  unsigned long lastAt;         // ms
+  unsigned long steadySince;    // ms
+  float slope;                  // °C per minute between the last two readings
+  bool hasReading;
+};
+
+void scheduleReset(ScheduleState& state);
+
+// Records a reading taken at now and returns the interval to the next one
+uint32_t scheduleNextInterval(ScheduleState& state, float temperature, unsigned long now,
+                              const ScheduleBounds& bounds);
+
+#endif // ADAPTIVE_SCHEDULE_H
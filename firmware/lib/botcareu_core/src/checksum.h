@@ -0,0 +1,10 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-8 (polynomial 0x07) for the small records kept on flash
+uint8_t crc8(const uint8_t* data, size_t length);
+
+#endif // CHECKSUM_H
@@ -0,0 +1,57 @@
+#include "clock_model.h"
+
+// Rate errors beyond this are taken to be a bad sync, not drift
+#define CLOCK_MAX_DRIFT_PPM 20000.0f
+#define CLOCK_DRIFT_WEIGHT 0.3f
+#define CLOCK_DRIFT_SAMPLES_MAX 255
+
+void clockModelReset(ClockModel& model) {
+  model.synced = false;
+  model.syncedEpochMs = 0;
+  model.syncedAt = 0;
+  model.anchorEpochMs = 0;
+  model.anchorAt = 0;
+  model.driftPpm = 0;
+  model.driftSamples = 0;
+}
+
+int32_t clockModelSync(ClockModel& model, uint64_t epochMs, unsigned long localMs,
+                       unsigned long minDriftInterval) {
+  int32_t offset = 0;
+
+  if (!model.synced) {
+    model.synced = true;
+    model.anchorEpochMs = epochMs;
+    model.anchorAt = localMs;
+  } else {
+    offset = (int32_t)(int64_t)(epochMs - clockModelNow(model, localMs));
+
+    // Raw rates over the interval, independent of the current correction
+    unsigned long localElapsed = localMs - model.anchorAt;
+    int64_t wallElapsed = (int64_t)(epochMs - model.anchorEpochMs);
+    if (localElapsed >= minDriftInterval && wallElapsed > 0) {
+      float measured = ((float)localElapsed - (float)wallElapsed) / (float)wallElapsed * 1e6f;
+      if (measured > -CLOCK_MAX_DRIFT_PPM && measured < CLOCK_MAX_DRIFT_PPM) {
+        // The first interval is taken as is; later ones are smoothed, since
+        // a single sync can be off by a network round trip
+        model.driftPpm = model.driftSamples == 0
+                             ? measured
+                             : model.driftPpm + CLOCK_DRIFT_WEIGHT * (measured - model.driftPpm);
+        if (model.driftSamples < CLOCK_DRIFT_SAMPLES_MAX) model.driftSamples++;
+      }
+      model.anchorEpochMs = epochMs;
+      model.anchorAt = localMs;
+    }
+  }
+
+  model.syncedEpochMs = epochMs;
+  model.syncedAt = localMs;
+  return offset;
+}
+
+uint64_t clockModelNow(const ClockModel& model, unsigned long localMs) {
+  // Signed, so times shortly before the sync can be placed too
+  int32_t localElapsed = (int32_t)(localMs - model.syncedAt);
+  double corrected = (double)localElapsed / (1.0 + model.driftPpm * 1e-6);
+  return model.syncedEpochMs + (int64_t)(corrected < 0 ? corrected - 0.5 : corrected + 0.5);
+}
@@ -0,0 +1,37 @@
+#ifndef CLOCK_MODEL_H
+#define CLOCK_MODEL_H
+
+#include <stdint.h>
+
+// Wall clock kept from occasional time syncs and a free-running local
+// millisecond clock, with the local clock's rate error estimated from
+// successive syncs.
+//
+// Between syncs the local clock is the only reference, and across deep
+// sleep it runs from the RTC oscillator, which can be off by hundreds of
+// ppm. Correcting for the measured rate keeps timestamps close over long
+// sync intervals, so syncs can be spaced out.
+struct ClockModel {
+  bool synced;
+  uint64_t syncedEpochMs;     // Wall clock at the last sync
+  unsigned long syncedAt;     // Local ms at the last sync
+  uint64_t anchorEpochMs;     // Start of the interval the next drift
+  unsigned long anchorAt;     // measurement spans
+  float driftPpm;             // Local clock fast (+) or slow (-), smoothed
+  uint8_t driftSamples;       // Sync intervals behind driftPpm, saturating
+};
+
+void clockModelReset(ClockModel& model);
+
+// Records a sync: the wall clock read epochMs at local time localMs. Drift
+// is measured over intervals of at least minDriftInterval ms, spanning
+// several syncs if need be, since shorter ones are dominated by sync
+// jitter. Returns how far off the model was in ms, 0 for the first sync.
+int32_t clockModelSync(ClockModel& model, uint64_t epochMs, unsigned long localMs,
+                       unsigned long minDriftInterval);
+
+// Wall clock in ms at local time localMs, which may also be up to ~24 days
+// before the last sync. Only meaningful once synced.
+uint64_t clockModelNow(const ClockModel& model, unsigned long localMs);
+
+#endif // CLOCK_MODEL_H
@@ -0,0 +1,24 @@
+#include "deadband.h"
+
+#include <math.h>
+
+void deadbandReset(DeadbandFilter& filter) {
+  filter.lastReported = 0;
+  filter.lastReportedAt = 0;
+  filter.hasReported = false;
+}
+
+bool deadbandShouldReport(DeadbandFilter& filter, float temperature, unsigned long now,
+                          float band, unsigned long maxSilence, float feverThreshold) {
+  bool report = band <= 0 || !filter.hasReported ||
+                fabsf(temperature - filter.lastReported) > band ||
+                (filter.lastReported >= feverThreshold) != (temperature >= feverThreshold) ||
+                now - filter.lastReportedAt >= maxSilence;
+
+  if (report) {
+    filter.lastReported = temperature;
+    filter.lastReportedAt = now;
+    filter.hasReported = true;
+  }
+  return report;
+}
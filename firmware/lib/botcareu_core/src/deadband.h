@@ -0,0 +1,22 @@
+#ifndef DEADBAND_H
+#define DEADBAND_H
+
+#include <stdint.h>
+
+// Deadband reporting: a reading is only worth sending if it moved more than
+// the band from the last reported value, crossed the fever threshold, or
+// nothing has been reported for maxSilence ms.
+struct DeadbandFilter {
+  float lastReported;
+  unsigned long lastReportedAt;
+  bool hasReported;
+};
+
+void deadbandReset(DeadbandFilter& filter);
+
+// Returns true, and records the reading as reported, if it should be sent.
+// A band of 0 or less disables the filter.
+bool deadbandShouldReport(DeadbandFilter& filter, float temperature, unsigned long now,
+                          float band, unsigned long maxSilence, float feverThreshold);
+
+#endif // DEADBAND_H
@@ -0,0 +1,78 @@
+#include "fever_alert.h"
+
+#include <math.h>
+
+static float bandThreshold(FeverSeverity severity, const AlertBands& bands) {
+  switch (severity) {
+    case FEVER_CRITICAL:
+      return bands.criticalTempThreshold;
+    case FEVER_HIGH:
+      return bands.highFeverThreshold;
+    case FEVER_MODERATE:
+    default:
+      return bands.feverThreshold;
+  }
+}
+
+// Bands at or below the current one are held down to hysteresis under
+// their threshold
+static FeverSeverity bandOf(float temperature, FeverSeverity current, const AlertBands& bands) {
+  for (int level = FEVER_CRITICAL; level > FEVER_NONE; level--) {
+    FeverSeverity severity = (FeverSeverity)level;
+    float threshold = bandThreshold(severity, bands);
+    if (severity <= current) threshold -= bands.hysteresis;
+    if (temperature >= threshold) return severity;
+  }
+  return FEVER_NONE;
+}
+
+void alertReset(AlertState& state) {
+  state.severity = FEVER_NONE;
+  state.announced = FEVER_NONE;
+  state.announcedAt = 0;
+}
+
+AlertEvent alertUpdate(AlertState& state, float temperature, unsigned long now,
+                       const AlertBands& bands) {
+  // A failed reading says nothing about the fever, so it neither clears
+  // nor re-raises one
+  if (isnan(temperature)) return ALERT_EVENT_NONE;
+
+  FeverSeverity previous = state.severity;
+  state.severity = bandOf(temperature, previous, bands);
+
+  AlertEvent event;
+  if (state.severity == FEVER_NONE) {
+    if (previous == FEVER_NONE) return ALERT_EVENT_NONE;
+    state.announced = FEVER_NONE;
+    return ALERT_EVENT_CLEARED;
+  } else if (previous == FEVER_NONE) {
+    event = ALERT_EVENT_RAISED;
+  } else if (state.severity > state.announced) {
+    event = ALERT_EVENT_ESCALATED;
+  } else if (bands.realertInterval > 0 && now - state.announcedAt >= bands.realertInterval) {
+    event = ALERT_EVENT_REMINDER;
+  } else {
+    return ALERT_EVENT_NONE;
+  }
+
+  state.announced = state.severity;
+  state.announcedAt = now;
+  return event;
+}
+
+const char* alertEventName(AlertEvent event) {
+  switch (event) {
+    case ALERT_EVENT_RAISED:
+      return "fever_detected";
+    case ALERT_EVENT_ESCALATED:
+      return "fever_escalated";
+    case ALERT_EVENT_REMINDER:
+      return "fever_reminder";
+    case ALERT_EVENT_CLEARED:
+      return "fever_cleared";
+    case ALERT_EVENT_NONE:
+    default:
+      return "none";
+  }
+}
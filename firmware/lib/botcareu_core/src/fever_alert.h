@@ -0,0 +1,48 @@
+#ifndef FEVER_ALERT_H
+#define FEVER_ALERT_H
+
+#include <stdint.h>
+
+#include "measurement.h"
+
+// Decides when a fever is worth announcing, so a patient sitting just
+// above the threshold raises one alert rather than one per reading.
+//
+// Each severity band is entered at its threshold but only left once the
+// temperature falls hysteresis below it. Entering a fever raises an alert,
+// rising into a band more severe than the last one announced escalates at
+// once, and an unchanged fever is only repeated after realertInterval.
+// Falling below the fever band clears it.
+struct AlertBands {
+  float feverThreshold;
+  float highFeverThreshold;
+  float criticalTempThreshold;
+  float hysteresis;             // °C
+  uint32_t realertInterval;     // ms between reminders, 0 never repeats
+};
+
+struct AlertState {
+  FeverSeverity severity;       // Current band
+  FeverSeverity announced;      // Most severe band announced since the last alert
+  unsigned long announcedAt;    // ms
+};
+
+enum AlertEvent : uint8_t {
+  ALERT_EVENT_NONE,
+  ALERT_EVENT_RAISED,
+  ALERT_EVENT_ESCALATED,
+  ALERT_EVENT_REMINDER,
+  ALERT_EVENT_CLEARED
+};
+
+void alertReset(AlertState& state);
+
+// Feeds one reading taken at now and returns what, if anything, to announce.
+// A NAN temperature leaves the state as it was.
+AlertEvent alertUpdate(AlertState& state, float temperature, unsigned long now,
+                       const AlertBands& bands);
+
+// Alert type published for event
+const char* alertEventName(AlertEvent event);
+
+#endif // FEVER_ALERT_H
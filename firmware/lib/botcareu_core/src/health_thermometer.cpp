@@ -0,0 +1,58 @@
+#include "health_thermometer.h"
+
+#include <math.h>
+
+// Temperature Measurement flag bits; Celsius is bit 0 clear
+#define HTS_FLAG_TIMESTAMP 0x02
+
+#define FLOAT_NAN 0x007FFFFF          // IEEE 11073 FLOAT "not a number"
+#define FLOAT_EXPONENT -2
+
+#define MS_PER_DAY 86400000ULL
+
+// Proleptic Gregorian date of a day count since 1970-01-01
+static void civilFromDays(int32_t days, uint16_t& year, uint8_t& month, uint8_t& day) {
+  days += 719468;
+  int32_t era = days / 146097;
+  uint32_t dayOfEra = days - era * 146097;
+  uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  uint32_t shiftedMonth = (5 * dayOfYear + 2) / 153;   // From March
+  day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+  month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+  year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+size_t encodeHealthThermometerMeasurement(const TemperatureReading& reading, uint8_t* out,
+                                          size_t capacity) {
+  bool timestamped = reading.clockSynced;
+  size_t length = timestamped ? 12 : 5;
+  if (capacity < length) return 0;
+
+  uint32_t value = FLOAT_NAN;
+  if (!isnan(reading.fusedTemp)) {
+    int32_t mantissa = (int32_t)lroundf(reading.fusedTemp * 100.0f);
+    value = ((uint32_t)(uint8_t)FLOAT_EXPONENT << 24) | ((uint32_t)mantissa & 0x00FFFFFF);
+  }
+
+  out[0] = timestamped ? HTS_FLAG_TIMESTAMP : 0;
+  out[1] = value & 0xFF;
+  out[2] = (value >> 8) & 0xFF;
+  out[3] = (value >> 16) & 0xFF;
+  out[4] = value >> 24;
+
+  if (timestamped) {
+    uint16_t year;
+    uint8_t month, day;
+    civilFromDays((int32_t)(reading.timestamp / MS_PER_DAY), year, month, day);
+    uint32_t seconds = (reading.timestamp % MS_PER_DAY) / 1000;
+    out[5] = year & 0xFF;
+    out[6] = year >> 8;
+    out[7] = month;
+    out[8] = day;
+    out[9] = seconds / 3600;
+    out[10] = (seconds / 60) % 60;
+    out[11] = seconds % 60;
+  }
+  return length;
+}
@@ -0,0 +1,27 @@
+#ifndef HEALTH_THERMOMETER_H
+#define HEALTH_THERMOMETER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reading.h"
+
+// Characteristic values of the Bluetooth SIG Health Thermometer service
+// (0x1809), so generic thermometer apps can read the device as well as our
+// own. Multi-byte fields are little-endian.
+#define HTS_SERVICE_UUID 0x1809
+#define HTS_TEMPERATURE_MEASUREMENT_UUID 0x2A1C   // Indicated, one per reading
+#define HTS_TEMPERATURE_TYPE_UUID 0x2A1D
+#define HTS_INTERMEDIATE_TEMPERATURE_UUID 0x2A1E  // Notified, same layout
+#define HTS_MEASUREMENT_INTERVAL_UUID 0x2A21      // uint16 seconds
+
+#define HTS_TYPE_BODY 0x02            // "Body (general)" temperature type
+#define HTS_MEASUREMENT_MAX_SIZE 12   // Flags, FLOAT temperature, date-time
+
+// Temperature Measurement value for reading: the fused temperature in °C as
+// an IEEE 11073 FLOAT with two decimals, then the UTC date-time when the
+// reading's clock was synced. Returns 0 if capacity is too small.
+size_t encodeHealthThermometerMeasurement(const TemperatureReading& reading, uint8_t* out,
+                                          size_t capacity);
+
+#endif // HEALTH_THERMOMETER_H
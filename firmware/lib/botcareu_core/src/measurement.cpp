@@ -0,0 +1,76 @@
+#include "measurement.h"
+
+#include <math.h>
+
+bool validateTemperature(float temp) {
+  // NAN compares false, so failed sensor reads are rejected too
+  return temp >= 20 && temp <= 50;
+}
+
+void resolveInfrared(TemperatureReading& reading, const SampleBuffer& samples,
+                     uint8_t expectedSamples, uint8_t filterMode, uint8_t trim, float offset) {
+  if (samples.count >= (expectedSamples + 1) / 2) {
+    reading.infraredTemp = sampleBufferFilter(samples, filterMode, trim) + offset;
+    reading.infraredVariance = sampleBufferVariance(samples);
+  } else {
+    reading.infraredTemp = NAN;
+    reading.infraredVariance = NAN;
+  }
+}
+
+void resolveContact(TemperatureReading& reading, float raw, float offset) {
+  reading.contactTemp = validateTemperature(raw) ? raw + offset : raw;
+}
+
+void resolveProbes(TemperatureReading& reading, const float* raw, uint8_t count,
+                   uint8_t primary, float offset) {
+  if (count > READING_PROBE_MAX) count = READING_PROBE_MAX;
+  reading.probeCount = count;
+  for (uint8_t i = 0; i < READING_PROBE_MAX; i++) {
+    reading.probeTemps[i] = i < count && raw[i] > PROBE_DISCONNECTED ? raw[i] : NAN;
+  }
+  if (primary < count) {
+    resolveContact(reading, raw[primary], offset);
+    if (validateTemperature(raw[primary])) reading.probeTemps[primary] = reading.contactTemp;
+  } else {
+    reading.contactTemp = PROBE_DISCONNECTED;
+  }
+}
+
+float primaryTemperature(const TemperatureReading& reading) {
+  return reading.fusedTemp;
+}
+
+const char* measurementTypeName(MeasurementType type) {
+  switch (type) {
+    case MEASUREMENT_CONTACT:
+      return "contact";
+    case MEASUREMENT_INFRARED:
+      return "infrared";
+    case MEASUREMENT_COMBINED:
+    default:
+      return "combined";
+  }
+}
+
+FeverSeverity classifyFever(float temperature, float feverThreshold, float highFeverThreshold,
+                            float criticalTempThreshold) {
+  if (temperature >= criticalTempThreshold) return FEVER_CRITICAL;
+  if (temperature >= highFeverThreshold) return FEVER_HIGH;
+  if (temperature >= feverThreshold) return FEVER_MODERATE;
+  return FEVER_NONE;
+}
+
+const char* feverSeverityName(FeverSeverity severity) {
+  switch (severity) {
+    case FEVER_CRITICAL:
+      return "critical";
+    case FEVER_HIGH:
+      return "high";
+    case FEVER_MODERATE:
+      return "moderate";
+    case FEVER_NONE:
+    default:
+      return "none";
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef MEASUREMENT_H
+#define MEASUREMENT_H
+
+#include <stdint.h>
+
+#include "reading.h"
+#include "sampling.h"
+
+#define PROBE_DISCONNECTED -127.0f  // What DallasTemperature reads from a missing probe
+
+// Measurement rules shared by every build: what counts as a plausible body
+// temperature, how raw sensor values enter a reading, and how it is
+// classified. sensor_fusion.h turns the sensor values into the reading's
+// temperature.
+// Everything here works on sensor values rather than sensor objects, so it
+// runs the same on the device and on a host.
+
+enum FeverSeverity : uint8_t {
+  FEVER_NONE,
+  FEVER_MODERATE,
+  FEVER_HIGH,
+  FEVER_CRITICAL
+};
+
+// NAN and disconnected-sensor values are rejected too
+bool validateTemperature(float temp);
+
+// Sets infraredTemp (filtered, plus offset) and infraredVariance from the IR
+// samples. Unless a majority of the expected samples were usable, both are NAN.
+void resolveInfrared(TemperatureReading& reading, const SampleBuffer& samples,
+                     uint8_t expectedSamples, uint8_t filterMode, uint8_t trim, float offset);
+
+// Stores the contact value, calibrated by offset if it is plausible
+void resolveContact(TemperatureReading& reading, float raw, float offset);
+
+// Fills the probe channels from raw probe values and sets contactTemp from
+// the primary one through resolveContact(). Channels hold whatever a probe
+// read, since ambient and reference probes sit outside the body range;
+// only disconnected probes become NAN. offset calibrates the primary only.
+void resolveProbes(TemperatureReading& reading, const float* raw, uint8_t count,
+                   uint8_t primary, float offset);
+
+// The fused temperature, which alerts, trends and the display go by
+float primaryTemperature(const TemperatureReading& reading);
+const char* measurementTypeName(MeasurementType type);
+
+FeverSeverity classifyFever(float temperature, float feverThreshold, float highFeverThreshold,
+                            float criticalTempThreshold);
+const char* feverSeverityName(FeverSeverity severity);
+
+#endif // MEASUREMENT_H
@@ -0,0 +1,35 @@
+#ifndef READING_H
+#define READING_H
+
+#include <stdint.h>
+
+enum MeasurementType : uint8_t {
+  MEASUREMENT_COMBINED,
+  MEASUREMENT_CONTACT,
+  MEASUREMENT_INFRARED
+};
+
+#define READING_PROBE_MAX 3   // DS18B20 probes carried per reading
+
+// One processed measurement. Plain data only, so readings can be copied
+// through FreeRTOS queues and encoded without touching the heap.
+struct TemperatureReading {
+  float infraredTemp;
+  float contactTemp;
+  float ambientTemp;
+  float infraredVariance;       // Spread of the IR samples behind infraredTemp
+  float probeTemps[READING_PROBE_MAX];  // Every contact probe in bus address order, NAN if unread
+  uint8_t probeCount;
+  float fusedTemp;              // Core temperature estimate from sensor_fusion.h, NAN if none
+  float confidence;             // 0-1
+  uint8_t infraredHealth;       // Sensor health scores at this reading, percent
+  uint8_t contactHealth;
+  uint64_t timestamp;           // ms since the Unix epoch, or since power-up until clockSynced
+  uint32_t seq;                 // Never reused by this device; 0 when none could be assigned
+  uint32_t seqEpoch;            // Numbering seq belongs to, see reading_sequence.h
+  bool isValid;
+  bool clockSynced;
+  MeasurementType measurementType;  // Which sensors fusedTemp draws on
+};
+
+#endif // READING_H
@@ -0,0 +1,87 @@
+#include "sampling.h"
+
+#include <math.h>
+
+// Copies the buffer into out[] in ascending order. Insertion sort is the
+// cheapest option for the handful of samples a measurement takes.
+static uint8_t sortedSamples(const SampleBuffer& buffer, float* out) {
+  for (uint8_t i = 0; i < buffer.count; i++) {
+    float value = buffer.samples[i];
+    int8_t j = i - 1;
+    while (j >= 0 && out[j] > value) {
+      out[j + 1] = out[j];
+      j--;
+    }
+    out[j + 1] = value;
+  }
+  return buffer.count;
+}
+
+void sampleBufferReset(SampleBuffer& buffer) {
+  buffer.head = 0;
+  buffer.count = 0;
+}
+
+void sampleBufferPush(SampleBuffer& buffer, float sample) {
+  buffer.samples[buffer.head] = sample;
+  buffer.head = (buffer.head + 1) % SAMPLE_BUFFER_CAPACITY;
+  if (buffer.count < SAMPLE_BUFFER_CAPACITY) {
+    buffer.count++;
+  }
+}
+
+float sampleBufferMedian(const SampleBuffer& buffer) {
+  if (buffer.count == 0) return NAN;
+
+  float sorted[SAMPLE_BUFFER_CAPACITY];
+  uint8_t n = sortedSamples(buffer, sorted);
+
+  if (n % 2 == 1) {
+    return sorted[n / 2];
+  }
+  return (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0f;
+}
+
+float sampleBufferTrimmedMean(const SampleBuffer& buffer, uint8_t trim) {
+  if (buffer.count == 0) return NAN;
+
+  float sorted[SAMPLE_BUFFER_CAPACITY];
+  uint8_t n = sortedSamples(buffer, sorted);
+
+  // Never trim away every sample; fall back to the plain mean
+  if (2 * trim >= n) {
+    trim = 0;
+  }
+
+  float sum = 0;
+  for (uint8_t i = trim; i < n - trim; i++) {
+    sum += sorted[i];
+  }
+  return sum / (n - 2 * trim);
+}
+
+float sampleBufferVariance(const SampleBuffer& buffer) {
+  if (buffer.count == 0) return NAN;
+  if (buffer.count == 1) return 0;
+
+  float mean = 0;
+  for (uint8_t i = 0; i < buffer.count; i++) {
+    mean += buffer.samples[i];
+  }
+  mean /= buffer.count;
+
+  // Two-pass sample variance, stable enough for body temperatures
+  float sumSquares = 0;
+  for (uint8_t i = 0; i < buffer.count; i++) {
+    float delta = buffer.samples[i] - mean;
+    sumSquares += delta * delta;
+  }
+  return sumSquares / (buffer.count - 1);
+}
+
+float sampleBufferFilter(const SampleBuffer& buffer, uint8_t mode, uint8_t trim) {
+  if (mode == FILTER_MODE_TRIMMED_MEAN) {
+    return sampleBufferTrimmedMean(buffer, trim);
+  }
+  return sampleBufferMedian(buffer);
+}
@@ -0,0 +1,29 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdint.h>
+
+// Fixed-capacity ring of raw sensor samples. Lives on the caller's stack or
+// in a static, never on the heap; once full the oldest sample is overwritten.
+#define SAMPLE_BUFFER_CAPACITY 16
+
+// Filters applied to a sample buffer to produce one reported value
+#define FILTER_MODE_MEDIAN 0
+#define FILTER_MODE_TRIMMED_MEAN 1
+
+struct SampleBuffer {
+  float samples[SAMPLE_BUFFER_CAPACITY];
+  uint8_t head;
+  uint8_t count;
+};
+
+void sampleBufferReset(SampleBuffer& buffer);
+void sampleBufferPush(SampleBuffer& buffer, float sample);
+
+// All statistics return NAN for an empty buffer
+float sampleBufferMedian(const SampleBuffer& buffer);
+float sampleBufferTrimmedMean(const SampleBuffer& buffer, uint8_t trim);
+float sampleBufferVariance(const SampleBuffer& buffer);
+float sampleBufferFilter(const SampleBuffer& buffer, uint8_t mode, uint8_t trim);
+
+#endif // SAMPLING_H
@@ -0,0 +1,121 @@
+#include "sensor_fusion.h"
+
+#include <math.h>
+
+#include "measurement.h"
+
+#define AMBIENT_MIN -10.0f
+#define AMBIENT_MAX 60.0f
+#define SETTLE_MIN_SPAN 1.0f   // min; shorter gaps would turn sensor quantisation into movement
+#define HEALTH_FLOOR 0.05f     // A valid reading always carries some weight
+
+static float clamp01(float value) {
+  if (value < 0) return 0;
+  if (value > 1) return 1;
+  return value;
+}
+
+static uint8_t toPercent(float value) {
+  return (uint8_t)roundf(clamp01(value) * 100.0f);
+}
+
+static void updateHealth(float& health, float quality, bool started, float alpha) {
+  health = started ? health + alpha * (quality - health) : quality;
+}
+
+void fusionReset(FusionState& state) {
+  state.infraredHealth = 0;
+  state.contactHealth = 0;
+  state.lastContact = NAN;
+  state.lastContactAt = 0;
+  state.started = false;
+}
+
+void fusionUpdate(FusionState& state, TemperatureReading& reading, unsigned long now,
+                  const FusionParams& params) {
+  bool infraredOk = validateTemperature(reading.infraredTemp);
+  bool contactOk = validateTemperature(reading.contactTemp);
+  bool ambientOk = reading.ambientTemp >= AMBIENT_MIN && reading.ambientTemp <= AMBIENT_MAX;
+
+  // Infrared quality falls with the spread of its samples, and is halved
+  // when there is no ambient value to compensate with
+  float infraredQuality = 0;
+  float infrared = NAN;
+  if (infraredOk) {
+    float variance = isnan(reading.infraredVariance) ? 0 : reading.infraredVariance;
+    infraredQuality = 1.0f / (1.0f + variance / params.irVarianceRef);
+    infrared = reading.infraredTemp;
+    if (ambientOk) {
+      infrared += params.irAmbientGain * (reading.infraredTemp - reading.ambientTemp);
+    } else {
+      infraredQuality *= 0.5f;
+    }
+  }
+
+  // Contact quality falls while the probe is still moving towards skin
+  // temperature
+  float contactQuality = 0;
+  if (contactOk) {
+    contactQuality = 1;
+    if (!isnan(state.lastContact)) {
+      float minutes = (now - state.lastContactAt) / 60000.0f;
+      if (minutes < SETTLE_MIN_SPAN) minutes = SETTLE_MIN_SPAN;
+      float rate = fabsf(reading.contactTemp - state.lastContact) / minutes;
+      if (rate > params.contactSettleRate) {
+        contactQuality = params.contactSettleRate / rate;
+      }
+    }
+    state.lastContact = reading.contactTemp;
+    state.lastContactAt = now;
+  } else {
+    state.lastContact = NAN;
+  }
+
+  updateHealth(state.infraredHealth, infraredQuality, state.started, params.healthAlpha);
+  updateHealth(state.contactHealth, contactQuality, state.started, params.healthAlpha);
+  state.started = true;
+  reading.infraredHealth = toPercent(state.infraredHealth);
+  reading.contactHealth = toPercent(state.contactHealth);
+
+  // Inverse-variance blend, each variance inflated by poor health
+  float infraredWeight = 0;
+  float contactWeight = 0;
+  if (infraredOk) {
+    float health = state.infraredHealth > HEALTH_FLOOR ? state.infraredHealth : HEALTH_FLOOR;
+    infraredWeight = health / (params.irSigma * params.irSigma);
+  }
+  if (contactOk) {
+    float health = state.contactHealth > HEALTH_FLOOR ? state.contactHealth : HEALTH_FLOOR;
+    contactWeight = health / (params.contactSigma * params.contactSigma);
+  }
+
+  float totalWeight = infraredWeight + contactWeight;
+  if (totalWeight <= 0) {
+    reading.fusedTemp = NAN;
+    reading.confidence = 0;
+    reading.isValid = false;
+    reading.measurementType = MEASUREMENT_COMBINED;
+    return;
+  }
+
+  float fused = 0;
+  if (infraredWeight > 0) fused += infraredWeight * infrared;
+  if (contactWeight > 0) fused += contactWeight * reading.contactTemp;
+  fused /= totalWeight;
+
+  float confidence = clamp01(1.0f - (1.0f / sqrtf(totalWeight)) / params.sigmaMax);
+  if (infraredWeight > 0 && contactWeight > 0) {
+    // Disagreement beyond the two sensors' combined uncertainty means at
+    // least one of them is wrong, and the blend can't tell which
+    float expected = sqrtf(params.irSigma * params.irSigma + params.contactSigma * params.contactSigma);
+    float difference = fabsf(infrared - reading.contactTemp);
+    if (difference > expected) confidence *= expected / difference;
+    reading.measurementType = MEASUREMENT_COMBINED;
+  } else {
+    reading.measurementType = contactWeight > 0 ? MEASUREMENT_CONTACT : MEASUREMENT_INFRARED;
+  }
+
+  reading.fusedTemp = fused;
+  reading.confidence = confidence;
+  reading.isValid = validateTemperature(fused);
+}
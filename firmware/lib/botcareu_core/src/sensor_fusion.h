@@ -0,0 +1,49 @@
+#ifndef SENSOR_FUSION_H
+#define SENSOR_FUSION_H
+
+#include <stdint.h>
+
+#include "reading.h"
+
+// Combines the infrared and contact temperatures of a reading into one
+// core temperature estimate with a confidence in [0, 1].
+//
+// The MLX90614 sees skin, which runs cooler than the core by more the
+// colder the room, so its object temperature is first raised by
+// irAmbientGain times the skin-to-ambient gradient. The compensated IR
+// value and the contact probe are then blended by inverse variance, each
+// sensor's weight scaled by its health.
+//
+// Health is a per-sensor score in [0, 1], smoothed over readings, of how
+// usable the sensor's recent values were: valid, steady IR samples; a
+// contact probe that reads and has settled rather than still warming up.
+// A sensor that fails a reading contributes nothing to it, whatever its
+// health. Confidence falls with the uncertainty of the blend, and further
+// when the two sensors disagree by more than their uncertainties explain.
+struct FusionParams {
+  float irAmbientGain;        // Core-to-skin offset per °C of skin-to-ambient gradient
+  float irSigma;              // °C, uncertainty of a compensated IR value
+  float contactSigma;         // °C, uncertainty of a settled contact value
+  float irVarianceRef;        // °C², IR sample variance at which IR quality halves
+  float contactSettleRate;    // °C/min of contact change above which the probe is settling
+  float healthAlpha;          // Weight of the newest reading in the health scores
+  float sigmaMax;             // °C of blended uncertainty at which confidence reaches 0
+};
+
+struct FusionState {
+  float infraredHealth;
+  float contactHealth;
+  float lastContact;          // NAN when the last reading had no contact value
+  unsigned long lastContactAt;  // ms
+  bool started;
+};
+
+void fusionReset(FusionState& state);
+
+// Sets fusedTemp, confidence, the health scores, isValid and
+// measurementType of reading from its infrared, ambient and contact values.
+// now is in ms.
+void fusionUpdate(FusionState& state, TemperatureReading& reading, unsigned long now,
+                  const FusionParams& params);
+
+#endif // SENSOR_FUSION_H
@@ -0,0 +1,31 @@
+#include "sensor_source.h"
+
+#include "measurement.h"
+#include "sampling.h"
+
+void sampleSensors(const SensorSource& sensors, const SamplingParams& params,
+                   TemperatureReading& reading) {
+  if (sensors.begin != NULL) {
+    sensors.begin(sensors.context);
+  }
+
+  SampleBuffer samples;
+  sampleBufferReset(samples);
+  for (uint8_t i = 0; i < params.samples; i++) {
+    if (i > 0 && sensors.waitSample != NULL) {
+      sensors.waitSample(sensors.context);
+    }
+    float sample = sensors.readInfrared(sensors.context);
+    if (validateTemperature(sample)) {
+      sampleBufferPush(samples, sample);
+    }
+  }
+
+  reading.ambientTemp = sensors.readAmbient(sensors.context);
+  resolveInfrared(reading, samples, params.samples, params.filterMode, params.filterTrim,
+                  params.infraredOffset);
+
+  float probes[READING_PROBE_MAX];
+  uint8_t count = sensors.readProbes(sensors.context, probes, READING_PROBE_MAX);
+  resolveProbes(reading, probes, count, params.primaryProbe, params.contactOffset);
+}
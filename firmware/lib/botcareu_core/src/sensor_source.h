@@ -0,0 +1,43 @@
+#ifndef SENSOR_SOURCE_H
+#define SENSOR_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reading.h"
+
+// The sensors a measurement reads, behind function pointers, so the same
+// sampling runs against the MLX90614 and DS18B20s on the device and
+// against scripted values on a host.
+//
+// begin() is called once per measurement, and is where the contact probes
+// start converting so the conversion overlaps the IR samples. The IR
+// sensor is then sampled params.samples times with waitSample() between
+// samples, the ambient value read once, and finally readProbes() collects
+// the converted probes, waiting out whatever is left of the conversion.
+// Every callback gets context back; begin and waitSample may be NULL.
+struct SensorSource {
+  void* context;
+  void (*begin)(void* context);
+  void (*waitSample)(void* context);
+  float (*readInfrared)(void* context);   // One object temperature sample, °C
+  float (*readAmbient)(void* context);    // °C
+  uint8_t (*readProbes)(void* context, float* raw, uint8_t maxProbes);  // Returns the count read
+};
+
+struct SamplingParams {
+  uint8_t samples;            // IR samples per measurement
+  uint8_t filterMode;         // FILTER_MODE_MEDIAN or FILTER_MODE_TRIMMED_MEAN
+  uint8_t filterTrim;
+  float infraredOffset;       // °C calibration
+  float contactOffset;        // °C calibration of the primary probe
+  uint8_t primaryProbe;
+};
+
+// Fills the infrared, ambient, contact and probe values of reading from
+// sensors. Out-of-range IR samples are dropped before filtering. The fused
+// value is left to fusionUpdate().
+void sampleSensors(const SensorSource& sensors, const SamplingParams& params,
+                   TemperatureReading& reading);
+
+#endif // SENSOR_SOURCE_H
@@ -0,0 +1,291 @@
+#include "telemetry_codec.h"
+
+#include <ArduinoJson.h>
+#include <math.h>
+#include <string.h>
+
+#include "measurement.h"
+
+// Reading flag bits
+#define READING_FLAG_VALID 0x01
+#define READING_FLAG_TYPE_SHIFT 1   // Two bits of MeasurementType
+#define READING_FLAG_CLOCK_SYNCED 0x08
+
+// Status flag bits
+#define STATUS_FLAG_SENSORS_READY 0x01
+#define STATUS_FLAG_TREND 0x02
+#define STATUS_FLAG_FEVER_ONSET 0x04
+#define STATUS_FLAG_HEALTH 0x08
+
+static uint8_t* putU16(uint8_t* p, uint16_t value) {
+  p[0] = value & 0xFF;
+  p[1] = value >> 8;
+  return p + 2;
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0xFF;
+  p[3] = value >> 24;
+  return p + 4;
+}
+
+static uint8_t* putU48(uint8_t* p, uint64_t value) {
+  for (uint8_t i = 0; i < 6; i++) {
+    p[i] = (value >> (8 * i)) & 0xFF;
+  }
+  return p + 6;
+}
+
+static uint8_t* putVarint(uint8_t* p, uint64_t value) {
+  while (value >= 0x80) {
+    *p++ = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  *p++ = value;
+  return p;
+}
+
+static uint64_t zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static uint8_t* putString(uint8_t* p, const char* value, uint8_t maxLength) {
+  size_t length = value ? strlen(value) : 0;
+  if (length > maxLength) length = maxLength;
+  *p++ = (uint8_t)length;
+  if (length > 0) {
+    memcpy(p, value, length);
+    p += length;
+  }
+  return p;
+}
+
+static int16_t toCentiDegrees(float temp) {
+  if (isnan(temp)) return TELEMETRY_TEMP_MISSING;
+
+  float scaled = roundf(temp * 100.0f);
+  if (scaled > INT16_MAX) return INT16_MAX;
+  if (scaled <= INT16_MIN) return INT16_MIN + 1;
+  return (int16_t)scaled;
+}
+
+static uint8_t toPercent(float fraction) {
+  if (isnan(fraction) || fraction <= 0) return 0;
+  if (fraction >= 1) return 100;
+  return (uint8_t)roundf(fraction * 100.0f);
+}
+
+// Rounded for JSON, so a confidence doesn't serialize as nine digits
+static float roundTo(float value, float step) {
+  return roundf(value / step) * step;
+}
+
+static uint16_t toMillivolts(float volts) {
+  if (isnan(volts) || volts <= 0) return 0;
+  float mv = roundf(volts * 1000.0f);
+  return mv > UINT16_MAX ? UINT16_MAX : (uint16_t)mv;
+}
+
+// Variance is carried in units of 1e-4 degC^2, saturating at ~6.5
+static uint16_t toVarianceUnits(float variance) {
+  if (isnan(variance)) return UINT16_MAX;
+  float scaled = roundf(variance * 10000.0f);
+  return scaled > UINT16_MAX ? UINT16_MAX : (uint16_t)scaled;
+}
+
+static int16_t toMilliDegreesPerMinute(float slope) {
+  float scaled = roundf(slope * 1000.0f);
+  if (scaled > INT16_MAX) return INT16_MAX;
+  if (scaled < -INT16_MAX) return -INT16_MAX;
+  return (int16_t)scaled;
+}
+
+static uint8_t readingFlags(const TemperatureReading& reading) {
+  return (reading.isValid ? READING_FLAG_VALID : 0) |
+         ((reading.measurementType & 0x03) << READING_FLAG_TYPE_SHIFT) |
+         (reading.clockSynced ? READING_FLAG_CLOCK_SYNCED : 0);
+}
+
+size_t encodeReadingFrame(const TemperatureReading& reading, float batteryVoltage,
+                          int8_t signalStrength, uint8_t* out, size_t capacity) {
+  if (capacity < READING_FRAME_SIZE) return 0;
+
+  uint8_t* p = out;
+  *p++ = TELEMETRY_BINARY_VERSION;
+  *p++ = readingFlags(reading);
+  p = putU32(p, reading.seq);
+  p = putU32(p, reading.seqEpoch);
+  p = putU48(p, reading.timestamp);
+  p = putU16(p, (uint16_t)toCentiDegrees(reading.infraredTemp));
+  p = putU16(p, (uint16_t)toCentiDegrees(reading.contactTemp));
+  p = putU16(p, (uint16_t)toCentiDegrees(reading.ambientTemp));
+  p = putU16(p, toVarianceUnits(reading.infraredVariance));
+  p = putU16(p, toMillivolts(batteryVoltage));
+  *p++ = (uint8_t)signalStrength;
+  *p++ = reading.probeCount;
+  for (uint8_t i = 0; i < READING_PROBE_MAX; i++) {
+    float probe = i < reading.probeCount ? reading.probeTemps[i] : NAN;
+    p = putU16(p, (uint16_t)toCentiDegrees(probe));
+  }
+  p = putU16(p, (uint16_t)toCentiDegrees(reading.fusedTemp));
+  *p++ = toPercent(reading.confidence);
+
+  return p - out;
+}
+
+size_t encodeStatusFrame(const StatusFrame& status, uint8_t* out, size_t capacity) {
+  size_t versionLength = status.firmwareVersion ? strlen(status.firmwareVersion) : 0;
+  if (versionLength > STATUS_VERSION_MAX) {
+    versionLength = STATUS_VERSION_MAX;
+  }
+  const TrendStats* trend = status.trend && status.trend->samples > 0 ? status.trend : NULL;
+  size_t trendLength = trend ? STATUS_TREND_SIZE : 0;
+  size_t healthLength = status.hasHealth ? STATUS_HEALTH_SIZE : 0;
+  if (capacity < STATUS_FRAME_FIXED_SIZE + versionLength + trendLength + healthLength) return 0;
+
+  uint8_t flags = status.sensorsReady ? STATUS_FLAG_SENSORS_READY : 0;
+  if (status.hasHealth) flags |= STATUS_FLAG_HEALTH;
+  if (trend) {
+    flags |= STATUS_FLAG_TREND;
+    if (trend->onset) flags |= STATUS_FLAG_FEVER_ONSET;
+  }
+
+  uint8_t* p = out;
+  *p++ = TELEMETRY_BINARY_VERSION;
+  *p++ = flags;
+  p = putU32(p, status.uptime);
+  p = putU16(p, toMillivolts(status.batteryVoltage));
+  *p++ = (uint8_t)status.signalStrength;
+  p = putU32(p, status.freeMemory);
+  p = putU32(p, status.minFreeMemory);
+  p = putU32(p, status.maxAllocMemory);
+  *p++ = (uint8_t)versionLength;
+  if (versionLength > 0) {
+    memcpy(p, status.firmwareVersion, versionLength);
+    p += versionLength;
+  }
+
+  if (trend) {
+    p = putU16(p, (uint16_t)toCentiDegrees(trend->ewma));
+    p = putU16(p, (uint16_t)toCentiDegrees(trend->minTemperature));
+    p = putU16(p, (uint16_t)toCentiDegrees(trend->maxTemperature));
+    p = putU16(p, (uint16_t)toMilliDegreesPerMinute(trend->slope));
+    p = putU32(p, trend->feverTime / 1000);
+    p = putU32(p, trend->samples);
+  }
+
+  if (status.hasHealth) {
+    *p++ = status.infraredHealth;
+    *p++ = status.contactHealth;
+  }
+
+  return p - out;
+}
+
+size_t encodeReadingBatch(const TelemetrySource& source, const TemperatureReading* readings,
+                          uint8_t count, uint8_t* out, size_t capacity) {
+  if (count == 0 || count > READING_BATCH_MAX) return 0;
+  if (capacity < BATCH_HEADER_MAX_SIZE + (size_t)count * BATCH_ENTRY_MAX_SIZE) return 0;
+
+  uint32_t baseSeq = readings[0].seq;
+  uint64_t baseTimestamp = readings[0].timestamp;
+
+  uint8_t* p = out;
+  *p++ = TELEMETRY_BINARY_VERSION;
+  p = putString(p, source.deviceId, BATCH_STRING_MAX);
+  p = putString(p, source.firmwareVersion, BATCH_STRING_MAX);
+  p = putU16(p, toMillivolts(source.batteryVoltage));
+  *p++ = (uint8_t)source.signalStrength;
+  p = putU32(p, baseSeq);
+  p = putU32(p, readings[0].seqEpoch);
+  p = putU48(p, baseTimestamp);
+  *p++ = count;
+
+  uint32_t previousSeq = baseSeq;
+  uint64_t previousTimestamp = baseTimestamp;
+  int32_t previousInfrared = 0;
+  int32_t previousContact = 0;
+  int32_t previousAmbient = 0;
+  int32_t previousProbes[READING_PROBE_MAX] = {0};
+  int32_t previousFused = 0;
+
+  for (uint8_t i = 0; i < count; i++) {
+    const TemperatureReading& reading = readings[i];
+    int32_t infrared = toCentiDegrees(reading.infraredTemp);
+    int32_t contact = toCentiDegrees(reading.contactTemp);
+    int32_t ambient = toCentiDegrees(reading.ambientTemp);
+
+    *p++ = readingFlags(reading);
+    // Signed, since a reading taken before the clock synced may sit next
+    // to one taken after
+    p = putVarint(p, reading.seq - previousSeq);
+    p = putVarint(p, zigzag((int64_t)(reading.timestamp - previousTimestamp)));
+    p = putVarint(p, zigzag(infrared - previousInfrared));
+    p = putVarint(p, zigzag(contact - previousContact));
+    p = putVarint(p, zigzag(ambient - previousAmbient));
+    p = putVarint(p, toVarianceUnits(reading.infraredVariance));
+
+    uint8_t probeCount = reading.probeCount < READING_PROBE_MAX ? reading.probeCount : READING_PROBE_MAX;
+    *p++ = probeCount;
+    for (uint8_t j = 0; j < probeCount; j++) {
+      int32_t probe = toCentiDegrees(reading.probeTemps[j]);
+      p = putVarint(p, zigzag(probe - previousProbes[j]));
+      previousProbes[j] = probe;
+    }
+
+    int32_t fused = toCentiDegrees(reading.fusedTemp);
+    p = putVarint(p, zigzag(fused - previousFused));
+    *p++ = toPercent(reading.confidence);
+    previousFused = fused;
+
+    previousSeq = reading.seq;
+    previousTimestamp = reading.timestamp;
+    previousInfrared = infrared;
+    previousContact = contact;
+    previousAmbient = ambient;
+  }
+
+  return p - out;
+}
+
+size_t encodeReadingJson(const TemperatureReading& reading, const TelemetrySource& source,
+                         bool includeRaw, char* out, size_t capacity) {
+  // const char* values are stored by reference, so the document never copies
+  // strings. Sized in slots rather than bytes, which differ between the
+  // device and a 64-bit host.
+  StaticJsonDocument<JSON_OBJECT_SIZE(15) + JSON_ARRAY_SIZE(READING_PROBE_MAX) + JSON_OBJECT_SIZE(3)> doc;
+  doc["deviceId"] = source.deviceId;
+  doc["temperature"] = roundTo(reading.fusedTemp, 0.01f);
+  doc["confidence"] = roundTo(reading.confidence, 0.01f);
+  if (includeRaw) {
+    doc["infraredTemp"] = reading.infraredTemp;
+    doc["contactTemp"] = reading.contactTemp;
+    doc["ambientTemp"] = reading.ambientTemp;
+    doc["infraredVariance"] = reading.infraredVariance;
+  }
+  doc["measurementType"] = measurementTypeName(reading.measurementType);
+  doc["seq"] = reading.seq;
+  doc["seqEpoch"] = reading.seqEpoch;
+  doc["timestamp"] = reading.timestamp;
+  doc["clockSynced"] = reading.clockSynced;
+  doc["isValid"] = reading.isValid;
+
+  // One channel per contact probe, in bus address order
+  if (reading.probeCount > 0) {
+    JsonArray probes = doc.createNestedArray("probes");
+    for (uint8_t i = 0; i < reading.probeCount && i < READING_PROBE_MAX; i++) {
+      probes.add(reading.probeTemps[i]);
+    }
+  }
+
+  // Add metadata
+  JsonObject metadata = doc.createNestedObject("metadata");
+  metadata["batteryLevel"] = source.batteryVoltage;
+  metadata["signalStrength"] = source.signalStrength;
+  metadata["firmwareVersion"] = source.firmwareVersion;
+
+  if (measureJson(doc) >= capacity) return 0;
+  return serializeJson(doc, out, capacity);
+}
@@ -0,0 +1,100 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reading.h"
+#include "trend.h"
+
+// Payload formats selectable per device through the /config topic
+#define TELEMETRY_FORMAT_JSON 0
+#define TELEMETRY_FORMAT_BINARY 1
+
+// Binary frames are little-endian and start with a version byte so the
+// backend decoder (backend/src/utils/telemetryCodec.js) can evolve with them.
+// Temperatures are signed centi-degrees; TELEMETRY_TEMP_MISSING marks a
+// failed or absent sensor. Reading timestamps are 48-bit milliseconds:
+// since the Unix epoch when the reading's clock-synced flag is set, since
+// the device powered up otherwise.
+#define TELEMETRY_BINARY_VERSION 5
+#define TELEMETRY_TEMP_MISSING INT16_MIN
+
+// version(1) flags(1) seq(4) seq epoch(4) timestamp(6) ir(2) contact(2)
+// ambient(2) variance(2) battery mV(2) rssi(1) probe count(1),
+// READING_PROBE_MAX probe channels(2 each), unused ones
+// TELEMETRY_TEMP_MISSING, then the fused temperature(2) and its confidence
+// in percent(1)
+#define READING_FRAME_SIZE (31 + 2 * READING_PROBE_MAX)
+
+// Room for a JSON reading with raw values, every probe channel and full
+// float digits, about 470 bytes
+#define READING_JSON_MAX_SIZE 512
+
+// version(1) flags(1) uptime(4) battery mV(2) rssi(1) freeMemory(4)
+// minFreeMemory(4) maxAllocMemory(4) firmware length(1) + firmware bytes,
+// then when the trend flag is set: ewma(2) min(2) max(2) slope in
+// milli-degrees per minute(2) fever seconds(4) samples(4), then when the
+// health flag is set: infrared health(1) contact health(1) in percent
+#define STATUS_FRAME_FIXED_SIZE 22
+#define STATUS_VERSION_MAX 32
+#define STATUS_TREND_SIZE 16
+#define STATUS_HEALTH_SIZE 2
+#define STATUS_FRAME_MAX_SIZE (STATUS_FRAME_FIXED_SIZE + STATUS_VERSION_MAX + STATUS_TREND_SIZE + \
+                               STATUS_HEALTH_SIZE)
+
+// Batch frame, several readings in one message:
+//   version(1) deviceId length(1)+bytes firmware length(1)+bytes
+//   battery mV(2) rssi(1) base seq(4) seq epoch(4) base timestamp(6)
+//   count(1)
+// then per reading: flags(1) followed by varints of the seq delta, the
+// zigzag timestamp delta in ms, the zigzag deltas of the three temperatures
+// in centi-degrees and the variance, the probe count(1) and varints of the
+// zigzag deltas of each probe channel, then a varint of the zigzag delta of
+// the fused temperature and the confidence in percent(1). The first reading
+// deltas against the base seq and timestamp and zero temperatures. A steady
+// patient with one probe costs about 13 bytes per reading. Every reading
+// in a batch shares the first one's seq epoch.
+#define READING_BATCH_MAX 32
+#define BATCH_STRING_MAX 32
+#define BATCH_HEADER_MAX_SIZE (1 + 2 * (1 + BATCH_STRING_MAX) + 2 + 1 + 4 + 4 + 6 + 1)
+#define BATCH_ENTRY_MAX_SIZE (1 + 5 + 10 + 3 * 5 + 3 + 1 + READING_PROBE_MAX * 3 + 3 + 1)
+#define BATCH_FRAME_MAX_SIZE (BATCH_HEADER_MAX_SIZE + READING_BATCH_MAX * BATCH_ENTRY_MAX_SIZE)
+
+// Who sent a reading: carried in the batch header and the JSON metadata
+struct TelemetrySource {
+  const char* deviceId;
+  const char* firmwareVersion;
+  float batteryVoltage;
+  int8_t signalStrength;
+};
+
+struct StatusFrame {
+  bool sensorsReady;
+  float batteryVoltage;
+  int8_t signalStrength;
+  uint32_t uptime;
+  uint32_t freeMemory;
+  uint32_t minFreeMemory;
+  uint32_t maxAllocMemory;
+  const char* firmwareVersion;
+  const TrendStats* trend;      // NULL leaves the trend out
+  bool hasHealth;               // Sensor health below is known
+  uint8_t infraredHealth;       // Percent
+  uint8_t contactHealth;
+};
+
+// Both encoders return the number of bytes written, or 0 if capacity is too small
+size_t encodeReadingFrame(const TemperatureReading& reading, float batteryVoltage,
+                          int8_t signalStrength, uint8_t* out, size_t capacity);
+size_t encodeStatusFrame(const StatusFrame& status, uint8_t* out, size_t capacity);
+size_t encodeReadingBatch(const TelemetrySource& source, const TemperatureReading* readings,
+                          uint8_t count, uint8_t* out, size_t capacity);
+
+// JSON reading for the text topic, also returning 0 if capacity is too small.
+// It carries the fused temperature; the raw sensor values behind it only
+// with includeRaw.
+size_t encodeReadingJson(const TemperatureReading& reading, const TelemetrySource& source,
+                         bool includeRaw, char* out, size_t capacity);
+
+#endif // TELEMETRY_CODEC_H
@@ -0,0 +1,23 @@
+#include "telemetry_transport.h"
+
+bool publishReading(const TelemetryTransport& transport, const ReadingTopics& topics,
+                    const TemperatureReading& reading, const TelemetrySource& source,
+                    uint8_t format, bool includeRaw) {
+  uint8_t payload[READING_JSON_MAX_SIZE + TELEMETRY_TRANSPORT_RESERVE];
+  const char* topic;
+  size_t length;
+
+  // The compact frame leaves out the device ID, which is in the topic, and
+  // the firmware version, which travels with the heartbeat
+  if (format == TELEMETRY_FORMAT_BINARY) {
+    topic = topics.binary;
+    length = encodeReadingFrame(reading, source.batteryVoltage, source.signalStrength,
+                                payload, READING_FRAME_SIZE);
+  } else {
+    topic = topics.json;
+    length = encodeReadingJson(reading, source, includeRaw, (char*)payload, READING_JSON_MAX_SIZE);
+  }
+  if (length == 0) return false;
+
+  return transport.publish(transport.context, topic, payload, length, sizeof(payload));
+}
@@ -0,0 +1,34 @@
+#ifndef TELEMETRY_TRANSPORT_H
+#define TELEMETRY_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reading.h"
+#include "telemetry_codec.h"
+
+// Where encoded readings go: MQTT on the device, a recording fake on a
+// host. publish() gets the payload in a buffer of capacity bytes and may
+// grow it in place up to that, as payload sealing does; capacity leaves
+// TELEMETRY_TRANSPORT_RESERVE bytes past the largest payload for that.
+#define TELEMETRY_TRANSPORT_RESERVE 32
+
+struct TelemetryTransport {
+  void* context;
+  bool (*publish)(void* context, const char* topic, uint8_t* payload, size_t length,
+                  size_t capacity);
+};
+
+struct ReadingTopics {
+  const char* json;
+  const char* binary;
+};
+
+// Encodes reading in format (TELEMETRY_FORMAT_JSON or _BINARY) on the
+// stack and hands it to the transport. Returns false if it didn't encode
+// or the transport refused it.
+bool publishReading(const TelemetryTransport& transport, const ReadingTopics& topics,
+                    const TemperatureReading& reading, const TelemetrySource& source,
+                    uint8_t format, bool includeRaw);
+
+#endif // TELEMETRY_TRANSPORT_H
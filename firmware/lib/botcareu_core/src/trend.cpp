@@ -0,0 +1,100 @@
+#include "trend.h"
+
+#include <math.h>
+#include <string.h>
+
+static void addToSums(TrendStats& stats, float t, float y) {
+  stats.sumT += t;
+  stats.sumY += y;
+  stats.sumTT += (double)t * t;
+  stats.sumTY += (double)t * y;
+}
+
+// Moves the origin to the oldest reading in the window and recomputes the
+// sums from scratch. Called once per wrap, so updates stay O(1) amortised.
+static void rebuildWindow(TrendStats& stats) {
+  uint8_t oldest = stats.windowCount < TREND_WINDOW ? 0 : stats.windowHead;
+  unsigned long shiftMs = (unsigned long)(stats.windowTime[oldest] * 1000.0f);
+  float shift = shiftMs / 1000.0f;
+  stats.origin += shiftMs;
+
+  stats.sumT = stats.sumY = stats.sumTT = stats.sumTY = 0;
+  for (uint8_t i = 0; i < stats.windowCount; i++) {
+    stats.windowTime[i] -= shift;
+    addToSums(stats, stats.windowTime[i], stats.windowTemperature[i]);
+  }
+}
+
+static float windowSlope(const TrendStats& stats) {
+  if (stats.windowCount < 2) return 0;
+
+  double n = stats.windowCount;
+  double denominator = n * stats.sumTT - stats.sumT * stats.sumT;
+  if (denominator <= 1e-6) return 0;
+
+  return (float)((n * stats.sumTY - stats.sumT * stats.sumY) / denominator * 60.0);
+}
+
+void trendReset(TrendStats& stats) {
+  memset(&stats, 0, sizeof(stats));
+}
+
+bool trendUpdate(TrendStats& stats, float temperature, unsigned long now,
+                 const TrendParams& params) {
+  if (stats.samples == 0) {
+    stats.ewma = temperature;
+    stats.minTemperature = temperature;
+    stats.maxTemperature = temperature;
+    stats.origin = now;
+  } else {
+    unsigned long elapsed = now - stats.lastAt;
+    float alpha = 1.0f - expf(-(float)elapsed / (float)params.ewmaTimeConstant);
+    stats.ewma += alpha * (temperature - stats.ewma);
+
+    // The interval up to this reading counts as fever if the last one was
+    if (stats.lastFever) stats.feverTime += elapsed;
+    if (temperature < stats.minTemperature) stats.minTemperature = temperature;
+    if (temperature > stats.maxTemperature) stats.maxTemperature = temperature;
+  }
+  stats.samples++;
+  stats.lastAt = now;
+  stats.lastFever = temperature >= params.feverThreshold;
+
+  // Replace the oldest reading once the window is full
+  float t = (now - stats.origin) / 1000.0f;
+  if (stats.windowCount == TREND_WINDOW) {
+    float oldT = stats.windowTime[stats.windowHead];
+    float oldY = stats.windowTemperature[stats.windowHead];
+    stats.sumT -= oldT;
+    stats.sumY -= oldY;
+    stats.sumTT -= (double)oldT * oldT;
+    stats.sumTY -= (double)oldT * oldY;
+  } else {
+    stats.windowCount++;
+  }
+  stats.windowTime[stats.windowHead] = t;
+  stats.windowTemperature[stats.windowHead] = temperature;
+  addToSums(stats, t, temperature);
+  stats.windowHead = (stats.windowHead + 1) % TREND_WINDOW;
+
+  if (stats.windowHead == 0) {
+    rebuildWindow(stats);
+  }
+  stats.slope = windowSlope(stats);
+
+  // A rise that has already crossed the threshold is the fever alert's job
+  if (stats.ewma < params.feverThreshold - params.onsetMargin) {
+    stats.onset = false;
+    return false;
+  }
+  if (stats.onset) return false;
+  if (temperature >= params.feverThreshold) {
+    stats.onset = true;
+    return false;
+  }
+  if (stats.windowCount >= params.onsetMinSamples && stats.slope >= params.onsetSlope) {
+    stats.onset = true;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,59 @@
+#ifndef TREND_H
+#define TREND_H
+
+#include <stdint.h>
+
+// Running statistics over the primary temperature, updated in O(1) per
+// reading and reported with the status heartbeat.
+//
+// The EWMA decays with elapsed time rather than per reading, so it means
+// the same thing whether the adaptive schedule samples every few seconds
+// or every few minutes. The slope is a least-squares fit over the last
+// TREND_WINDOW readings, kept as running sums that are rebuilt from the
+// window every time it wraps so rounding can't accumulate.
+//
+// A fever onset is flagged when the smoothed temperature is within
+// onsetMargin of the fever threshold and the window slope is at least
+// onsetSlope. It stays latched until the EWMA drops back out of that band,
+// so one rise raises one onset.
+#define TREND_WINDOW 16
+
+struct TrendParams {
+  uint32_t ewmaTimeConstant;  // ms
+  float feverThreshold;
+  float onsetMargin;          // °C below feverThreshold where onsets are detected
+  float onsetSlope;           // °C per minute
+  uint8_t onsetMinSamples;    // Window readings needed before the slope is trusted
+};
+
+struct TrendStats {
+  float ewma;
+  float minTemperature;         // Since boot
+  float maxTemperature;
+  float slope;                  // °C per minute over the window
+  uint32_t samples;             // Readings since boot
+  uint32_t feverTime;           // ms spent at or above the fever threshold
+  bool onset;
+
+  unsigned long lastAt;         // ms
+  bool lastFever;
+
+  // Sliding window, times in seconds relative to origin
+  float windowTemperature[TREND_WINDOW];
+  float windowTime[TREND_WINDOW];
+  uint8_t windowHead;
+  uint8_t windowCount;
+  unsigned long origin;         // ms
+  double sumT;
+  double sumY;
+  double sumTT;
+  double sumTY;
+};
+
+void trendReset(TrendStats& stats);
+
+// Adds a reading taken at now. Returns true when it starts a fever onset.
+bool trendUpdate(TrendStats& stats, float temperature, unsigned long now,
+                 const TrendParams& params);
+
+#endif // TREND_H
@@ -0,0 +1,100 @@
+#include "ble_thermometer.h"
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "health_thermometer.h"
+#include "device_log.h"
+
+static NimBLEServer* server = NULL;
+static NimBLECharacteristic* measurementCharacteristic = NULL;
+static NimBLECharacteristic* intermediateCharacteristic = NULL;
+static NimBLECharacteristic* intervalCharacteristic = NULL;
+static volatile uint8_t connectedClients = 0;
+
+class ServerCallbacks : public NimBLEServerCallbacks {
+  void onConnect(NimBLEServer* server, ble_gap_conn_desc* desc) override {
+    connectedClients++;
+    // Phones connect with 30-50 ms intervals; ask for ours
+    server->updateConnParams(desc->conn_handle, BLE_CONN_INTERVAL_MIN, BLE_CONN_INTERVAL_MAX,
+                             BLE_CONN_LATENCY, BLE_SUPERVISION_TIMEOUT);
+    LOG_INFO("BLE client connected");
+  }
+
+  void onDisconnect(NimBLEServer* server) override {
+    if (connectedClients > 0) connectedClients--;
+    LOG_INFO("BLE client disconnected");
+  }
+};
+
+// A new subscriber gets the last reading straight away rather than waiting
+// out the measurement interval
+class SubscribeCallbacks : public NimBLECharacteristicCallbacks {
+  void onSubscribe(NimBLECharacteristic* characteristic, ble_gap_conn_desc* desc,
+                   uint16_t subValue) override {
+    if (subValue != 0 && characteristic->getDataLength() > 0) {
+      characteristic->notify(subValue & 0x0001);
+    }
+  }
+};
+
+static ServerCallbacks serverCallbacks;
+static SubscribeCallbacks subscribeCallbacks;
+
+void bleThermometerBegin(const char* name) {
+  NimBLEDevice::init(name);
+  NimBLEDevice::setMTU(BLE_MTU);
+
+  server = NimBLEDevice::createServer();
+  server->setCallbacks(&serverCallbacks);
+  server->advertiseOnDisconnect(true);
+
+  NimBLEService* service = server->createService(NimBLEUUID((uint16_t)HTS_SERVICE_UUID));
+  measurementCharacteristic = service->createCharacteristic(
+      NimBLEUUID((uint16_t)HTS_TEMPERATURE_MEASUREMENT_UUID), NIMBLE_PROPERTY::INDICATE);
+  intermediateCharacteristic = service->createCharacteristic(
+      NimBLEUUID((uint16_t)HTS_INTERMEDIATE_TEMPERATURE_UUID), NIMBLE_PROPERTY::NOTIFY);
+  NimBLECharacteristic* type = service->createCharacteristic(
+      NimBLEUUID((uint16_t)HTS_TEMPERATURE_TYPE_UUID), NIMBLE_PROPERTY::READ);
+  intervalCharacteristic = service->createCharacteristic(
+      NimBLEUUID((uint16_t)HTS_MEASUREMENT_INTERVAL_UUID), NIMBLE_PROPERTY::READ);
+
+  uint8_t bodyType = HTS_TYPE_BODY;
+  type->setValue(&bodyType, 1);
+  measurementCharacteristic->setCallbacks(&subscribeCallbacks);
+  intermediateCharacteristic->setCallbacks(&subscribeCallbacks);
+  service->start();
+
+  NimBLEAdvertising* advertising = NimBLEDevice::getAdvertising();
+  advertising->addServiceUUID(NimBLEUUID((uint16_t)HTS_SERVICE_UUID));
+  advertising->setScanResponse(true);
+  advertising->setMinInterval(BLE_ADV_INTERVAL_MIN);
+  advertising->setMaxInterval(BLE_ADV_INTERVAL_MAX);
+  advertising->start();
+
+  LOG_INFO("BLE advertising as %s", name);
+}
+
+void bleThermometerPublish(const TemperatureReading& reading, uint32_t intervalMs) {
+  if (server == NULL) return;
+
+  uint8_t value[HTS_MEASUREMENT_MAX_SIZE];
+  size_t length = encodeHealthThermometerMeasurement(reading, value, sizeof(value));
+  if (length == 0) return;
+
+  uint32_t seconds = intervalMs / 1000;
+  uint8_t interval[2] = {(uint8_t)(seconds & 0xFF), (uint8_t)((seconds >> 8) & 0xFF)};
+  if (seconds > 0xFFFF) interval[0] = interval[1] = 0xFF;
+  intervalCharacteristic->setValue(interval, sizeof(interval));
+
+  // Values are kept for new subscribers even when nobody is listening now
+  measurementCharacteristic->setValue(value, length);
+  intermediateCharacteristic->setValue(value, length);
+  if (connectedClients == 0) return;
+  intermediateCharacteristic->notify();
+  measurementCharacteristic->indicate();
+}
+
+bool bleThermometerConnected() {
+  return connectedClients > 0;
+}
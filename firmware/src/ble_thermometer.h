@@ -0,0 +1,37 @@
+#ifndef BLE_THERMOMETER_H
+#define BLE_THERMOMETER_H
+
+#include <stdint.h>
+
+#include "reading.h"
+
+// Local streaming of readings to a phone at the bedside over a BLE GATT
+// server with the standard Health Thermometer service (health_thermometer.h).
+// Readings reach the app one connection interval after they are taken,
+// whether or not WiFi and the broker are up.
+//
+// Built on NimBLE, whose host needs about half the RAM of Bluedroid next to
+// the WiFi and TLS stacks. The radio is shared with WiFi by time slicing:
+// the connection interval asked of the central is short enough for
+// sub-second delivery but leaves most slots to WiFi, and advertising only
+// runs while nobody is connected.
+#define BLE_CONN_INTERVAL_MIN 12       // 1.25 ms units, 15 ms
+#define BLE_CONN_INTERVAL_MAX 24       // 30 ms
+#define BLE_CONN_LATENCY 0             // Connection events the peripheral may skip
+#define BLE_SUPERVISION_TIMEOUT 400    // 10 ms units, 4 s
+#define BLE_ADV_INTERVAL_MIN 160       // 0.625 ms units, 100 ms
+#define BLE_ADV_INTERVAL_MAX 240       // 150 ms
+#define BLE_MTU 64                     // A measurement fits the default 23; room for a timestamp and more
+
+// Starts the GATT server and advertising under name, which goes in the scan
+// response. Until this is called all other calls are no-ops.
+void bleThermometerBegin(const char* name);
+
+// Notifies the intermediate temperature and indicates the measurement to
+// subscribed clients; intervalMs is the current measurement interval
+void bleThermometerPublish(const TemperatureReading& reading, uint32_t intervalMs);
+
+// A client is connected, so the device shouldn't sleep yet
+bool bleThermometerConnected();
+
+#endif // BLE_THERMOMETER_H
@@ -0,0 +1,109 @@
+#include "buzzer.h"
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/timers.h>
+
+struct BuzzerNote {
+  uint16_t frequency;   // Hz, 0 is a rest
+  uint16_t duration;    // ms
+};
+
+static const BuzzerNote chirpNotes[] = {{1000, 100}};
+static const BuzzerNote startupNotes[] = {{1000, 100}, {0, 100}, {1500, 100}};
+static const BuzzerNote moderateNotes[] = {{2000, 300}, {0, 200}, {2000, 300}};
+static const BuzzerNote highNotes[] = {
+  {2000, 400}, {0, 150}, {2000, 400}, {0, 150}, {2000, 400}
+};
+static const BuzzerNote criticalNotes[] = {
+  {2500, 150}, {0, 100}, {2500, 150}, {0, 100}, {2500, 150}, {0, 100},
+  {2500, 150}, {0, 100}, {2500, 150}, {0, 100}, {2500, 150}
+};
+
+#define PATTERN(notes) {notes, sizeof(notes) / sizeof(notes[0])}
+
+static const struct {
+  const BuzzerNote* notes;
+  uint8_t count;
+} patterns[BUZZER_PATTERN_COUNT] = {
+  PATTERN(chirpNotes),
+  PATTERN(startupNotes),
+  PATTERN(moderateNotes),
+  PATTERN(highNotes),
+  PATTERN(criticalNotes)
+};
+
+static uint8_t buzzerPin = 0;
+static TimerHandle_t buzzerTimer = NULL;
+static portMUX_TYPE buzzerMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Current pattern and the index of the note to start next, guarded by
+// buzzerMux. Only the timer callback touches the pin.
+static volatile bool playing = false;
+static BuzzerPattern current = BUZZER_CHIRP;
+static uint8_t nextNote = 0;
+
+static void buzzerStep(TimerHandle_t timer) {
+  BuzzerNote note = {0, 0};
+  bool done;
+
+  portENTER_CRITICAL(&buzzerMux);
+  done = !playing || nextNote >= patterns[current].count;
+  if (done) {
+    playing = false;
+  } else {
+    note = patterns[current].notes[nextNote++];
+  }
+  portEXIT_CRITICAL(&buzzerMux);
+
+  if (done) {
+    noTone(buzzerPin);
+    return;
+  }
+
+  if (note.frequency > 0) {
+    tone(buzzerPin, note.frequency);
+  } else {
+    noTone(buzzerPin);
+  }
+  xTimerChangePeriod(timer, pdMS_TO_TICKS(note.duration), 0);
+}
+
+void buzzerBegin(uint8_t pin) {
+  buzzerPin = pin;
+  pinMode(pin, OUTPUT);
+  buzzerTimer = xTimerCreate("buzzer", 1, pdFALSE, NULL, buzzerStep);
+}
+
+void buzzerPlay(BuzzerPattern pattern) {
+  if (buzzerTimer == NULL || pattern >= BUZZER_PATTERN_COUNT) return;
+
+  portENTER_CRITICAL(&buzzerMux);
+  bool start = !playing || pattern >= current;
+  if (start) {
+    current = pattern;
+    nextNote = 0;
+    playing = true;
+  }
+  portEXIT_CRITICAL(&buzzerMux);
+
+  // The first note starts on the timer task a tick from now
+  if (start) {
+    xTimerChangePeriod(buzzerTimer, 1, 0);
+  }
+}
+
+void buzzerStop() {
+  portENTER_CRITICAL(&buzzerMux);
+  playing = false;
+  portEXIT_CRITICAL(&buzzerMux);
+
+  if (buzzerTimer != NULL) {
+    xTimerStop(buzzerTimer, 0);
+  }
+  noTone(buzzerPin);
+}
+
+bool buzzerBusy() {
+  return playing;
+}
@@ -0,0 +1,31 @@
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include <stdint.h>
+
+// Buzzer patterns played from a FreeRTOS software timer. buzzerPlay()
+// returns at once and the timer steps through the notes, so no task ever
+// waits on the buzzer.
+//
+// Patterns are listed from least to most urgent. A pattern doesn't cut off
+// a more urgent one that is still playing, so a button chirp can't silence
+// a fever alarm.
+enum BuzzerPattern : uint8_t {
+  BUZZER_CHIRP,            // Button feedback
+  BUZZER_STARTUP,
+  BUZZER_FEVER_MODERATE,
+  BUZZER_FEVER_HIGH,
+  BUZZER_FEVER_CRITICAL,
+  BUZZER_PATTERN_COUNT
+};
+
+void buzzerBegin(uint8_t pin);
+
+void buzzerPlay(BuzzerPattern pattern);
+
+// Silences the buzzer and drops whatever was playing
+void buzzerStop();
+
+bool buzzerBusy();
+
+#endif // BUZZER_H
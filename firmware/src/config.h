@@ -4,12 +4,26 @@
 // WiFi Configuration
 #define WIFI_SSID "YOUR_WIFI_SSID"
 #define WIFI_PASSWORD "YOUR_WIFI_PASSWORD"
+#define WIFI_FAST_CONNECT_TIMEOUT 3000     // ms to join the cached channel/BSSID before doing a full scan
+#define WIFI_STATIC_IP_ENABLED false       // Skip DHCP and use the addresses below
+#define WIFI_STATIC_IP "192.168.1.50"
+#define WIFI_STATIC_GATEWAY "192.168.1.1"
+#define WIFI_STATIC_SUBNET "255.255.255.0"
+#define WIFI_STATIC_DNS "192.168.1.1"
+#define NTP_RESYNC_INTERVAL 3600000        // ms between NTP syncs once the clock is set
+#define NTP_DRIFT_MIN_INTERVAL 1800000     // ms a clock drift measurement must span
 
 // MQTT Configuration
 #define MQTT_SERVER "your-mqtt-broker.com"
-#define MQTT_PORT 1883
+#define MQTT_PORT 8883                      // 1883 when MQTT_TLS_ENABLED is false
 #define MQTT_USER "botcareu_device"
 #define MQTT_PASSWORD "your_mqtt_password"
+#define MQTT_TLS_ENABLED true               // Verify the broker against MQTT_CA_CERT from secrets.h
+#define MQTT_TLS_ECDSA_ONLY false           // Offer only ECDHE-ECDSA on P-256, for a broker with an ECDSA certificate
+#define MQTT_TLS_SESSION_LIFETIME 7200000   // ms a session is offered for resumption, at most the broker's ticket lifetime
+#define MQTT_KEEPALIVE 60                   // s between pings on an idle connection
+
+#define TELEMETRY_FORMAT 0  // 0=JSON, 1=compact binary; overridable per device via /config
 
 // API Configuration
 #define API_SERVER "your-api-server.com"
@@ -24,27 +38,88 @@
 // Sensor Configuration
 #define TEMPERATURE_PRECISION 12
 #define MEASUREMENT_SAMPLES 3
+#define MEASUREMENT_SAMPLE_INTERVAL 100  // ms between IR samples
+#define MEASUREMENT_FILTER_MODE 0        // 0=median, 1=trimmed mean
+#define MEASUREMENT_FILTER_TRIM 1        // samples dropped from each end by the trimmed mean
 #define CALIBRATION_OFFSET_IR 0.0
-#define CALIBRATION_OFFSET_CONTACT 0.0
+#define CALIBRATION_OFFSET_CONTACT 0.0     // Applies to the primary probe only
+#define CONTACT_PRIMARY_PROBE 0          // DS18B20 on the body, by bus address order; the others report as extra channels
+
+// Sensor Fusion
+#define FUSION_IR_AMBIENT_GAIN 0.1          // Core-to-skin offset per °C of skin-to-ambient gradient
+#define FUSION_IR_SIGMA 0.3                 // °C, uncertainty of a compensated IR value
+#define FUSION_CONTACT_SIGMA 0.1            // °C, uncertainty of a settled contact probe
+#define FUSION_IR_VARIANCE_REF 0.01         // °C², IR sample variance at which IR quality halves
+#define FUSION_CONTACT_SETTLE_RATE 0.2      // °C/min above which the contact probe is still settling
+#define FUSION_HEALTH_ALPHA 0.2             // Weight of the newest reading in sensor health
+#define FUSION_SIGMA_MAX 1.0                // °C of uncertainty at which confidence reaches 0
+#define TELEMETRY_RAW_SENSORS false         // Send raw IR, contact and ambient values in JSON readings too
+
+// Adaptive Sampling, interval bounds overridable per device via /config
+#define ADAPTIVE_MIN_INTERVAL 5000          // ms, cadence at critical temperatures
+#define ADAPTIVE_MAX_INTERVAL 600000        // ms, cadence after a long steady normal stretch
+#define ADAPTIVE_STABLE_PERIOD 7200000      // ms of steady normal readings before slowing down
+#define ADAPTIVE_RISING_SLOPE 0.2           // °C/min treated as a rising trend
+#define ADAPTIVE_STEADY_SLOPE 0.1           // °C/min below which readings count as flat
+
+// Trend Analytics, reported with the status heartbeat
+#define TREND_EWMA_TIME_CONSTANT 600000     // ms, smoothing of the reported average
+#define TREND_ONSET_MARGIN 0.7              // °C below the fever threshold where onsets are detected
+#define TREND_ONSET_SLOPE 0.03              // °C/min over the window that counts as a fever onset
+#define TREND_ONSET_MIN_SAMPLES 10          // Window readings needed before an onset can be flagged
+
+// Fever Alerts
+#define ALERT_HYSTERESIS 0.3                // °C below a band's threshold before it is left
+#define ALERT_REALERT_INTERVAL 1800000      // ms before an unchanged fever is announced again
 
 // Display Configuration
 #define DISPLAY_TIMEOUT 30000  // 30 seconds
 #define DISPLAY_BRIGHTNESS 128
 #define SCREEN_SAVER_ENABLED true
 
+// Bluetooth
+#define BLE_ENABLED true                 // Stream readings over the Health Thermometer service
+
 // Power Management
 #define BATTERY_LOW_THRESHOLD 3.3
 #define BATTERY_CRITICAL_THRESHOLD 3.0
-#define SLEEP_MODE_ENABLED true
-#define SLEEP_TIMEOUT 300000  // 5 minutes
+#define SLEEP_MODE_ENABLED true          // Deep sleep between measurements
+#define SLEEP_TIMEOUT 300000             // Longest a single wake may stay up, 5 minutes
+#define DUTY_CYCLE_MIN_INTERVAL 20000    // Shorter measurement intervals stay awake instead
 
 // Security Configuration
-#define ENCRYPTION_ENABLED true
+#define ENCRYPTION_ENABLED false  // Seal MQTT payloads with DEVICE_ENCRYPTION_KEY (AES-256-GCM)
 #define DEVICE_AUTH_TOKEN "your_device_token"
 
+// Firmware Updates
+#define OTA_VERIFY_TIMEOUT 600000          // ms new firmware has to publish a heartbeat before it is rolled back
+#ifndef DEV_OTA_ENABLED
+#define DEV_OTA_ENABLED false              // Accept unsigned espota uploads; set by env:esp32dev_ota
+#endif
+
+// Offline Storage
+#define FILESYSTEM_SIZE 0x60000            // LittleFS partition in partitions_ota.csv, 96 blocks of 4 KB
+#define OFFLINE_LOG_SEGMENTS 8             // Segment files in the ring
+#define OFFLINE_LOG_SEGMENT_RECORDS 256    // Readings per segment (~9.7 KB each)
+#define REPLAY_BATCH_SIZE 16               // Readings per replay message
+#define REPLAY_INTERVAL 2000               // ms between replay messages after reconnecting
+
+// Batched Publishing
+#define BATCH_SIZE 1                       // Readings per message, 1 publishes each reading alone
+#define BATCH_MAX_AGE 300000               // ms a partial batch may wait before it is sent
+
+// Deadband Reporting
+#define DEADBAND_THRESHOLD 0.0             // °C change needed to report, 0 reports every reading
+#define DEADBAND_MAX_SILENCE 900000        // ms, a reading is always reported after 15 minutes
+
+// Instrumentation, compiled out of release builds
+#define METRICS_INTERVAL 300000            // ms between /metrics reports
+
 // Debugging
 #define DEBUG_MODE true
 #define SERIAL_DEBUG true
-#define LOG_LEVEL 2  // 0=ERROR, 1=WARN, 2=INFO, 3=DEBUG
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 2  // 0=ERROR, 1=WARN, 2=INFO, 3=DEBUG; lines above it are compiled out
+#endif
 
 #endif // CONFIG_H
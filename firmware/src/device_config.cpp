@@ -0,0 +1,123 @@
+#include "device_config.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "checksum.h"
+#include "device_log.h"
+#include "telemetry_codec.h"
+
+#define DEVICE_CONFIG_PATH "/config.bin"
+
+// Blob layout: magic(2) version(1) size(1) DeviceConfig crc8(1). The size
+// byte catches layout changes between firmware builds.
+#define DEVICE_CONFIG_MAGIC0 'B'
+#define DEVICE_CONFIG_MAGIC1 'C'
+#define DEVICE_CONFIG_VERSION 1
+#define DEVICE_CONFIG_HEADER_SIZE 4
+#define DEVICE_CONFIG_BLOB_SIZE (DEVICE_CONFIG_HEADER_SIZE + sizeof(DeviceConfig) + 1)
+
+// Acceptable ranges for runtime updates
+#define MIN_MEASUREMENT_INTERVAL 1000UL        // 1 second
+#define MAX_MEASUREMENT_INTERVAL 86400000UL    // 24 hours
+#define MIN_HEARTBEAT_INTERVAL 5000UL          // 5 seconds
+#define MAX_HEARTBEAT_INTERVAL 3600000UL       // 1 hour
+#define MIN_DEADBAND_SILENCE 60000UL           // 1 minute
+#define MAX_DEADBAND_SILENCE 3600000UL         // 1 hour
+#define MIN_BATCH_AGE 1000UL                   // 1 second
+#define MAX_BATCH_AGE 3600000UL                // 1 hour
+#define MIN_FEVER_THRESHOLD 35.0f
+#define MAX_CRITICAL_THRESHOLD 43.0f
+
+static DeviceConfig activeConfig;
+static portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool loadConfig(DeviceConfig& config) {
+  File file = LittleFS.open(DEVICE_CONFIG_PATH, FILE_READ);
+  if (!file) return false;
+
+  uint8_t blob[DEVICE_CONFIG_BLOB_SIZE];
+  size_t length = file.read(blob, sizeof(blob));
+  file.close();
+
+  if (length != sizeof(blob) ||
+      blob[0] != DEVICE_CONFIG_MAGIC0 || blob[1] != DEVICE_CONFIG_MAGIC1 ||
+      blob[2] != DEVICE_CONFIG_VERSION || blob[3] != sizeof(DeviceConfig) ||
+      crc8(blob, sizeof(blob) - 1) != blob[sizeof(blob) - 1]) {
+    return false;
+  }
+
+  memcpy(&config, blob + DEVICE_CONFIG_HEADER_SIZE, sizeof(DeviceConfig));
+  return deviceConfigValidate(config);
+}
+
+static bool saveConfig(const DeviceConfig& config) {
+  uint8_t blob[DEVICE_CONFIG_BLOB_SIZE];
+  blob[0] = DEVICE_CONFIG_MAGIC0;
+  blob[1] = DEVICE_CONFIG_MAGIC1;
+  blob[2] = DEVICE_CONFIG_VERSION;
+  blob[3] = sizeof(DeviceConfig);
+  memcpy(blob + DEVICE_CONFIG_HEADER_SIZE, &config, sizeof(DeviceConfig));
+  blob[sizeof(blob) - 1] = crc8(blob, sizeof(blob) - 1);
+
+  File file = LittleFS.open(DEVICE_CONFIG_PATH, FILE_WRITE);
+  if (!file) return false;
+
+  size_t written = file.write(blob, sizeof(blob));
+  file.close();
+  return written == sizeof(blob);
+}
+
+void deviceConfigBegin(const DeviceConfig& defaults) {
+  DeviceConfig config;
+  if (loadConfig(config)) {
+    LOG_INFO("Loaded stored device configuration");
+  } else {
+    config = defaults;
+  }
+
+  portENTER_CRITICAL(&configMux);
+  activeConfig = config;
+  portEXIT_CRITICAL(&configMux);
+}
+
+DeviceConfig deviceConfigCurrent() {
+  portENTER_CRITICAL(&configMux);
+  DeviceConfig config = activeConfig;
+  portEXIT_CRITICAL(&configMux);
+  return config;
+}
+
+bool deviceConfigValidate(const DeviceConfig& config) {
+  return config.minMeasurementInterval >= MIN_MEASUREMENT_INTERVAL &&
+         config.minMeasurementInterval <= config.measurementInterval &&
+         config.measurementInterval <= config.maxMeasurementInterval &&
+         config.maxMeasurementInterval <= MAX_MEASUREMENT_INTERVAL &&
+         config.heartbeatInterval >= MIN_HEARTBEAT_INTERVAL &&
+         config.heartbeatInterval <= MAX_HEARTBEAT_INTERVAL &&
+         config.feverThreshold >= MIN_FEVER_THRESHOLD &&
+         config.feverThreshold < config.highFeverThreshold &&
+         config.highFeverThreshold < config.criticalTempThreshold &&
+         config.criticalTempThreshold <= MAX_CRITICAL_THRESHOLD &&
+         config.deadbandThreshold >= 0 &&
+         config.deadbandMaxSilence >= MIN_DEADBAND_SILENCE &&
+         config.deadbandMaxSilence <= MAX_DEADBAND_SILENCE &&
+         config.batchMaxAge >= MIN_BATCH_AGE &&
+         config.batchMaxAge <= MAX_BATCH_AGE &&
+         config.batchSize >= 1 && config.batchSize <= BATCH_SIZE_LIMIT &&
+         (config.telemetryFormat == TELEMETRY_FORMAT_JSON ||
+          config.telemetryFormat == TELEMETRY_FORMAT_BINARY);
+}
+
+bool deviceConfigApply(const DeviceConfig& config) {
+  if (!deviceConfigValidate(config)) return false;
+
+  portENTER_CRITICAL(&configMux);
+  activeConfig = config;
+  portEXIT_CRITICAL(&configMux);
+
+  if (!saveConfig(config)) {
+    LOG_WARN("Could not persist device configuration");
+  }
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <stdint.h>
+
+// Largest batch the /config topic may ask for; a full batch must fit the
+// MQTT buffer
+#define BATCH_SIZE_LIMIT 24
+
+// Settings that can be changed at runtime through the /config topic.
+// Compile-time #defines only provide the defaults. The active copy is
+// persisted to LittleFS and loaded again at boot.
+struct DeviceConfig {
+  uint32_t measurementInterval;   // ms, base cadence for normal readings
+  uint32_t minMeasurementInterval; // ms, fastest adaptive cadence
+  uint32_t maxMeasurementInterval; // ms, slowest adaptive cadence
+  uint32_t heartbeatInterval;     // ms
+  float feverThreshold;           // °C
+  float highFeverThreshold;       // °C
+  float criticalTempThreshold;    // °C
+  float deadbandThreshold;        // °C, 0 reports every reading
+  uint32_t deadbandMaxSilence;    // ms
+  uint32_t batchMaxAge;           // ms
+  uint8_t batchSize;
+  uint8_t telemetryFormat;        // TELEMETRY_FORMAT_JSON or TELEMETRY_FORMAT_BINARY
+};
+
+// Loads the persisted config, or uses defaults if none is stored or the
+// stored blob doesn't match this firmware's layout
+void deviceConfigBegin(const DeviceConfig& defaults);
+
+// Snapshot of the active config, safe to call from any task
+DeviceConfig deviceConfigCurrent();
+
+bool deviceConfigValidate(const DeviceConfig& config);
+
+// Validates and replaces the whole active config in one step, then persists
+// it. An invalid config is rejected and the active one is left untouched.
+bool deviceConfigApply(const DeviceConfig& config);
+
+#endif // DEVICE_CONFIG_H
@@ -0,0 +1,266 @@
+#include "device_log.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/ringbuf.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "checksum.h"
+
+#define LOG_ERROR_DIR "/errors"
+
+// seq(4) + timestamp(8) + text + crc8(1)
+#define ERROR_RECORD_SIZE (4 + 8 + LOG_ERROR_TEXT_SIZE + 1)
+#define ERROR_RING_RECORDS (LOG_ERROR_SEGMENTS * LOG_ERROR_SEGMENT_RECORDS)
+
+// What goes through the ring: the line as printed, and where its message
+// starts for the copy kept on flash
+struct LogItem {
+  uint64_t timestamp;
+  uint8_t level;
+  uint8_t messageOffset;
+  char text[LOG_LINE_SIZE];
+};
+
+static const char levelLetters[] = {'E', 'W', 'I', 'D'};
+
+static RingbufHandle_t ring = NULL;
+static uint64_t (*wallClock)() = NULL;
+static portMUX_TYPE siteMux = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint32_t dropped = 0;
+static volatile bool writing = false;     // The task holds a line it hasn't written yet
+
+static SemaphoreHandle_t storageMutex = NULL;
+static bool storageReady = false;
+
+// Kept over deep sleep, so a wake skips the segment scan
+RTC_DATA_ATTR static uint32_t nextErrorSeq = 0;   // 0 until recovered
+
+static uint32_t segmentOf(uint32_t seq) {
+  return ((seq - 1) / LOG_ERROR_SEGMENT_RECORDS) % LOG_ERROR_SEGMENTS;
+}
+
+static uint32_t slotOf(uint32_t seq) {
+  return (seq - 1) % LOG_ERROR_SEGMENT_RECORDS;
+}
+
+static void segmentPath(uint32_t segment, char* path, size_t size) {
+  snprintf(path, size, LOG_ERROR_DIR "/seg%u", (unsigned)segment);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool recordValid(const uint8_t* record) {
+  return crc8(record, ERROR_RECORD_SIZE - 1) == record[ERROR_RECORD_SIZE - 1];
+}
+
+// Appends the message to the error ring. Starting a segment truncates what
+// the ring left there; a segment of the wrong length, from a write cut
+// short, is given up for the next one.
+static void storeError(const LogItem& item) {
+  uint8_t record[ERROR_RECORD_SIZE];
+  char path[24];
+
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    uint32_t seq = nextErrorSeq;
+    segmentPath(segmentOf(seq), path, sizeof(path));
+    File file = LittleFS.open(path, slotOf(seq) == 0 ? FILE_WRITE : FILE_APPEND);
+    if (!file) break;
+
+    if (file.size() != slotOf(seq) * ERROR_RECORD_SIZE) {
+      file.close();
+      nextErrorSeq = seq + LOG_ERROR_SEGMENT_RECORDS - slotOf(seq);
+      continue;
+    }
+
+    memset(record, 0, sizeof(record));
+    for (uint8_t i = 0; i < 4; i++) record[i] = (seq >> (8 * i)) & 0xFF;
+    for (uint8_t i = 0; i < 8; i++) record[4 + i] = (item.timestamp >> (8 * i)) & 0xFF;
+    strncpy((char*)record + 12, item.text + item.messageOffset, LOG_ERROR_TEXT_SIZE - 1);
+    char* newline = strchr((char*)record + 12, '\n');
+    if (newline != NULL) *newline = '\0';
+    record[ERROR_RECORD_SIZE - 1] = crc8(record, ERROR_RECORD_SIZE - 1);
+
+    bool written = file.write(record, ERROR_RECORD_SIZE) == ERROR_RECORD_SIZE;
+    file.close();
+    if (written) nextErrorSeq = seq + 1;
+    break;
+  }
+  xSemaphoreGive(storageMutex);
+}
+
+static void logTask(void* parameter) {
+  for (;;) {
+    size_t size = 0;
+    LogItem* item = (LogItem*)xRingbufferReceive(ring, &size, portMAX_DELAY);
+    if (item == NULL) continue;
+
+    writing = true;
+    Serial.write((const uint8_t*)item->text, size - offsetof(LogItem, text));
+    if (item->level == LOG_LEVEL_ERROR && storageReady) {
+      storeError(*item);
+    }
+    vRingbufferReturnItem(ring, item);
+    writing = false;
+  }
+}
+
+void logBegin(uint64_t (*clock)()) {
+  wallClock = clock;
+  storageMutex = xSemaphoreCreateMutex();
+  ring = xRingbufferCreate(LOG_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+  if (ring == NULL) return;
+
+  if (xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, NULL,
+                              LOG_TASK_PRIORITY, NULL, LOG_TASK_CORE) != pdPASS) {
+    ring = NULL;
+  }
+}
+
+bool logStorageBegin() {
+  if (storageMutex == NULL) return false;
+  if (!LittleFS.exists(LOG_ERROR_DIR) && !LittleFS.mkdir(LOG_ERROR_DIR)) return false;
+
+  if (nextErrorSeq == 0) {
+    // The newest record in any segment gives the counter; a segment with a
+    // torn tail is left for the next one
+    uint32_t newestSeq = 0;
+    bool newestAligned = true;
+    uint8_t record[ERROR_RECORD_SIZE];
+    char path[24];
+
+    for (uint32_t segment = 0; segment < LOG_ERROR_SEGMENTS; segment++) {
+      segmentPath(segment, path, sizeof(path));
+      File file = LittleFS.open(path, FILE_READ);
+      if (!file) continue;
+
+      size_t records = file.size() / ERROR_RECORD_SIZE;
+      if (records > 0 && file.seek((records - 1) * ERROR_RECORD_SIZE) &&
+          file.read(record, ERROR_RECORD_SIZE) == ERROR_RECORD_SIZE && recordValid(record)) {
+        uint32_t seq = getU32(record);
+        if (seq > newestSeq) {
+          newestSeq = seq;
+          newestAligned = (file.size() == (slotOf(seq) + 1) * ERROR_RECORD_SIZE);
+        }
+      }
+      file.close();
+    }
+
+    nextErrorSeq = 1;
+    if (newestSeq > 0) {
+      nextErrorSeq = newestAligned ? newestSeq + 1 :
+                     newestSeq + LOG_ERROR_SEGMENT_RECORDS - slotOf(newestSeq);
+    }
+  }
+
+  storageReady = true;
+  return true;
+}
+
+void logWrite(LogSite& site, uint8_t level, const char* format, ...) {
+  unsigned long now = millis();
+  uint16_t suppressed;
+
+  portENTER_CRITICAL(&siteMux);
+  if (now - site.windowStart >= LOG_RATE_WINDOW) {
+    site.windowStart = now;
+    site.count = 0;
+  }
+  if (site.count >= LOG_RATE_BURST) {
+    if (site.suppressed < UINT16_MAX) site.suppressed++;
+    portEXIT_CRITICAL(&siteMux);
+    return;
+  }
+  site.count++;
+  suppressed = site.suppressed;
+  site.suppressed = 0;
+  portEXIT_CRITICAL(&siteMux);
+
+  LogItem item;
+  item.level = level;
+  item.timestamp = (level == LOG_LEVEL_ERROR && wallClock != NULL) ? wallClock() : 0;
+  int length = snprintf(item.text, sizeof(item.text), "[%5lu.%03lu] %c ",
+                        now / 1000, now % 1000, levelLetters[level & 3]);
+  item.messageOffset = length;
+
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(item.text + length, sizeof(item.text) - length, format, args);
+  va_end(args);
+  if (written > 0) length += written;
+
+  if (suppressed > 0 && length < (int)sizeof(item.text)) {
+    length += snprintf(item.text + length, sizeof(item.text) - length,
+                       " (%u suppressed)", (unsigned)suppressed);
+  }
+
+  // Cut lines still end in a newline
+  if (length > (int)sizeof(item.text) - 2) length = sizeof(item.text) - 2;
+  item.text[length++] = '\n';
+  item.text[length] = '\0';
+
+  if (ring == NULL) {
+    Serial.write((const uint8_t*)item.text, length);
+    return;
+  }
+  if (xRingbufferSend(ring, &item, offsetof(LogItem, text) + length, 0) != pdTRUE) {
+    dropped++;
+  }
+}
+
+void logFlush(unsigned long timeout) {
+  if (ring == NULL) return;
+
+  unsigned long start = millis();
+  for (;;) {
+    UBaseType_t waiting = 0;
+    vRingbufferGetInfo(ring, NULL, NULL, NULL, NULL, &waiting);
+    if ((waiting == 0 && !writing) || millis() - start >= timeout) break;
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+  Serial.flush();
+}
+
+uint32_t logDropped() {
+  return dropped;
+}
+
+uint8_t logReadErrors(uint32_t beforeSeq, LogErrorRecord* out, uint8_t maxRecords) {
+  if (!storageReady) return 0;
+
+  xSemaphoreTake(storageMutex, portMAX_DELAY);
+  uint32_t newest = nextErrorSeq - 1;
+  if (beforeSeq != 0 && beforeSeq - 1 < newest) newest = beforeSeq - 1;
+  uint32_t oldest = nextErrorSeq > ERROR_RING_RECORDS ? nextErrorSeq - ERROR_RING_RECORDS : 1;
+
+  uint8_t count = 0;
+  uint8_t record[ERROR_RECORD_SIZE];
+  char path[24];
+  for (uint32_t seq = newest; seq >= oldest && seq > 0 && count < maxRecords; seq--) {
+    segmentPath(segmentOf(seq), path, sizeof(path));
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) continue;
+    bool read = file.seek(slotOf(seq) * ERROR_RECORD_SIZE) &&
+                file.read(record, ERROR_RECORD_SIZE) == ERROR_RECORD_SIZE;
+    file.close();
+
+    // Slots skipped over after a torn write hold older records, or none
+    if (!read || !recordValid(record) || getU32(record) != seq) continue;
+
+    LogErrorRecord& entry = out[count++];
+    entry.seq = seq;
+    entry.timestamp = 0;
+    for (uint8_t i = 0; i < 8; i++) entry.timestamp |= (uint64_t)record[4 + i] << (8 * i);
+    memcpy(entry.text, record + 12, LOG_ERROR_TEXT_SIZE);
+    entry.text[LOG_ERROR_TEXT_SIZE - 1] = '\0';
+  }
+  xSemaphoreGive(storageMutex);
+  return count;
+}
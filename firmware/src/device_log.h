@@ -0,0 +1,117 @@
+#ifndef DEVICE_LOG_H
+#define DEVICE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// Leveled logging that never allocates and never waits on the UART.
+//
+// LOG_ERROR() to LOG_DEBUG() take a printf format, which has to be a string
+// literal, and compile to nothing above LOG_LEVEL. A line is formatted into
+// a fixed buffer on the caller's stack and queued in a ring buffer, and a
+// low-priority task writes it out at 115200 baud. When the ring is full the
+// line is dropped and counted instead.
+//
+// Every call site is rate limited to LOG_RATE_BURST lines per
+// LOG_RATE_WINDOW. The next line a site gets out says how many it lost, so
+// a failure repeating in a tight loop can't flood the UART.
+//
+// Errors are also kept on LittleFS for the get_logs command, in a ring of
+// LOG_ERROR_SEGMENTS segment files laid out like the offline log.
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#define LOG_LINE_SIZE 128              // Longer lines are cut
+#define LOG_BUFFER_SIZE 2048           // Bytes of lines waiting for the UART
+#define LOG_RATE_WINDOW 1000           // ms
+#define LOG_RATE_BURST 5               // Lines per call site per window
+#define LOG_ERROR_TEXT_SIZE 84         // Bytes of an error kept on flash, NUL included
+#define LOG_ERROR_SEGMENTS 4
+#define LOG_ERROR_SEGMENT_RECORDS 8
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 1            // Below the sensor task on the same core
+#define LOG_TASK_CORE 1
+
+// Rate limit state, one per call site
+struct LogSite {
+  unsigned long windowStart;
+  uint8_t count;
+  uint16_t suppressed;
+};
+
+struct LogErrorRecord {
+  uint32_t seq;                        // From 1, never reused by this device
+  uint64_t timestamp;                  // ms since the Unix epoch, 0 before the clock was set
+  char text[LOG_ERROR_TEXT_SIZE];
+};
+
+#define LOG_AT(level, format, ...)                                   \
+  do {                                                               \
+    static LogSite logSite = {0, 0, 0};                              \
+    logWrite(logSite, level, "" format, ##__VA_ARGS__);              \
+  } while (0)
+
+// Compiled-out lines still check their format and arguments, so the
+// variables they print don't go unused, but nothing is evaluated
+#define LOG_OFF(format, ...)                                         \
+  do {                                                               \
+    if (false) logFormatCheck("" format, ##__VA_ARGS__);             \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_OFF(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_OFF(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_OFF(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_OFF(__VA_ARGS__)
+#endif
+
+static inline void logFormatCheck(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static inline void logFormatCheck(const char* format, ...) {}
+
+// Starts the UART task. clock gives ms since the Unix epoch, or 0 while the
+// time isn't known, for stamping stored errors. Lines logged before this
+// are written out directly.
+void logBegin(uint64_t (*clock)());
+
+// Recovers the error ring once LittleFS is mounted. Until then, and if this
+// returns false, errors only go to the UART.
+bool logStorageBegin();
+
+// Use the LOG_ macros instead
+void logWrite(LogSite& site, uint8_t level, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+// Waits up to timeout ms for queued lines to reach the UART, before a
+// restart or deep sleep
+void logFlush(unsigned long timeout);
+
+// Lines lost to a full ring since boot
+uint32_t logDropped();
+
+// Copies up to maxRecords stored errors older than beforeSeq into out,
+// newest first, or the newest ones when beforeSeq is 0. Returns the number
+// copied.
+uint8_t logReadErrors(uint32_t beforeSeq, LogErrorRecord* out, uint8_t maxRecords);
+
+#endif // DEVICE_LOG_H
@@ -0,0 +1,59 @@
+#include "display_pages.h"
+
+#include <string.h>
+
+#include "i2c_bus.h"
+
+// Data bytes per I2C transaction, below the ESP32 Wire buffer with room
+// for the control byte
+#define DISPLAY_I2C_CHUNK 32
+#define SSD1306_CONTROL_DATA 0x40
+
+static uint8_t panelCopy[DISPLAY_PAGE_COUNT * DISPLAY_PAGE_WIDTH];
+static bool panelCopyValid = false;
+
+void displayPagesInvalidate() {
+  panelCopyValid = false;
+}
+
+static void sendPage(Adafruit_SSD1306& display, TwoWire& wire, uint8_t address,
+                     uint8_t page, const uint8_t* data) {
+  // Horizontal addressing (set by begin()) writes into this window only
+  display.ssd1306_command(SSD1306_PAGEADDR);
+  display.ssd1306_command(page);
+  display.ssd1306_command(page);
+  display.ssd1306_command(SSD1306_COLUMNADDR);
+  display.ssd1306_command(0);
+  display.ssd1306_command(DISPLAY_PAGE_WIDTH - 1);
+
+  for (uint16_t offset = 0; offset < DISPLAY_PAGE_WIDTH; offset += DISPLAY_I2C_CHUNK) {
+    wire.beginTransmission(address);
+    wire.write(SSD1306_CONTROL_DATA);
+    for (uint16_t i = 0; i < DISPLAY_I2C_CHUNK; i++) {
+      wire.write(data[offset + i]);
+    }
+    wire.endTransmission();
+  }
+}
+
+uint8_t displayPagesFlush(Adafruit_SSD1306& display, TwoWire& wire, uint8_t address) {
+  const uint8_t* frame = display.getBuffer();
+  uint8_t sent = 0;
+
+  for (uint8_t page = 0; page < DISPLAY_PAGE_COUNT; page++) {
+    const uint8_t* data = frame + page * DISPLAY_PAGE_WIDTH;
+    uint8_t* copy = panelCopy + page * DISPLAY_PAGE_WIDTH;
+
+    if (panelCopyValid && memcmp(data, copy, DISPLAY_PAGE_WIDTH) == 0) continue;
+
+    if (sent > 0) {
+      i2cBusYield(I2C_CLIENT_DISPLAY);
+    }
+    sendPage(display, wire, address, page, data);
+    memcpy(copy, data, DISPLAY_PAGE_WIDTH);
+    sent++;
+  }
+
+  panelCopyValid = true;
+  return sent;
+}
@@ -0,0 +1,24 @@
+#ifndef DISPLAY_PAGES_H
+#define DISPLAY_PAGES_H
+
+#include <stdint.h>
+
+#include <Adafruit_SSD1306.h>
+#include <Wire.h>
+
+// Partial flushes for a 128x64 SSD1306. display() always sends the whole
+// 1 KB frame; this keeps a copy of what the panel RAM holds and only sends
+// the 8-pixel-high pages whose bytes changed.
+#define DISPLAY_PAGE_WIDTH 128
+#define DISPLAY_PAGE_COUNT 8
+
+// The panel RAM no longer matches the copy, e.g. after display() or a
+// re-init, so the next flush sends every page
+void displayPagesInvalidate();
+
+// Sends the changed pages of display's framebuffer and returns how many
+// were sent. The caller holds the bus as I2C_CLIENT_DISPLAY; it is yielded
+// to waiting sensor reads between pages.
+uint8_t displayPagesFlush(Adafruit_SSD1306& display, TwoWire& wire, uint8_t address);
+
+#endif // DISPLAY_PAGES_H
@@ -0,0 +1,59 @@
+#include "i2c_bus.h"
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+static TwoWire* bus = NULL;
+static SemaphoreHandle_t busMutex = NULL;
+static volatile uint8_t sensorWaiting = 0;
+static portMUX_TYPE waitMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t clientClock[] = {I2C_SENSOR_CLOCK, I2C_DISPLAY_CLOCK};
+
+void i2cBusBegin(TwoWire& wire) {
+  bus = &wire;
+  busMutex = xSemaphoreCreateMutex();
+}
+
+void i2cBusAcquire(I2cClient client) {
+  if (client == I2C_CLIENT_SENSOR) {
+    portENTER_CRITICAL(&waitMux);
+    sensorWaiting++;
+    portEXIT_CRITICAL(&waitMux);
+
+    xSemaphoreTake(busMutex, portMAX_DELAY);
+
+    portENTER_CRITICAL(&waitMux);
+    sensorWaiting--;
+    portEXIT_CRITICAL(&waitMux);
+  } else {
+    // The mutex alone doesn't guarantee the sensor gets the bus next: the
+    // sensor task runs on the other core and could lose the race to take
+    // it. Lower-priority clients step aside until no sensor is waiting.
+    for (;;) {
+      while (sensorWaiting > 0) {
+        vTaskDelay(1);
+      }
+      xSemaphoreTake(busMutex, portMAX_DELAY);
+      if (sensorWaiting == 0) break;
+      xSemaphoreGive(busMutex);
+    }
+  }
+
+  // Libraries may have changed the clock since, so it is set every time
+  bus->setClock(clientClock[client]);
+}
+
+void i2cBusRelease() {
+  xSemaphoreGive(busMutex);
+}
+
+bool i2cBusYield(I2cClient client) {
+  if (client == I2C_CLIENT_SENSOR || sensorWaiting == 0) return false;
+
+  i2cBusRelease();
+  i2cBusAcquire(client);
+  return true;
+}
@@ -0,0 +1,33 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <stdint.h>
+
+#include <Wire.h>
+
+// Arbitration for the shared Wire bus. Sensor transactions have priority:
+// a display flush yields between pages while a sensor read is waiting, so
+// a read waits at most one page transfer instead of a whole frame.
+//
+// Each client also gets its own bus clock, set on every acquire. The
+// MLX90614's SMBus interface is only specified up to 100 kHz, while the
+// SSD1306 runs in 400 kHz fast mode.
+#define I2C_SENSOR_CLOCK 100000
+#define I2C_DISPLAY_CLOCK 400000
+
+enum I2cClient : uint8_t {
+  I2C_CLIENT_SENSOR,    // MLX90614, preempts the display
+  I2C_CLIENT_DISPLAY    // SSD1306
+};
+
+void i2cBusBegin(TwoWire& wire);
+
+// Blocks until client owns the bus, with its clock applied
+void i2cBusAcquire(I2cClient client);
+void i2cBusRelease();
+
+// For long low-priority transfers: hands the bus over if a sensor read is
+// waiting and takes it back afterwards. Returns true if it yielded.
+bool i2cBusYield(I2cClient client);
+
+#endif // I2C_BUS_H
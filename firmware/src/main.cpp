@@ -21,9 +21,16 @@
 #include <ArduinoJson.h>
 #include <Wire.h>
 #include <SPI.h>
-#include <NTPClient.h>
-#include <WiFiUdp.h>
 #include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <esp_sleep.h>
+#include <driver/rtc_io.h>
+#include <sys/time.h>
+#include <esp_sntp.h>
+#include <mbedtls/base64.h>
 
 // Temperature Sensors
 #include <Adafruit_MLX90614.h>
@@ -34,13 +41,34 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 
-// Security
-#include <Crypto.h>
-#include <AES.h>
-
 // Configuration
 #include "config.h"
 #include "secrets.h"
+#include "reading.h"
+#include "sampling.h"
+#include "measurement.h"
+#include "sensor_fusion.h"
+#include "sensor_source.h"
+#include "adaptive_schedule.h"
+#include "clock_model.h"
+#include "trend.h"
+#include "fever_alert.h"
+#include "telemetry_codec.h"
+#include "telemetry_transport.h"
+#include "offline_log.h"
+#include "deadband.h"
+#include "device_config.h"
+#include "metrics.h"
+#include "display_pages.h"
+#include "i2c_bus.h"
+#include "buzzer.h"
+#include "outbox.h"
+#include "payload_crypto.h"
+#include "tls_client.h"
+#include "reading_sequence.h"
+#include "ota_update.h"
+#include "ble_thermometer.h"
+#include "device_log.h"
 
 // Pin Definitions
 #define ONE_WIRE_BUS 4          // DS18B20 data pin
@@ -68,28 +96,91 @@
 #define HEARTBEAT_INTERVAL 30000      // 30 seconds
 #define WIFI_TIMEOUT 10000            // 10 seconds
 #define MQTT_RECONNECT_DELAY 5000     // 5 seconds
+#define RECONNECT_BACKOFF_MAX 300000  // 5 minutes
+#define MQTT_SOCKET_TIMEOUT 2         // seconds, bounds a single connect attempt
+#define TLS_HANDSHAKE_TIMEOUT 5000    // ms; a full handshake takes several hundred
+#define BUTTON_DEBOUNCE_TIME 50       // milliseconds
+#define SLEEP_FLUSH_DELAY 100         // ms for queued MQTT packets to leave before the radio stops
+#define NTP_SYNC_TIMEOUT 3000         // ms a wake waits for a requested sync before sleeping anyway
+#define OTA_RESTART_DELAY 5000        // ms for the install alert to go out before restarting
+
+#ifndef NTP_SERVER
+#define NTP_SERVER "pool.ntp.org"
+#endif
+
+// Task Configuration
+// The WiFi/LwIP stack runs on core 0, so network and UI work share it and
+// the sensor task gets core 1 to itself.
+#define SENSOR_TASK_CORE 1
+#define SENSOR_TASK_PRIORITY 3
+#define SENSOR_TASK_STACK 4096
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 2
+#define NETWORK_TASK_STACK 8192
+#define NETWORK_TASK_PERIOD 10        // milliseconds
+#define UI_TASK_CORE 0
+#define UI_TASK_PRIORITY 1
+#define UI_TASK_STACK 4096
+#define UI_TASK_PERIOD 10             // milliseconds
+#define READING_QUEUE_LENGTH 16
+#define COMMAND_QUEUE_LENGTH 8        // Commands one message may queue, a batch included
+
+// Fixed buffer sizes for the allocation-free publish path
+#define DEVICE_ID_SIZE 32
+#define TOPIC_SIZE 64
+#define STATUS_PAYLOAD_SIZE 448
+#define ALERT_PAYLOAD_SIZE 192
+#define LOGS_PAGE_SIZE 4              // Stored errors per get_logs reply, so it fits an outbox slot
+#define COMMAND_DOC_SIZE 1024         // JSON nodes only; parsing is zero-copy, so strings take no room
+#define BATCH_PAYLOAD_SIZE (BATCH_HEADER_MAX_SIZE + BATCH_SIZE_LIMIT * BATCH_ENTRY_MAX_SIZE)
+#define REPLAY_PAYLOAD_SIZE (2 + REPLAY_BATCH_SIZE * REPLAY_RECORD_SIZE)
+#define MQTT_BUFFER_SIZE 1536         // PubSubClient's default 256 bytes can't hold a JSON reading, nor a worst-case batch
+
+#if BATCH_SIZE < 1 || BATCH_SIZE > BATCH_SIZE_LIMIT
+#error "BATCH_SIZE must be between 1 and BATCH_SIZE_LIMIT"
+#endif
+
+// A full offline ring may take at most half of LittleFS. The config, the
+// sequence bound, the error ring and directories need a few blocks more,
+// and copy-on-write needs free blocks to make progress at all.
+#define OFFLINE_LOG_BLOCKS \
+  (OFFLINE_LOG_SEGMENTS * ((OFFLINE_LOG_SEGMENT_RECORDS * OFFLINE_RECORD_SIZE + 4095) / 4096))
+#if OFFLINE_LOG_BLOCKS > FILESYSTEM_SIZE / 4096 / 2
+#error "The offline log must fit in half of FILESYSTEM_SIZE"
+#endif
+
+// An unacked alert holds the device awake until its last repeat, and half
+// of a wake is left for joining WiFi and taking the reading first
+#if OUTBOX_RETRY_WINDOW > SLEEP_TIMEOUT / 2
+#error "OUTBOX_RETRY_WINDOW must fit in half of SLEEP_TIMEOUT"
+#endif
+
+// Readings are sealed in the buffer publishReading() encodes them into
+#if PAYLOAD_CRYPTO_OVERHEAD > TELEMETRY_TRANSPORT_RESERVE
+#error "TELEMETRY_TRANSPORT_RESERVE must cover PAYLOAD_CRYPTO_OVERHEAD"
+#endif
+
+#if MEASUREMENT_SAMPLES < 1 || MEASUREMENT_SAMPLES > SAMPLE_BUFFER_CAPACITY
+#error "MEASUREMENT_SAMPLES must be between 1 and SAMPLE_BUFFER_CAPACITY"
+#endif
 
 // Global Objects
 Adafruit_MLX90614 mlx = Adafruit_MLX90614();
 OneWire oneWire(ONE_WIRE_BUS);
 DallasTemperature ds18b20(&oneWire);
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
-
-WiFiClient wifiClient;
-PubSubClient mqttClient(wifiClient);
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org", 0, 60000);
+// The library sets its clock around each transfer; keep it at the display
+// clock afterwards too so page writes through Wire run at the same speed
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET,
+                         I2C_DISPLAY_CLOCK, I2C_DISPLAY_CLOCK);
+
+#if MQTT_TLS_ENABLED
+TlsClient mqttTransport;
+#else
+WiFiClient mqttTransport;
+#endif
+PubSubClient mqttClient(mqttTransport);
 
 // Global Variables
-struct TemperatureReading {
-  float infraredTemp;
-  float contactTemp;
-  float ambientTemp;
-  unsigned long timestamp;
-  bool isValid;
-  String measurementType;
-};
-
 struct DeviceStatus {
   bool wifiConnected;
   bool mqttConnected;
@@ -97,16 +188,186 @@ struct DeviceStatus {
   float batteryVoltage;
   int signalStrength;
   unsigned long uptime;
-  String deviceId;
 };
 
-TemperatureReading lastReading;
+// Connectivity state machine. Every transition is driven by timestamps
+// from the network task, so no connection step ever waits on the network.
+enum ConnectionState {
+  CONN_DISCONNECTED,
+  CONN_CONNECTING,
+  CONN_CONNECTED,
+  CONN_BACKOFF
+};
+
+struct ReconnectBackoff {
+  unsigned long nextAttempt;
+  unsigned long baseDelay;
+  uint8_t failures;
+};
+
+volatile ConnectionState wifiState = CONN_DISCONNECTED;
+volatile ConnectionState mqttState = CONN_DISCONNECTED;
+unsigned long wifiAttemptStart = 0;
+
+// Everything marked RTC_DATA_ATTR survives deep sleep and is only reset on a
+// cold boot. Timestamps kept there use deviceMillis(), which keeps counting
+// across sleeps where millis() starts again from zero.
+RTC_DATA_ATTR ReconnectBackoff wifiBackoff = {0, MQTT_RECONNECT_DELAY, 0};
+RTC_DATA_ATTR ReconnectBackoff mqttBackoff = {0, MQTT_RECONNECT_DELAY, 0};
+
+// Last access point joined, so a wake can skip the scan
+struct WiFiCache {
+  bool valid;
+  int32_t channel;
+  uint8_t bssid[6];
+};
+
+RTC_DATA_ATTR WiFiCache wifiCache = {false, 0, {0}};
+bool wifiFastConnect = false;  // Current attempt uses wifiCache
+
+// Wall clock carried over deep sleep against deviceMillis(). SNTP updates
+// it from the lwIP task, the sensor and network tasks read it.
+RTC_DATA_ATTR ClockModel wallClock = {false, 0, 0, 0, 0, 0.0f, 0};
+portMUX_TYPE clockMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool timeSyncPending = false;      // A requested sync hasn't answered yet
+unsigned long timeSyncRequestedAt = 0;
+MetricsStamp timeSyncStart = 0;
+
+// Sensor health behind the fused temperature, updated by the sensor task
+// and read by the network task for the heartbeat
+RTC_DATA_ATTR FusionState fusionState = {0, 0, NAN, 0, false};
+portMUX_TYPE fusionMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Adaptive sampling, owned by the sensor task
+RTC_DATA_ATTR ScheduleState sampleSchedule = {0, 0, 0, 0, false};
+RTC_DATA_ATTR volatile uint32_t scheduledInterval = MEASUREMENT_INTERVAL;  // ms to the next measurement
+
+// Duty cycling
+bool wokeFromSleep = false;
+RTC_DATA_ATTR uint32_t wakeCount = 0;
+RTC_DATA_ATTR unsigned long clockOffset = 0;        // deviceMillis() when this wake began
+RTC_DATA_ATTR unsigned long nextScheduledWake = 0;  // deviceMillis() of the next timed measurement
+RTC_DATA_ATTR int64_t sleepStartedUs = 0;           // RTC clock when the last sleep began
+RTC_DATA_ATTR unsigned long sleepScheduledMs = 0;
+volatile uint32_t measurementsThisWake = 0;
+volatile unsigned long lastInteraction = 0;         // millis() of the last button press or button wake
+volatile bool userActive = false;
+
+// Task handles and inter-task channels
+TaskHandle_t sensorTaskHandle = NULL;
+TaskHandle_t networkTaskHandle = NULL;
+TaskHandle_t uiTaskHandle = NULL;
+QueueHandle_t readingQueue = NULL;   // sensor -> network, every valid reading
+QueueHandle_t displayQueue = NULL;   // sensor -> UI, latest reading only
+
+RTC_DATA_ATTR TemperatureReading lastReading;  // Owned by the UI task
+
+// Trend statistics since boot, updated by the sensor task and read by the
+// network task for the heartbeat
+RTC_DATA_ATTR TrendStats trendStats;
+RTC_DATA_ATTR volatile bool feverOnsetPending = false;  // Onset alert not yet published
+portMUX_TYPE trendMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Fever alert episode, owned by the network task. Kept over deep sleep so
+// a wake doesn't announce an ongoing fever as new.
+RTC_DATA_ATTR AlertState feverAlert = {FEVER_NONE, FEVER_NONE, 0};
 DeviceStatus deviceStatus;
-unsigned long lastMeasurement = 0;
 unsigned long lastDisplayUpdate = 0;
-unsigned long lastHeartbeat = 0;
-bool measurementInProgress = false;
-String deviceId;
+
+// What the status screen shows. The UI task only redraws when this changes,
+// and then only flushes the pages that differ.
+struct DisplayModel {
+  bool wifiConnected;
+  bool mqttConnected;
+  bool hasReading;
+  int16_t temperatureTenths;
+  bool fever;
+};
+
+DisplayModel shownModel;
+bool shownModelValid = false;     // false forces the next redraw
+bool displayPowered = true;
+unsigned long displayActiveSince = 0;
+RTC_DATA_ATTR unsigned long lastHeartbeat = 0;
+RTC_DATA_ATTR unsigned long lastReplay = 0;
+
+// Batched publishing, owned by the network task. A partial batch waits in
+// RTC memory while the device sleeps.
+RTC_DATA_ATTR TemperatureReading pendingBatch[BATCH_SIZE_LIMIT];
+RTC_DATA_ATTR uint8_t pendingBatchCount = 0;
+RTC_DATA_ATTR unsigned long pendingBatchStarted = 0;
+
+// Deadband reporting, owned by the network task
+RTC_DATA_ATTR DeadbandFilter reportDeadband = {0, 0, false};
+
+#if METRICS_ENABLED
+RTC_DATA_ATTR unsigned long lastMetricsReport = 0;
+#endif
+
+// Alerts carry an ID the backend echoes back in an ack_alert command
+RTC_DATA_ATTR uint32_t nextAlertId = 1;
+
+// Firmware update, owned by the network task
+char otaTargetVersion[OTA_VERSION_SIZE] = "";
+bool otaRestartPending = false;
+unsigned long otaRestartAt = 0;   // millis()
+uint8_t contactSensorCount = 0;
+DeviceAddress contactProbes[READING_PROBE_MAX];  // Found once by setupSensors(), in bus order
+unsigned long contactConversionTime = 0;  // DS18B20 conversion time at TEMPERATURE_PRECISION
+bool buttonLastState = HIGH;
+bool buttonStableState = HIGH;
+unsigned long buttonLastChange = 0;
+
+// Device identity and MQTT topics, built once by generateDeviceId()
+char deviceId[DEVICE_ID_SIZE];
+char temperatureTopic[TOPIC_SIZE];
+char temperatureBinTopic[TOPIC_SIZE];
+char replayTopic[TOPIC_SIZE];
+char batchTopic[TOPIC_SIZE];
+char statusTopic[TOPIC_SIZE];
+char statusBinTopic[TOPIC_SIZE];
+char alertsTopic[TOPIC_SIZE];
+char configTopic[TOPIC_SIZE];
+char commandsTopic[TOPIC_SIZE];
+char logsTopic[TOPIC_SIZE];
+size_t topicPrefixLength = 0;         // "botcareu/device/<id>/", shared by every topic above
+#if METRICS_ENABLED
+char metricsTopic[TOPIC_SIZE];
+#endif
+
+// Commands from the /commands and /config topics. The MQTT callback parses
+// each one into a queue entry and the network task carries them out after
+// mqttClient.loop() returns, outside the callback and off PubSubClient's
+// buffer.
+enum CommandType : uint8_t {
+  COMMAND_MEASURE_NOW,
+  COMMAND_ACK_ALERT,
+  COMMAND_CONFIGURE,
+  COMMAND_OTA_UPDATE,
+  COMMAND_GET_LOGS,
+  COMMAND_RESTART
+};
+
+struct PendingCommand {
+  CommandType type;
+  union {
+    uint32_t alertId;
+    DeviceConfig config;                // The whole config to apply
+    struct {
+      uint32_t beforeSeq;
+      uint8_t limit;
+    } logs;
+    struct {
+      OtaRequest request;
+      const char* error;                // Static string, set if the request didn't parse
+    } ota;
+  };
+};
+
+// Network task only: the callback runs inside mqttClient.loop()
+PendingCommand pendingCommands[COMMAND_QUEUE_LENGTH];
+uint8_t pendingCommandHead = 0;
+uint8_t pendingCommandCount = 0;
 
 // Function Declarations
 void setupWiFi();
@@ -117,336 +378,1188 @@ void setupFileSystem();
 void generateDeviceId();
 void connectToWiFi();
 void connectToMQTT();
-void takeMeasurement();
-void publishTemperatureData(const TemperatureReading& reading);
+void serviceConnectivity(unsigned long now);
+void setupTimeSync();
+void serviceTimeSync(unsigned long now);
+void onTimeSync(struct timeval* tv);
+ClockModel clockSnapshot();
+unsigned long epochSeconds();
+bool linkPending();
+void scheduleReconnect(ReconnectBackoff& backoff, unsigned long now);
+void serviceButton(unsigned long now);
+void setupTasks();
+void sensorTask(void* parameter);
+void networkTask(void* parameter);
+void uiTask(void* parameter);
+void requestMeasurement();
+bool takeMeasurement(TemperatureReading& reading);
+void stampReading(TemperatureReading& reading);
+void resolveTimestamp(TemperatureReading& reading);
+uint32_t nextMeasurementInterval(const TemperatureReading& reading);
+void updateTrend(const TemperatureReading& reading);
+TrendStats trendSnapshot();
+void serviceFeverOnset();
+TelemetrySource currentTelemetrySource();
+bool publishTemperatureData(const TemperatureReading& reading);
+bool publishEncodedReading(void* context, const char* topic, uint8_t* payload, size_t length,
+                           size_t capacity);
+void storeOfflineReading(const TemperatureReading& reading);
+void serviceReplay(unsigned long now);
+void addToBatch(const TemperatureReading& reading, unsigned long now);
+void serviceBatch(unsigned long now);
+void flushBatch();
 void publishDeviceStatus();
+bool publishMessage(const char* topic, const uint8_t* payload, size_t length);
+bool publishPayload(const char* topic, uint8_t* payload, size_t length, size_t capacity);
+size_t sealPayload(const char* topic, uint8_t* payload, size_t length, size_t capacity);
+void serviceMetrics(unsigned long now);
 void updateDisplay();
+void setDisplayPower(bool on);
+void wakeDisplay();
 void handleMQTTMessage(char* topic, byte* payload, unsigned int length);
+void setupConfig();
+void handleConfigMessage(JsonVariantConst doc);
+void handleCommandMessage(JsonVariantConst doc);
+void queueCommand(const char* name, JsonVariantConst params);
+void serviceCommands();
+void applyConfig(const DeviceConfig& config);
+void startOtaUpdate(const OtaRequest& request, const char* error);
+void serviceOta();
+void postOtaAlert(const char* alertType, const char* error);
 void checkFeverAlert(float temperature);
-void playAlert(int duration, int frequency);
+void postAlert(JsonDocument& doc);
 void updateDeviceStatus();
 void handleButtonPress();
+void resumeFromSleep();
+unsigned long deviceMillis();
+void serviceDutyCycle();
 void enterDeepSleep();
-bool validateTemperature(float temp);
-String encryptData(const String& data);
-void logError(const String& error);
+uint64_t logClock();
+void publishErrorLog(uint32_t beforeSeq, uint8_t limit);
+bool parseAckAlert(JsonVariantConst params, PendingCommand& command);
+bool parseGetLogs(JsonVariantConst params, PendingCommand& command);
+bool parseConfigure(JsonVariantConst params, PendingCommand& command);
+bool parseOtaUpdate(JsonVariantConst params, PendingCommand& command);
+
+// Dispatch tables for handleMQTTMessage(), matched by topic suffix and by
+// command name
+struct TopicRoute {
+  const char* suffix;
+  void (*handle)(JsonVariantConst doc);
+};
+
+const TopicRoute topicRoutes[] = {
+  {"config", handleConfigMessage},
+  {"commands", handleCommandMessage}
+};
+
+struct CommandRoute {
+  const char* name;
+  CommandType type;
+  bool (*parse)(JsonVariantConst params, PendingCommand& command);  // NULL takes no params
+};
+
+const CommandRoute commandRoutes[] = {
+  {"measure_now", COMMAND_MEASURE_NOW, NULL},
+  {"ack_alert", COMMAND_ACK_ALERT, parseAckAlert},
+  {"configure", COMMAND_CONFIGURE, parseConfigure},
+  {"ota_update", COMMAND_OTA_UPDATE, parseOtaUpdate},
+  {"get_logs", COMMAND_GET_LOGS, parseGetLogs},
+  {"restart", COMMAND_RESTART, NULL}
+};
 
 void setup() {
   Serial.begin(115200);
-  Serial.println("\n=== BotCareU IoT Health Monitor Starting ===");
+  logBegin(logClock);
+  LOG_INFO("=== BotCareU IoT Health Monitor Starting ===");
+
+  // Restore the clock and connection state carried over deep sleep
+  resumeFromSleep();
   
   // Initialize pins
   pinMode(LED_PIN, OUTPUT);
   pinMode(BUTTON_PIN, INPUT_PULLUP);
-  pinMode(BUZZER_PIN, OUTPUT);
+  buzzerBegin(BUZZER_PIN);
   
-  // Flash LED to indicate startup
-  for (int i = 0; i < 3; i++) {
-    digitalWrite(LED_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_PIN, LOW);
-    delay(200);
+  // Flash LED to indicate startup. Wakes from deep sleep skip this and the
+  // other boot niceties below to get the reading out sooner.
+  if (!wokeFromSleep) {
+    for (int i = 0; i < 3; i++) {
+      digitalWrite(LED_PIN, HIGH);
+      delay(200);
+      digitalWrite(LED_PIN, LOW);
+      delay(200);
+    }
   }
   
-  // Initialize file system
+  // Initialize file system and load the runtime configuration
   setupFileSystem();
+  setupConfig();
   
   // Generate unique device ID
   generateDeviceId();
   
-  // Initialize display
+  // Initialize the shared I2C bus and the display
+  i2cBusBegin(Wire);
   setupDisplay();
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
-  display.setCursor(0, 0);
-  display.println("BotCareU Starting...");
-  display.display();
+  if (!wokeFromSleep) {
+    display.setCursor(0, 0);
+    display.println("BotCareU Starting...");
+    display.display();
+  }
   
   // Initialize sensors
   setupSensors();
+
+  // Nobody is looking at a timer wake, so the panel stays dark
+  if (wokeFromSleep && !userActive) {
+    setDisplayPower(false);
+  }
   
   // Initialize WiFi
   setupWiFi();
   
-  // Initialize time client
-  timeClient.begin();
-  timeClient.update();
+  // SNTP runs in the background once the network task starts it
+  setupTimeSync();
   
   // Initialize MQTT
   setupMQTT();
+
+  // Readings also stream to a phone nearby, with or without WiFi
+  if (BLE_ENABLED) {
+    bleThermometerBegin(deviceId);
+  }
+
+#if CRYPTO_BENCHMARK
+  payloadCryptoBenchmark();
+#endif
   
   // Initialize device status
   updateDeviceStatus();
   
-  Serial.println("=== Setup Complete ===");
-  
-  // Display ready message
-  display.clearDisplay();
-  display.setCursor(0, 0);
-  display.println("BotCareU Ready!");
-  display.println("Device ID:");
-  display.println(deviceId);
-  display.display();
+  LOG_INFO("=== Setup Complete ===");
   
-  // Play startup sound
-  playAlert(100, 1000);
-  delay(100);
-  playAlert(100, 1500);
+  if (!wokeFromSleep) {
+    // Display ready message
+    display.clearDisplay();
+    display.setCursor(0, 0);
+    display.println("BotCareU Ready!");
+    display.println("Device ID:");
+    display.println(deviceId);
+    display.display();
+    displayPagesInvalidate();
+
+    // Play startup sound
+    buzzerPlay(BUZZER_STARTUP);
+  }
+
+  // A freshly updated image runs on probation until its first heartbeat
+  otaBegin();
+
+  // Hand over to the sensor, network and UI tasks
+  setupTasks();
 }
 
 void loop() {
-  unsigned long currentTime = millis();
-  
-  // Handle WiFi connection
-  if (WiFi.status() != WL_CONNECTED) {
-    connectToWiFi();
-  }
-  
-  // Handle MQTT connection
-  if (!mqttClient.connected()) {
-    connectToMQTT();
-  }
-  mqttClient.loop();
-  
-  // Update time
-  timeClient.update();
-  
-  // Take temperature measurement
-  if (currentTime - lastMeasurement >= MEASUREMENT_INTERVAL) {
-    takeMeasurement();
-    lastMeasurement = currentTime;
-  }
-  
-  // Update display
-  if (currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
-    updateDisplay();
-    lastDisplayUpdate = currentTime;
+  // All work runs in the tasks started by setupTasks()
+  vTaskDelete(NULL);
+}
+
+void setupTasks() {
+  readingQueue = xQueueCreate(READING_QUEUE_LENGTH, sizeof(TemperatureReading));
+  displayQueue = xQueueCreate(1, sizeof(TemperatureReading));
+
+  xTaskCreatePinnedToCore(sensorTask, "sensor", SENSOR_TASK_STACK, NULL,
+                          SENSOR_TASK_PRIORITY, &sensorTaskHandle, SENSOR_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, NULL,
+                          NETWORK_TASK_PRIORITY, &networkTaskHandle, NETWORK_TASK_CORE);
+  xTaskCreatePinnedToCore(uiTask, "ui", UI_TASK_STACK, NULL,
+                          UI_TASK_PRIORITY, &uiTaskHandle, UI_TASK_CORE);
+}
+
+void sensorTask(void* parameter) {
+  TemperatureReading reading;
+  TickType_t nextMeasurement = xTaskGetTickCount();
+
+  for (;;) {
+    // Sleep until the next scheduled measurement, or until requestMeasurement()
+    // asks for one early. Scheduled deadlines advance by a fixed period so
+    // on-demand readings don't shift the cadence.
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = 0;
+    if ((int32_t)(nextMeasurement - now) > 0) {
+      wait = nextMeasurement - now;
+    }
+    bool requested = ulTaskNotifyTake(pdTRUE, wait) > 0;
+
+    MetricsStamp readStart = metricsNow();
+    bool valid = takeMeasurement(reading);
+    metricsRecord(STAGE_SENSOR_READ, readStart);
+    measurementsThisWake++;
+
+    // An invalid reading keeps the current cadence
+    if (valid) {
+      updateTrend(reading);
+      scheduledInterval = nextMeasurementInterval(reading);
+    }
+
+    if (requested) {
+      // Don't let a fast new cadence wait out the old deadline
+      TickType_t soonest = xTaskGetTickCount() + pdMS_TO_TICKS(scheduledInterval);
+      if ((int32_t)(nextMeasurement - soonest) > 0) {
+        nextMeasurement = soonest;
+      }
+    } else {
+      nextMeasurement += pdMS_TO_TICKS(scheduledInterval);
+    }
   }
-  
-  // Send heartbeat
-  if (currentTime - lastHeartbeat >= HEARTBEAT_INTERVAL) {
-    updateDeviceStatus();
-    publishDeviceStatus();
-    lastHeartbeat = currentTime;
+}
+
+void networkTask(void* parameter) {
+  TemperatureReading reading;
+
+  for (;;) {
+    MetricsStamp loopStart = metricsNow();
+    unsigned long currentTime = deviceMillis();
+    const DeviceConfig config = deviceConfigCurrent();
+
+    // Advance WiFi/MQTT state machines without blocking
+    serviceConnectivity(currentTime);
+    if (mqttState == CONN_CONNECTED) {
+      mqttClient.loop();
+      serviceCommands();  // Whatever the callback queued
+      outboxService(OUTBOX_ALERT, currentTime);
+    }
+
+    // Update time
+    serviceTimeSync(currentTime);
+
+    // Send heartbeat
+    if (currentTime - lastHeartbeat >= config.heartbeatInterval) {
+      updateDeviceStatus();
+      publishDeviceStatus();
+      lastHeartbeat = currentTime;
+    }
+
+    // Publish readings from the sensor task; waiting here also paces the task.
+    // Readings inside the deadband are skipped, anything that can't go out
+    // now is kept for replay. While a connection attempt is still in flight
+    // readings stay queued, so one that is about to succeed doesn't send
+    // them all to the offline log. Time spent blocked here doesn't count
+    // towards the loop metric.
+    MetricsStamp waitStart = metricsNow();
+    bool received = false;
+    if (linkPending()) {
+      vTaskDelay(pdMS_TO_TICKS(NETWORK_TASK_PERIOD));
+    } else {
+      received = xQueueReceive(readingQueue, &reading, pdMS_TO_TICKS(NETWORK_TASK_PERIOD)) == pdTRUE;
+    }
+    loopStart += metricsNow() - waitStart;
+
+    if (received) {
+      resolveTimestamp(reading);
+      float temperature = primaryTemperature(reading);
+      if (reading.isValid) {
+        checkFeverAlert(temperature);
+      }
+      if (mqttState == CONN_CONNECTED) {
+        outboxService(OUTBOX_ALERT, currentTime);  // Ahead of the reading itself
+      }
+
+      if (deadbandShouldReport(reportDeadband, temperature, currentTime, config.deadbandThreshold,
+                               config.deadbandMaxSilence, config.feverThreshold)) {
+        if (config.batchSize > 1 && mqttState == CONN_CONNECTED) {
+          addToBatch(reading, currentTime);
+        } else if (!publishTemperatureData(reading)) {
+          storeOfflineReading(reading);
+        }
+      }
+    }
+
+    serviceFeverOnset();
+    serviceBatch(currentTime);
+    serviceReplay(currentTime);
+    serviceMetrics(currentTime);
+    serviceOta();
+#if DEV_OTA_ENABLED
+    if (wifiState == CONN_CONNECTED) {
+      otaLocalBegin(deviceId);
+      otaLocalService();
+    }
+#endif
+
+    // Status and metrics go out only after alerts and readings
+    if (mqttState == CONN_CONNECTED) {
+      outboxService(OUTBOX_STATUS, currentTime);
+    }
+    metricsRecord(STAGE_NETWORK_LOOP, loopStart);
+
+    serviceDutyCycle();
   }
-  
-  // Handle button press
-  if (digitalRead(BUTTON_PIN) == LOW) {
-    delay(50); // Debounce
-    if (digitalRead(BUTTON_PIN) == LOW) {
-      handleButtonPress();
-      while (digitalRead(BUTTON_PIN) == LOW) {
-        delay(10);
+}
+
+void uiTask(void* parameter) {
+  TemperatureReading reading;
+
+  for (;;) {
+    unsigned long currentTime = millis();
+
+    // Pick up the newest reading, if any
+    if (xQueueReceive(displayQueue, &reading, 0) == pdTRUE) {
+      lastReading = reading;
+      bleThermometerPublish(reading, scheduledInterval);
+      const DeviceConfig config = deviceConfigCurrent();
+      if (classifyFever(primaryTemperature(reading), config.feverThreshold,
+                        config.highFeverThreshold, config.criticalTempThreshold) != FEVER_NONE) {
+        wakeDisplay();  // The network task sounds the alert
       }
     }
+
+    // Update display; this only touches the bus when something changed
+    if (currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
+      updateDisplay();
+      lastDisplayUpdate = currentTime;
+    }
+
+    // Screen saver
+    if (SCREEN_SAVER_ENABLED && displayPowered && currentTime - displayActiveSince >= DISPLAY_TIMEOUT) {
+      setDisplayPower(false);
+    }
+
+    // Handle button press
+    serviceButton(currentTime);
+
+    vTaskDelay(pdMS_TO_TICKS(UI_TASK_PERIOD));
+  }
+}
+
+void requestMeasurement() {
+  if (sensorTaskHandle != NULL) {
+    xTaskNotifyGive(sensorTaskHandle);
   }
-  
-  // Small delay to prevent watchdog reset
-  delay(10);
 }
 
 void setupFileSystem() {
   if (!LittleFS.begin()) {
-    Serial.println("Failed to mount file system");
+    LOG_ERROR("Failed to mount file system");
     return;
   }
-  Serial.println("File system mounted successfully");
+  LOG_INFO("File system mounted successfully");
+
+  // Errors logged from here on are kept for get_logs
+  logStorageBegin();
+
+  offlineLogBegin();
+  readingSequenceBegin();
 }
 
 void generateDeviceId() {
   uint64_t chipid = ESP.getEfuseMac();
-  deviceId = "BotCareU_" + String((uint32_t)(chipid >> 32), HEX) + String((uint32_t)chipid, HEX);
-  deviceId.toUpperCase();
-  deviceStatus.deviceId = deviceId;
-  Serial.println("Device ID: " + deviceId);
+  snprintf(deviceId, sizeof(deviceId), "BotCareU_%X%X", (uint32_t)(chipid >> 32), (uint32_t)chipid);
+
+  // Topics never change at runtime, so the publish path never builds strings
+  snprintf(temperatureTopic, sizeof(temperatureTopic), "botcareu/device/%s/temperature/reading", deviceId);
+  snprintf(temperatureBinTopic, sizeof(temperatureBinTopic), "%s/bin", temperatureTopic);
+  snprintf(replayTopic, sizeof(replayTopic), "botcareu/device/%s/temperature/replay", deviceId);
+  snprintf(batchTopic, sizeof(batchTopic), "botcareu/device/%s/temperature/batch", deviceId);
+  snprintf(statusTopic, sizeof(statusTopic), "botcareu/device/%s/status", deviceId);
+  snprintf(statusBinTopic, sizeof(statusBinTopic), "%s/bin", statusTopic);
+  snprintf(alertsTopic, sizeof(alertsTopic), "botcareu/device/%s/alerts", deviceId);
+  snprintf(configTopic, sizeof(configTopic), "botcareu/device/%s/config", deviceId);
+  snprintf(commandsTopic, sizeof(commandsTopic), "botcareu/device/%s/commands", deviceId);
+  snprintf(logsTopic, sizeof(logsTopic), "botcareu/device/%s/logs", deviceId);
+  topicPrefixLength = strlen(commandsTopic) - strlen("commands");
+#if METRICS_ENABLED
+  snprintf(metricsTopic, sizeof(metricsTopic), "botcareu/device/%s/metrics", deviceId);
+#endif
+
+  LOG_INFO("Device ID: %s", deviceId);
+}
+
+void setupDisplay() {
+  if (!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
+    LOG_ERROR("SSD1306 display initialization failed");
+  }
+  displayPagesInvalidate();
 }
 
 void setupSensors() {
-  Serial.println("Initializing sensors...");
-  
+  LOG_INFO("Initializing sensors...");
+
   // Initialize MLX90614 IR sensor
-  if (!mlx.begin()) {
-    Serial.println("Error: Could not find MLX90614 sensor");
+  i2cBusAcquire(I2C_CLIENT_SENSOR);
+  bool irReady = mlx.begin();
+  i2cBusRelease();
+  if (!irReady) {
+    LOG_ERROR("Could not find MLX90614 sensor");
     deviceStatus.sensorsReady = false;
   } else {
-    Serial.println("MLX90614 IR sensor initialized");
+    LOG_INFO("MLX90614 IR sensor initialized");
   }
   
   // Initialize DS18B20 contact sensor
   ds18b20.begin();
-  int deviceCount = ds18b20.getDeviceCount();
-  if (deviceCount == 0) {
-    Serial.println("Warning: No DS18B20 sensors found");
+  // Reading by index searches the bus for the probe every time; resolve
+  // each address once here and read by address from then on
+  uint8_t found = ds18b20.getDeviceCount();
+  contactSensorCount = 0;
+  for (uint8_t i = 0; i < found && contactSensorCount < READING_PROBE_MAX; i++) {
+    if (ds18b20.getAddress(contactProbes[contactSensorCount], i)) {
+      contactSensorCount++;
+    }
+  }
+  if (contactSensorCount == 0) {
+    LOG_WARN("No DS18B20 sensors found");
   } else {
-    Serial.println("DS18B20 sensor initialized, devices found: " + String(deviceCount));
-    ds18b20.setResolution(12); // Set to highest resolution
+    LOG_INFO("DS18B20 sensors initialized, %u found, %u in use",
+             (unsigned)found, (unsigned)contactSensorCount);
+    ds18b20.setResolution(TEMPERATURE_PRECISION);
+    if (CONTACT_PRIMARY_PROBE >= contactSensorCount) {
+      LOG_WARN("CONTACT_PRIMARY_PROBE is not connected");
+    }
   }
+
+  // requestTemperatures() only starts the conversion; takeMeasurement()
+  // collects the result once contactConversionTime has elapsed
+  ds18b20.setWaitForConversion(false);
+  contactConversionTime = ds18b20.millisToWaitForConversion(TEMPERATURE_PRECISION);
   
   deviceStatus.sensorsReady = true;
-  Serial.println("Sensors initialization complete");
+  LOG_INFO("Sensors initialization complete");
 }
 
 void setupWiFi() {
-  Serial.println("Setting up WiFi...");
+  LOG_INFO("Setting up WiFi...");
   WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
-
-  unsigned long startTime = millis();
-  while (WiFi.status() != WL_CONNECTED && millis() - startTime < WIFI_TIMEOUT) {
-    delay(500);
-    Serial.print(".");
+  WiFi.persistent(false);       // Credentials come from config.h, don't rewrite them to flash
+  WiFi.setAutoReconnect(false); // Reconnects are paced by serviceConnectivity()
+
+  if (WIFI_STATIC_IP_ENABLED) {
+    IPAddress ip, gateway, subnet, dns;
+    if (ip.fromString(WIFI_STATIC_IP) && gateway.fromString(WIFI_STATIC_GATEWAY) &&
+        subnet.fromString(WIFI_STATIC_SUBNET) && dns.fromString(WIFI_STATIC_DNS)) {
+      WiFi.config(ip, gateway, subnet, dns);
+    } else {
+      LOG_WARN("Invalid static IP configuration, using DHCP");
+    }
   }
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    Serial.println("IP address: " + WiFi.localIP().toString());
-    deviceStatus.wifiConnected = true;
-  } else {
-    Serial.println("\nWiFi connection failed!");
-    deviceStatus.wifiConnected = false;
+  // A wake that lands inside a reconnect backoff stays offline until it expires
+  if (wifiBackoff.failures > 0 && (long)(wifiBackoff.nextAttempt - deviceMillis()) > 0) {
+    wifiState = CONN_BACKOFF;
+    return;
   }
+  connectToWiFi();
 }
 
 void connectToWiFi() {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("Reconnecting to WiFi...");
-    WiFi.reconnect();
-    delay(5000);
+  WiFi.disconnect();
+  metricsIncrement(COUNTER_WIFI_CONNECTS);
+
+  // Joining the last access point directly skips the channel scan
+  wifiFastConnect = wifiCache.valid;
+  if (wifiFastConnect) {
+    LOG_INFO("Connecting to WiFi (cached channel %d)...", (int)wifiCache.channel);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, wifiCache.channel, wifiCache.bssid);
+  } else {
+    LOG_INFO("Connecting to WiFi...");
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
   }
+  wifiAttemptStart = deviceMillis();
+  wifiState = CONN_CONNECTING;
 }
 
 void setupMQTT() {
   mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
   mqttClient.setCallback(handleMQTTMessage);
-  connectToMQTT();
+  mqttClient.setSocketTimeout(MQTT_SOCKET_TIMEOUT);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+  mqttClient.setKeepAlive(MQTT_KEEPALIVE);
+  mqttTransport.setTimeout(MQTT_SOCKET_TIMEOUT);
+
+#if MQTT_TLS_ENABLED
+  mqttTransport.setCACert(MQTT_CA_CERT);
+  mqttTransport.setHandshakeTimeout(TLS_HANDSHAKE_TIMEOUT);
+  mqttTransport.setEcdsaOnly(MQTT_TLS_ECDSA_ONLY);
+  mqttTransport.setSessionLifetime(MQTT_TLS_SESSION_LIFETIME, deviceMillis);
+#endif
+
+  static_assert(sizeof(DEVICE_ENCRYPTION_KEY) - 1 == PAYLOAD_KEY_SIZE,
+                "DEVICE_ENCRYPTION_KEY must be 32 characters");
+  if (ENCRYPTION_ENABLED) {
+    payloadCryptoBegin((const uint8_t*)DEVICE_ENCRYPTION_KEY);
+  }
+  outboxBegin(publishMessage, ENCRYPTION_ENABLED ? sealPayload : NULL);
 }
 
 void connectToMQTT() {
-  while (!mqttClient.connected()) {
-    Serial.print("Attempting MQTT connection...");
+  LOG_INFO("Attempting MQTT connection...");
+  metricsIncrement(COUNTER_MQTT_CONNECTS);
+
+  if (mqttClient.connect(deviceId, MQTT_USER, MQTT_PASSWORD)) {
+#if MQTT_TLS_ENABLED
+    LOG_INFO("MQTT connected%s", mqttTransport.resumed() ? " (TLS resumed)" : "");
+#else
+    LOG_INFO("MQTT connected");
+#endif
+    mqttState = CONN_CONNECTED;
+    mqttBackoff.failures = 0;
+    deviceStatus.mqttConnected = true;
+
+    // Subscribe to device-specific topics
+    mqttClient.subscribe(configTopic);
+    mqttClient.subscribe(commandsTopic);
+
+    // Alerts sent just before the link dropped may never have arrived
+    outboxRetryNow();
+
+    // Publish device online status
+    publishDeviceStatus();
+  } else {
+    LOG_WARN("MQTT connection failed, rc=%d", mqttClient.state());
+    mqttState = CONN_BACKOFF;
+    deviceStatus.mqttConnected = false;
+    scheduleReconnect(mqttBackoff, deviceMillis());
+  }
+}
+
+void serviceConnectivity(unsigned long now) {
+  // WiFi state machine
+  switch (wifiState) {
+    case CONN_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        IPAddress ip = WiFi.localIP();
+        LOG_INFO("WiFi connected, IP address: %u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        wifiState = CONN_CONNECTED;
+        wifiBackoff.failures = 0;
+        deviceStatus.wifiConnected = true;
+
+        const uint8_t* bssid = WiFi.BSSID();
+        if (bssid != NULL) {
+          memcpy(wifiCache.bssid, bssid, sizeof(wifiCache.bssid));
+          wifiCache.channel = WiFi.channel();
+          wifiCache.valid = true;
+        }
+      } else if (wifiFastConnect && now - wifiAttemptStart >= WIFI_FAST_CONNECT_TIMEOUT) {
+        // The access point moved or changed channel; scan for it right away
+        LOG_INFO("Cached WiFi network not found, scanning");
+        wifiCache.valid = false;
+        connectToWiFi();
+      } else if (now - wifiAttemptStart >= WIFI_TIMEOUT) {
+        LOG_WARN("WiFi connection timed out");
+        wifiState = CONN_BACKOFF;
+        scheduleReconnect(wifiBackoff, now);
+      }
+      break;
+    case CONN_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        LOG_WARN("WiFi connection lost");
+        wifiState = CONN_DISCONNECTED;
+        deviceStatus.wifiConnected = false;
+      }
+      break;
+    case CONN_BACKOFF:
+      if ((long)(now - wifiBackoff.nextAttempt) >= 0) {
+        connectToWiFi();
+      }
+      break;
+    case CONN_DISCONNECTED:
+    default:
+      connectToWiFi();
+      break;
+  }
+
+  // MQTT state machine, only meaningful with a WiFi link. A pending MQTT
+  // backoff outlives a WiFi drop so it still paces the next attempt.
+  if (wifiState != CONN_CONNECTED) {
+    if (mqttState == CONN_CONNECTED) {
+      mqttClient.disconnect();
+    }
+    if (mqttState != CONN_BACKOFF) {
+      mqttState = CONN_DISCONNECTED;
+    }
+    deviceStatus.mqttConnected = false;
+    return;
+  }
 
-    if (mqttClient.connect(deviceId.c_str(), MQTT_USER, MQTT_PASSWORD)) {
-      Serial.println("connected");
-      deviceStatus.mqttConnected = true;
+  switch (mqttState) {
+    case CONN_CONNECTED:
+      if (!mqttClient.connected()) {
+        LOG_WARN("MQTT connection lost, rc=%d", mqttClient.state());
+        mqttState = CONN_DISCONNECTED;
+        deviceStatus.mqttConnected = false;
+      }
+      break;
+    case CONN_BACKOFF:
+      if ((long)(now - mqttBackoff.nextAttempt) >= 0) {
+        connectToMQTT();
+      }
+      break;
+    case CONN_CONNECTING:
+    case CONN_DISCONNECTED:
+    default:
+      connectToMQTT();
+      break;
+  }
+}
 
-      // Subscribe to device-specific topics
-      String configTopic = "botcareu/device/" + deviceId + "/config";
-      String commandTopic = "botcareu/device/" + deviceId + "/commands";
+void scheduleReconnect(ReconnectBackoff& backoff, unsigned long now) {
+  // Exponential backoff capped at RECONNECT_BACKOFF_MAX, with "equal jitter"
+  // so a ward full of devices doesn't reconnect in lockstep after an outage.
+  unsigned long window = backoff.baseDelay;
+  for (uint8_t i = 0; i < backoff.failures && window < RECONNECT_BACKOFF_MAX; i++) {
+    window *= 2;
+  }
+  if (window > RECONNECT_BACKOFF_MAX) {
+    window = RECONNECT_BACKOFF_MAX;
+  }
+  unsigned long wait = window / 2 + esp_random() % (window / 2 + 1);
 
-      mqttClient.subscribe(configTopic.c_str());
-      mqttClient.subscribe(commandTopic.c_str());
+  if (backoff.failures < UINT8_MAX) {
+    backoff.failures++;
+  }
+  backoff.nextAttempt = now + wait;
 
-      // Publish device online status
-      publishDeviceStatus();
-    } else {
-      Serial.print("failed, rc=");
-      Serial.print(mqttClient.state());
-      Serial.println(" try again in 5 seconds");
-      deviceStatus.mqttConnected = false;
-      delay(MQTT_RECONNECT_DELAY);
+  LOG_DEBUG("Next reconnect attempt in %lu ms", wait);
+}
+
+void setupTimeSync() {
+  sntp_setoperatingmode(SNTP_OPMODE_POLL);
+  sntp_setservername(0, NTP_SERVER);
+  sntp_set_sync_interval(NTP_RESYNC_INTERVAL);
+  sntp_set_time_sync_notification_cb(onTimeSync);
+}
+
+void serviceTimeSync(unsigned long now) {
+  if (wifiState != CONN_CONNECTED || sntp_enabled()) return;
+
+  // A clock carried over sleep is trusted until NTP_RESYNC_INTERVAL has
+  // passed. Once started, SNTP keeps polling at that interval for as long
+  // as the device stays awake. Nothing here waits for the answer.
+  ClockModel clock = clockSnapshot();
+  if (clock.synced && now - clock.syncedAt < NTP_RESYNC_INTERVAL) return;
+
+  timeSyncRequestedAt = now;
+  timeSyncStart = metricsNow();
+  timeSyncPending = true;
+  sntp_init();
+}
+
+void onTimeSync(struct timeval* tv) {
+  // Runs in the lwIP task, which has just set the system time from tv
+  uint64_t epochMs = (uint64_t)tv->tv_sec * 1000ULL + tv->tv_usec / 1000;
+  unsigned long now = deviceMillis();
+
+  portENTER_CRITICAL(&clockMux);
+  int32_t offset = clockModelSync(wallClock, epochMs, now, NTP_DRIFT_MIN_INTERVAL);
+  float drift = wallClock.driftPpm;
+  portEXIT_CRITICAL(&clockMux);
+
+  if (timeSyncPending) {
+    metricsRecord(STAGE_NTP_UPDATE, timeSyncStart);
+    timeSyncPending = false;
+  }
+  LOG_INFO("Clock synced, %ld ms off, drift %.0f ppm", (long)offset, drift);
+}
+
+ClockModel clockSnapshot() {
+  portENTER_CRITICAL(&clockMux);
+  ClockModel snapshot = wallClock;
+  portEXIT_CRITICAL(&clockMux);
+  return snapshot;
+}
+
+unsigned long epochSeconds() {
+  // Seconds since power-up until the first sync, as NTPClient used to give
+  ClockModel clock = clockSnapshot();
+  unsigned long now = deviceMillis();
+  return clock.synced ? (unsigned long)(clockModelNow(clock, now) / 1000) : now / 1000;
+}
+
+uint64_t logClock() {
+  // Stored errors are only stamped once there is a wall clock
+  ClockModel clock = clockSnapshot();
+  return clock.synced ? clockModelNow(clock, deviceMillis()) : 0;
+}
+
+void stampReading(TemperatureReading& reading) {
+  // Milliseconds come from the esp_timer behind deviceMillis(), carried
+  // forward from the last NTP sync and corrected for drift. Until the first
+  // sync there is only time since power-up.
+  unsigned long now = deviceMillis();
+  ClockModel clock = clockSnapshot();
+  reading.clockSynced = clock.synced;
+  reading.timestamp = clock.synced ? clockModelNow(clock, now) : now;
+}
+
+void resolveTimestamp(TemperatureReading& reading) {
+  // A reading taken before the first sync of this power cycle can still be
+  // placed once the clock is set, since deviceMillis() runs on across sleep.
+  // Readings only ever reach here from the queue or the RTC batch, both
+  // lost on power-up, so they share deviceMillis() with the sync.
+  if (reading.clockSynced) return;
+  ClockModel clock = clockSnapshot();
+  if (!clock.synced) return;
+  reading.timestamp = clockModelNow(clock, (unsigned long)reading.timestamp);
+  reading.clockSynced = true;
+}
+
+bool linkPending() {
+  // True while WiFi or MQTT is still being brought up, as opposed to
+  // connected or waiting out a backoff
+  return mqttState != CONN_CONNECTED && wifiState != CONN_BACKOFF && mqttState != CONN_BACKOFF;
+}
+
+void serviceButton(unsigned long now) {
+  bool state = digitalRead(BUTTON_PIN);
+
+  if (state != buttonLastState) {
+    buttonLastState = state;
+    buttonLastChange = now;
+  }
+
+  if (now - buttonLastChange >= BUTTON_DEBOUNCE_TIME && state != buttonStableState) {
+    buttonStableState = state;
+    if (buttonStableState == LOW) {
+      handleButtonPress();
     }
   }
 }
 
-void takeMeasurement() {
-  if (measurementInProgress) return;
+uint32_t nextMeasurementInterval(const TemperatureReading& reading) {
+  const DeviceConfig config = deviceConfigCurrent();
+
+  ScheduleBounds bounds;
+  bounds.minInterval = config.minMeasurementInterval;
+  bounds.baseInterval = config.measurementInterval;
+  bounds.maxInterval = config.maxMeasurementInterval;
+  bounds.stablePeriod = ADAPTIVE_STABLE_PERIOD;
+  bounds.risingSlope = ADAPTIVE_RISING_SLOPE;
+  bounds.steadySlope = ADAPTIVE_STEADY_SLOPE;
+  bounds.feverThreshold = config.feverThreshold;
+  bounds.highFeverThreshold = config.highFeverThreshold;
+  bounds.criticalTempThreshold = config.criticalTempThreshold;
+
+  uint32_t interval = scheduleNextInterval(sampleSchedule, primaryTemperature(reading),
+                                           deviceMillis(), bounds);
+  if (interval != scheduledInterval) {
+    LOG_INFO("Measurement interval now %lu ms (slope %.2f°C/min)",
+             (unsigned long)interval, sampleSchedule.slope);
+  }
+  return interval;
+}
 
-  measurementInProgress = true;
-  digitalWrite(LED_PIN, HIGH); // Indicate measurement in progress
+void updateTrend(const TemperatureReading& reading) {
+  TrendParams params;
+  params.ewmaTimeConstant = TREND_EWMA_TIME_CONSTANT;
+  params.feverThreshold = deviceConfigCurrent().feverThreshold;
+  params.onsetMargin = TREND_ONSET_MARGIN;
+  params.onsetSlope = TREND_ONSET_SLOPE;
+  params.onsetMinSamples = TREND_ONSET_MIN_SAMPLES;
+
+  float temperature = primaryTemperature(reading);
+  portENTER_CRITICAL(&trendMux);
+  bool onset = trendUpdate(trendStats, temperature, deviceMillis(), params);
+  portEXIT_CRITICAL(&trendMux);
+
+  if (onset) {
+    LOG_WARN("Fever onset: %.2f°C rising %.3f°C/min", temperature, trendStats.slope);
+    feverOnsetPending = true;
+  }
+}
 
-  TemperatureReading reading;
-  reading.timestamp = timeClient.getEpochTime();
-  reading.isValid = true;
-  reading.measurementType = "combined";
+TrendStats trendSnapshot() {
+  portENTER_CRITICAL(&trendMux);
+  TrendStats snapshot = trendStats;
+  portEXIT_CRITICAL(&trendMux);
+  return snapshot;
+}
+
+// The SensorSource behind takeMeasurement(), sensor task only
+struct HardwareSensors {
+  unsigned long conversionStart;  // millis()
+  TickType_t sampleTick;
+};
+
+// The contact conversion starts first, so it runs while the IR sensor is read
+void beginHardwareMeasurement(void* context) {
+  HardwareSensors* hardware = (HardwareSensors*)context;
+  hardware->conversionStart = millis();
+  if (contactSensorCount > 0) {
+    ds18b20.requestTemperatures();
+  }
+  hardware->sampleTick = xTaskGetTickCount();
+}
 
-  // Read infrared temperature
-  reading.infraredTemp = mlx.readObjectTempC();
-  reading.ambientTemp = mlx.readAmbientTempC();
+// IR samples are taken at a fixed rate
+void waitHardwareSample(void* context) {
+  HardwareSensors* hardware = (HardwareSensors*)context;
+  vTaskDelayUntil(&hardware->sampleTick, pdMS_TO_TICKS(MEASUREMENT_SAMPLE_INTERVAL));
+}
+
+float readHardwareInfrared(void* context) {
+  i2cBusAcquire(I2C_CLIENT_SENSOR);
+  float sample = mlx.readObjectTempC();
+  i2cBusRelease();
+  return sample;
+}
 
-  // Read contact temperature
-  ds18b20.requestTemperatures();
-  reading.contactTemp = ds18b20.getTempCByIndex(0);
+float readHardwareAmbient(void* context) {
+  i2cBusAcquire(I2C_CLIENT_SENSOR);
+  float ambient = mlx.readAmbientTempC();
+  i2cBusRelease();
+  return ambient;
+}
+
+// All probes were converted by the one request in beginHardwareMeasurement().
+// The task sleeps out the rest of the conversion rather than spinning in the
+// library, so core 1 stays free meanwhile.
+uint8_t readHardwareProbes(void* context, float* raw, uint8_t maxProbes) {
+  HardwareSensors* hardware = (HardwareSensors*)context;
+  if (contactSensorCount == 0) return 0;
 
-  // Validate readings
-  if (reading.infraredTemp < 20 || reading.infraredTemp > 50) {
-    reading.isValid = false;
-    Serial.println("Invalid infrared temperature reading");
+  unsigned long elapsed = millis() - hardware->conversionStart;
+  if (elapsed < contactConversionTime) {
+    vTaskDelay(pdMS_TO_TICKS(contactConversionTime - elapsed));
+  }
+  uint8_t count = contactSensorCount < maxProbes ? contactSensorCount : maxProbes;
+  for (uint8_t i = 0; i < count; i++) {
+    raw[i] = ds18b20.getTempC(contactProbes[i]);
   }
+  return count;
+}
+
+bool takeMeasurement(TemperatureReading& reading) {
+  digitalWrite(LED_PIN, HIGH); // Indicate measurement in progress
 
-  if (reading.contactTemp < 20 || reading.contactTemp > 50) {
-    Serial.println("Invalid contact temperature reading");
+  stampReading(reading);
+  reading.isValid = true;
+  reading.measurementType = MEASUREMENT_COMBINED;
+
+  HardwareSensors hardware;
+  SensorSource sensors;
+  sensors.context = &hardware;
+  sensors.begin = beginHardwareMeasurement;
+  sensors.waitSample = waitHardwareSample;
+  sensors.readInfrared = readHardwareInfrared;
+  sensors.readAmbient = readHardwareAmbient;
+  sensors.readProbes = readHardwareProbes;
+
+  SamplingParams sampling;
+  sampling.samples = MEASUREMENT_SAMPLES;
+  sampling.filterMode = MEASUREMENT_FILTER_MODE;
+  sampling.filterTrim = MEASUREMENT_FILTER_TRIM;
+  sampling.infraredOffset = CALIBRATION_OFFSET_IR;
+  sampling.contactOffset = CALIBRATION_OFFSET_CONTACT;
+  sampling.primaryProbe = CONTACT_PRIMARY_PROBE;
+  sampleSensors(sensors, sampling, reading);
+
+  // One core temperature from all of the above
+  FusionParams fusion;
+  fusion.irAmbientGain = FUSION_IR_AMBIENT_GAIN;
+  fusion.irSigma = FUSION_IR_SIGMA;
+  fusion.contactSigma = FUSION_CONTACT_SIGMA;
+  fusion.irVarianceRef = FUSION_IR_VARIANCE_REF;
+  fusion.contactSettleRate = FUSION_CONTACT_SETTLE_RATE;
+  fusion.healthAlpha = FUSION_HEALTH_ALPHA;
+  fusion.sigmaMax = FUSION_SIGMA_MAX;
+  unsigned long fusedAt = deviceMillis();
+  portENTER_CRITICAL(&fusionMux);
+  fusionUpdate(fusionState, reading, fusedAt, fusion);
+  portEXIT_CRITICAL(&fusionMux);
+
+  if (!validateTemperature(reading.infraredTemp)) {
+    LOG_WARN("Invalid infrared temperature reading");
   }
 
-  // Use the most accurate reading available
-  if (reading.contactTemp > 20 && reading.contactTemp < 50) {
-    reading.measurementType = "contact";
-  } else if (reading.infraredTemp > 20 && reading.infraredTemp < 50) {
-    reading.measurementType = "infrared";
+  if (!validateTemperature(reading.contactTemp)) {
+    LOG_WARN("Invalid contact temperature reading");
   }
 
   if (reading.isValid) {
-    lastReading = reading;
+    reading.seq = readingSequenceNext();
+    reading.seqEpoch = readingSequenceEpoch();
+
+    // Hand off without waiting: the network task publishes and checks for
+    // fever, the UI task displays it
+    if (xQueueSend(readingQueue, &reading, 0) != pdTRUE) {
+      LOG_WARN("Reading queue full, reading dropped");
+      metricsIncrement(COUNTER_DROPPED_READINGS);
+    }
+    xQueueOverwrite(displayQueue, &reading);
+
+    LOG_INFO("Temperature: %.2f°C (%s, confidence %.2f)", primaryTemperature(reading),
+             measurementTypeName(reading.measurementType), reading.confidence);
+  }
+
+  digitalWrite(LED_PIN, LOW);
+  return reading.isValid;
+}
+
+TelemetrySource currentTelemetrySource() {
+  TelemetrySource source;
+  source.deviceId = deviceId;
+  source.firmwareVersion = FIRMWARE_VERSION;
+  source.batteryVoltage = deviceStatus.batteryVoltage;
+  source.signalStrength = WiFi.RSSI();
+  return source;
+}
 
-    // Check for fever
-    float primaryTemp = (reading.measurementType == "contact") ? reading.contactTemp : reading.infraredTemp;
-    checkFeverAlert(primaryTemp);
+bool publishTemperatureData(const TemperatureReading& reading) {
+  if (!mqttClient.connected()) return false;
 
-    // Publish to MQTT
-    publishTemperatureData(reading);
+  MetricsStamp serializeStart = metricsNow();
+  TelemetryTransport transport;
+  transport.context = &serializeStart;
+  transport.publish = publishEncodedReading;
 
-    Serial.println("Temperature: " + String(primaryTemp) + "°C (" + reading.measurementType + ")");
+  ReadingTopics topics;
+  topics.json = temperatureTopic;
+  topics.binary = temperatureBinTopic;
+  return publishReading(transport, topics, reading, currentTelemetrySource(),
+                        deviceConfigCurrent().telemetryFormat, TELEMETRY_RAW_SENSORS);
+}
+
+// The transport behind publishTemperatureData(). context is when encoding
+// started.
+bool publishEncodedReading(void* context, const char* topic, uint8_t* payload, size_t length,
+                           size_t capacity) {
+  metricsRecord(STAGE_SERIALIZE, *(const MetricsStamp*)context);
+  return publishPayload(topic, payload, length, capacity);
+}
+
+void addToBatch(const TemperatureReading& reading, unsigned long now) {
+  if (pendingBatchCount == 0) {
+    pendingBatchStarted = now;
   }
+  pendingBatch[pendingBatchCount++] = reading;
 
-  digitalWrite(LED_PIN, LOW);
-  measurementInProgress = false;
+  if (pendingBatchCount >= deviceConfigCurrent().batchSize) {
+    flushBatch();
+  }
 }
 
-void publishTemperatureData(const TemperatureReading& reading) {
-  if (!mqttClient.connected()) return;
+void serviceBatch(unsigned long now) {
+  if (pendingBatchCount == 0) return;
 
-  StaticJsonDocument<512> doc;
-  doc["deviceId"] = deviceId;
-  doc["infraredTemp"] = reading.infraredTemp;
-  doc["contactTemp"] = reading.contactTemp;
-  doc["ambientTemp"] = reading.ambientTemp;
-  doc["measurementType"] = reading.measurementType;
-  doc["timestamp"] = reading.timestamp;
-  doc["isValid"] = reading.isValid;
+  // Don't hold readings back once the batch is old or reconnecting has failed
+  if (now - pendingBatchStarted >= deviceConfigCurrent().batchMaxAge ||
+      (mqttState != CONN_CONNECTED && !linkPending())) {
+    flushBatch();
+  }
+}
+
+void flushBatch() {
+  if (pendingBatchCount == 0) return;
+
+  bool sent = false;
 
-  // Add metadata
-  JsonObject metadata = doc.createNestedObject("metadata");
-  metadata["batteryLevel"] = deviceStatus.batteryVoltage;
-  metadata["signalStrength"] = WiFi.RSSI();
-  metadata["firmwareVersion"] = "1.0.0-alpha";
+  if (mqttClient.connected()) {
+    TelemetrySource source = currentTelemetrySource();
 
-  String payload;
-  serializeJson(doc, payload);
+    for (uint8_t i = 0; i < pendingBatchCount; i++) {
+      resolveTimestamp(pendingBatch[i]);
+    }
+
+    uint8_t payload[BATCH_PAYLOAD_SIZE + PAYLOAD_CRYPTO_OVERHEAD];
+    MetricsStamp serializeStart = metricsNow();
+    size_t length = encodeReadingBatch(source, pendingBatch, pendingBatchCount, payload, BATCH_PAYLOAD_SIZE);
+    metricsRecord(STAGE_SERIALIZE, serializeStart);
+    sent = length > 0 && publishPayload(batchTopic, payload, length, sizeof(payload));
+  }
+
+  // A batch that didn't go out is kept reading by reading for replay
+  if (!sent) {
+    for (uint8_t i = 0; i < pendingBatchCount; i++) {
+      storeOfflineReading(pendingBatch[i]);
+    }
+  }
+  pendingBatchCount = 0;
+}
+
+void storeOfflineReading(const TemperatureReading& reading) {
+  uint8_t frame[READING_FRAME_SIZE];
+  encodeReadingFrame(reading, deviceStatus.batteryVoltage, WiFi.RSSI(), frame, sizeof(frame));
+
+  if (!offlineLogAppend(frame)) {
+    LOG_ERROR("Offline log unavailable, reading dropped");
+    metricsIncrement(COUNTER_DROPPED_READINGS);
+  }
+}
+
+void serviceReplay(unsigned long now) {
+  // One batch per REPLAY_INTERVAL, so a ward reconnecting after an outage
+  // trickles its backlog in rather than flooding the broker
+  if (mqttState != CONN_CONNECTED || now - lastReplay < REPLAY_INTERVAL) return;
+  if (offlineLogPending() == 0) return;
+
+  lastReplay = now;
+
+  // Binary batch: version(1) count(1) then count x [seq(4) reading frame].
+  // The backend dedupes on the reading frames' (seq epoch, seq).
+  uint8_t payload[REPLAY_PAYLOAD_SIZE + PAYLOAD_CRYPTO_OVERHEAD];
+  uint32_t lastSeq;
+  uint8_t count = offlineLogPeek(payload + 2, REPLAY_PAYLOAD_SIZE - 2, REPLAY_BATCH_SIZE, &lastSeq);
+
+  if (count > 0) {
+    payload[0] = TELEMETRY_BINARY_VERSION;
+    payload[1] = count;
+    if (!publishPayload(replayTopic, payload, 2 + count * REPLAY_RECORD_SIZE, sizeof(payload))) {
+      LOG_WARN("Replay publish failed, will retry");
+      return;
+    }
+  }
 
-  String topic = "botcareu/device/" + deviceId + "/temperature/reading";
-  mqttClient.publish(topic.c_str(), payload.c_str());
+  offlineLogAcknowledge(lastSeq);
+  LOG_INFO("Replayed %u readings up to seq %u, %u pending",
+           count, (unsigned)lastSeq, (unsigned)offlineLogPending());
 }
 
 void publishDeviceStatus() {
   if (!mqttClient.connected()) return;
 
-  StaticJsonDocument<256> doc;
-  doc["deviceId"] = deviceId;
+  const TrendStats trend = trendSnapshot();
+  portENTER_CRITICAL(&fusionMux);
+  const FusionState fusion = fusionState;
+  portEXIT_CRITICAL(&fusionMux);
+
+  if (deviceConfigCurrent().telemetryFormat == TELEMETRY_FORMAT_BINARY) {
+    StatusFrame status;
+    status.sensorsReady = deviceStatus.sensorsReady;
+    status.batteryVoltage = deviceStatus.batteryVoltage;
+    status.signalStrength = WiFi.RSSI();
+    status.uptime = millis();
+    status.freeMemory = ESP.getFreeHeap();
+    status.minFreeMemory = ESP.getMinFreeHeap();
+    status.maxAllocMemory = ESP.getMaxAllocHeap();
+    status.firmwareVersion = FIRMWARE_VERSION;
+    status.trend = &trend;
+    status.hasHealth = fusion.started;
+    status.infraredHealth = (uint8_t)roundf(fusion.infraredHealth * 100);
+    status.contactHealth = (uint8_t)roundf(fusion.contactHealth * 100);
+
+    uint8_t frame[STATUS_FRAME_MAX_SIZE];
+    MetricsStamp serializeStart = metricsNow();
+    size_t length = encodeStatusFrame(status, frame, sizeof(frame));
+    metricsRecord(STAGE_SERIALIZE, serializeStart);
+    outboxPost(OUTBOX_STATUS, statusBinTopic, frame, length, 0);
+    return;
+  }
+
+  MetricsStamp serializeStart = metricsNow();
+  StaticJsonDocument<512> doc;
+  doc["deviceId"] = (const char*)deviceId;
   doc["status"] = deviceStatus.sensorsReady ? "online" : "error";
   doc["batteryLevel"] = deviceStatus.batteryVoltage;
   doc["signalStrength"] = WiFi.RSSI();
-  doc["firmwareVersion"] = "1.0.0-alpha";
+  doc["firmwareVersion"] = FIRMWARE_VERSION;
   doc["uptime"] = millis();
   doc["freeMemory"] = ESP.getFreeHeap();
+  doc["minFreeMemory"] = ESP.getMinFreeHeap();    // Low-water mark since boot
+  doc["maxAllocMemory"] = ESP.getMaxAllocHeap();  // Largest free block, drops as the heap fragments
+
+  if (trend.samples > 0) {
+    JsonObject trendObject = doc.createNestedObject("trend");
+    trendObject["ewma"] = trend.ewma;
+    trendObject["min"] = trend.minTemperature;
+    trendObject["max"] = trend.maxTemperature;
+    trendObject["slope"] = trend.slope;                // °C per minute
+    trendObject["feverTime"] = trend.feverTime / 1000;  // Seconds
+    trendObject["samples"] = trend.samples;
+    trendObject["onset"] = trend.onset;
+  }
+
+  // Percent, smoothed over recent readings
+  if (fusion.started) {
+    JsonObject health = doc.createNestedObject("sensorHealth");
+    health["infrared"] = (int)roundf(fusion.infraredHealth * 100);
+    health["contact"] = (int)roundf(fusion.contactHealth * 100);
+  }
+
+  char payload[STATUS_PAYLOAD_SIZE];
+  size_t length = serializeJson(doc, payload, sizeof(payload));
+  metricsRecord(STAGE_SERIALIZE, serializeStart);
+
+  outboxPost(OUTBOX_STATUS, statusTopic, (const uint8_t*)payload, length, 0);
+}
+
+// Seals payload in place when encryption is on; capacity must leave
+// PAYLOAD_CRYPTO_OVERHEAD bytes after length
+size_t sealPayload(const char* topic, uint8_t* payload, size_t length, size_t capacity) {
+  if (!ENCRYPTION_ENABLED) return length;
+
+  MetricsStamp sealStart = metricsNow();
+  size_t sealed = payloadSeal(topic, payload, length, capacity);
+  metricsRecord(STAGE_ENCRYPT, sealStart);
+  return sealed;
+}
+
+bool publishPayload(const char* topic, uint8_t* payload, size_t length, size_t capacity) {
+  size_t sealed = sealPayload(topic, payload, length, capacity);
+  if (sealed == 0) {
+    metricsIncrement(COUNTER_PUBLISH_FAILURES);
+    return false;
+  }
+  return publishMessage(topic, payload, sealed);
+}
+
+bool publishMessage(const char* topic, const uint8_t* payload, size_t length) {
+  MetricsStamp publishStart = metricsNow();
+  bool published = mqttClient.publish(topic, payload, length);
+  metricsRecord(STAGE_PUBLISH, publishStart);
+
+  if (!published) {
+    metricsIncrement(COUNTER_PUBLISH_FAILURES);
+  } else if (topic == statusTopic || topic == statusBinTopic) {
+    otaConfirmImage();  // A heartbeat got out, so this firmware works
+  }
+  return published;
+}
 
-  String payload;
-  serializeJson(doc, payload);
+void serviceMetrics(unsigned long now) {
+#if METRICS_ENABLED
+  if (mqttState != CONN_CONNECTED || now - lastMetricsReport < METRICS_INTERVAL) return;
 
-  String topic = "botcareu/device/" + deviceId + "/status";
-  mqttClient.publish(topic.c_str(), payload.c_str());
+  char payload[METRICS_PAYLOAD_SIZE];
+  size_t length = metricsSerialize(payload, sizeof(payload), now - lastMetricsReport);
+  if (length > 0 && outboxPost(OUTBOX_STATUS, metricsTopic, (const uint8_t*)payload, length, 0)) {
+    metricsReset();
+    lastMetricsReport = now;
+  }
+#endif
 }
 
 void updateDisplay() {
+  if (!displayPowered) return;
+
+  DisplayModel model;
+  model.wifiConnected = (wifiState == CONN_CONNECTED);
+  model.mqttConnected = (mqttState == CONN_CONNECTED);
+  model.hasReading = lastReading.isValid;
+  model.temperatureTenths = 0;
+  model.fever = false;
+
+  float temp = 0;
+  if (model.hasReading) {
+    const DeviceConfig config = deviceConfigCurrent();
+    temp = primaryTemperature(lastReading);
+    model.temperatureTenths = (int16_t)lroundf(temp * 10);
+    model.fever = classifyFever(temp, config.feverThreshold, config.highFeverThreshold,
+                                config.criticalTempThreshold) != FEVER_NONE;
+  }
+
+  if (shownModelValid &&
+      model.wifiConnected == shownModel.wifiConnected &&
+      model.mqttConnected == shownModel.mqttConnected &&
+      model.hasReading == shownModel.hasReading &&
+      model.temperatureTenths == shownModel.temperatureTenths &&
+      model.fever == shownModel.fever) {
+    return;
+  }
+
   display.clearDisplay();
   display.setTextSize(1);
   display.setTextColor(SSD1306_WHITE);
@@ -454,100 +1567,446 @@ void updateDisplay() {
 
   // Device info
   display.println("BotCareU Monitor");
-  display.println("ID: " + deviceId.substring(deviceId.length() - 6));
-  display.println("");
+  display.print("ID: ");
+  display.println(deviceId + strlen(deviceId) - 6);
 
   // Connection status
   display.print("WiFi: ");
-  display.println(WiFi.status() == WL_CONNECTED ? "OK" : "FAIL");
-  display.print("MQTT: ");
-  display.println(mqttClient.connected() ? "OK" : "FAIL");
+  display.print(model.wifiConnected ? "OK  " : "FAIL");
+  display.print(" MQTT: ");
+  display.println(model.mqttConnected ? "OK" : "FAIL");
   display.println("");
 
   // Latest reading
-  if (lastReading.isValid) {
-    float temp = (lastReading.measurementType == "contact") ?
-                 lastReading.contactTemp : lastReading.infraredTemp;
-
+  if (model.hasReading) {
     display.setTextSize(2);
     display.print(temp, 1);
     display.println(" C");
     display.setTextSize(1);
-
-    if (temp >= FEVER_THRESHOLD) {
-      display.println("FEVER DETECTED!");
-    } else {
-      display.println("Normal");
-    }
+    display.println(model.fever ? "FEVER DETECTED!" : "Normal");
   } else {
     display.println("No readings");
   }
 
-  display.display();
+  // Wire is shared with the MLX90614 on the sensor task
+  i2cBusAcquire(I2C_CLIENT_DISPLAY);
+  MetricsStamp flushStart = metricsNow();
+  displayPagesFlush(display, Wire, SCREEN_ADDRESS);
+  metricsRecord(STAGE_DISPLAY_FLUSH, flushStart);
+  i2cBusRelease();
+
+  shownModel = model;
+  shownModelValid = true;
+}
+
+void setDisplayPower(bool on) {
+  if (on == displayPowered) return;
+
+  // The panel keeps its RAM while off, so the next redraw still only
+  // sends what changed
+  i2cBusAcquire(I2C_CLIENT_DISPLAY);
+  display.ssd1306_command(on ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF);
+  i2cBusRelease();
+
+  displayPowered = on;
+  if (on) {
+    shownModelValid = false;
+  }
+}
+
+void wakeDisplay() {
+  displayActiveSince = millis();
+  setDisplayPower(true);
 }
 
 void handleMQTTMessage(char* topic, byte* payload, unsigned int length) {
-  String message;
-  for (int i = 0; i < length; i++) {
-    message += (char)payload[i];
+  LOG_DEBUG("MQTT message received: %s = %.*s", topic, (int)length, (const char*)payload);
+
+  // Every topic we subscribe to is ours, so only the part after the device
+  // prefix needs comparing
+  const TopicRoute* route = NULL;
+  if (strlen(topic) > topicPrefixLength) {
+    for (size_t i = 0; i < sizeof(topicRoutes) / sizeof(topicRoutes[0]); i++) {
+      if (strcmp(topic + topicPrefixLength, topicRoutes[i].suffix) == 0) {
+        route = &topicRoutes[i];
+        break;
+      }
+    }
+  }
+  if (route == NULL) return;
+
+  // Parsing a mutable buffer is zero-copy: strings in the document point
+  // into PubSubClient's buffer, which stays valid until the callback returns
+  StaticJsonDocument<COMMAND_DOC_SIZE> doc;
+  DeserializationError error = deserializeJson(doc, (char*)payload, length);
+  if (error) {
+    LOG_WARN("MQTT message on %s rejected: %s", topic, error.c_str());
+    return;
   }
+  route->handle(doc.as<JsonVariantConst>());
+}
+
+void handleConfigMessage(JsonVariantConst doc) {
+  queueCommand("configure", doc);
+}
 
-  Serial.println("MQTT message received: " + String(topic) + " = " + message);
+// {"command": ..., "params": {...}}, or a batch of those as
+// {"commands": [...]}, which are queued in order
+void handleCommandMessage(JsonVariantConst doc) {
+  JsonArrayConst batch = doc["commands"];
+  if (batch.isNull()) {
+    queueCommand(doc["command"] | "", doc["params"]);
+    return;
+  }
+  for (JsonVariantConst entry : batch) {
+    queueCommand(entry["command"] | "", entry["params"]);
+  }
+}
 
-  StaticJsonDocument<256> doc;
-  deserializeJson(doc, message);
+// Turns one command into a queue entry carrying everything it needs, so
+// nothing refers back to the MQTT buffer once the callback has returned
+void queueCommand(const char* name, JsonVariantConst params) {
+  const CommandRoute* route = NULL;
+  for (size_t i = 0; i < sizeof(commandRoutes) / sizeof(commandRoutes[0]); i++) {
+    if (strcmp(name, commandRoutes[i].name) == 0) {
+      route = &commandRoutes[i];
+      break;
+    }
+  }
+  if (route == NULL) {
+    LOG_WARN("Unknown command \"%s\"", name);
+    return;
+  }
+  if (pendingCommandCount >= COMMAND_QUEUE_LENGTH) {
+    LOG_WARN("Command queue full, %s dropped", name);
+    return;
+  }
 
-  String topicStr = String(topic);
+  PendingCommand& command = pendingCommands[(pendingCommandHead + pendingCommandCount) % COMMAND_QUEUE_LENGTH];
+  command.type = route->type;
+  if (route->parse != NULL && !route->parse(params, command)) return;
+  pendingCommandCount++;
+}
+
+bool parseAckAlert(JsonVariantConst params, PendingCommand& command) {
+  command.alertId = params["alertId"] | 0UL;
+  return true;
+}
+
+bool parseGetLogs(JsonVariantConst params, PendingCommand& command) {
+  command.logs.beforeSeq = params["beforeSeq"] | 0UL;
+  command.logs.limit = params["limit"] | LOGS_PAGE_SIZE;
+  return true;
+}
+
+// Starts from the config the queue will leave behind, so the
+// configure commands of a batch build on each other
+bool parseConfigure(JsonVariantConst params, PendingCommand& command) {
+  DeviceConfig config = deviceConfigCurrent();
+  for (uint8_t i = 0; i < pendingCommandCount; i++) {
+    const PendingCommand& queued = pendingCommands[(pendingCommandHead + i) % COMMAND_QUEUE_LENGTH];
+    if (queued.type == COMMAND_CONFIGURE) config = queued.config;
+  }
+
+  config.measurementInterval = params["measurementInterval"] | config.measurementInterval;
+  config.minMeasurementInterval = params["minMeasurementInterval"] | config.minMeasurementInterval;
+  config.maxMeasurementInterval = params["maxMeasurementInterval"] | config.maxMeasurementInterval;
+  config.heartbeatInterval = params["heartbeatInterval"] | config.heartbeatInterval;
+  config.feverThreshold = params["feverThreshold"] | config.feverThreshold;
+  config.highFeverThreshold = params["highFeverThreshold"] | config.highFeverThreshold;
+  config.criticalTempThreshold = params["criticalTempThreshold"] | config.criticalTempThreshold;
+  config.deadbandThreshold = params["deadband"] | config.deadbandThreshold;
+  config.deadbandMaxSilence = params["deadbandMaxSilence"] | config.deadbandMaxSilence;
+  config.batchMaxAge = params["batchMaxAge"] | config.batchMaxAge;
+  config.batchSize = params["batchSize"] | config.batchSize;
+
+  if (params.containsKey("payloadFormat")) {
+    const char* format = params["payloadFormat"] | "json";
+    config.telemetryFormat = strcmp(format, "binary") == 0 ?
+                             TELEMETRY_FORMAT_BINARY : TELEMETRY_FORMAT_JSON;
+  }
+
+  command.config = config;
+  return true;
+}
+
+// A request that doesn't parse is still queued, so its failure alert goes
+// out in order with everything else
+bool parseOtaUpdate(JsonVariantConst params, PendingCommand& command) {
+  const char* url = params["url"] | "";
+  const char* version = params["version"] | "";
+  const char* signature = params["signature"] | "";
+
+  OtaRequest& request = command.ota.request;
+  memset(&request, 0, sizeof(request));
+  request.compressed = params["compressed"] | false;
+  snprintf(request.version, sizeof(request.version), "%s", version);
+  command.ota.error = NULL;
+
+  if (url[0] == '\0' || strlen(url) >= sizeof(request.url) ||
+      version[0] == '\0' || strlen(version) >= sizeof(request.version)) {
+    command.ota.error = "bad request";
+  } else if (mbedtls_base64_decode(request.signature, sizeof(request.signature),
+                                   &request.signatureLength, (const unsigned char*)signature,
+                                   strlen(signature)) != 0 || request.signatureLength == 0) {
+    command.ota.error = "bad signature";
+  } else {
+    snprintf(request.url, sizeof(request.url), "%s", url);
+  }
+  return true;
+}
 
-  if (topicStr.endsWith("/config")) {
-    // Handle configuration updates
-    if (doc.containsKey("measurementInterval")) {
-      // Update measurement interval
-      Serial.println("Configuration updated");
+// Carries out queued commands in arrival order. A restart waits until
+// everything queued ahead of it has run.
+void serviceCommands() {
+  while (pendingCommandCount > 0) {
+    PendingCommand& command = pendingCommands[pendingCommandHead];
+    pendingCommandHead = (pendingCommandHead + 1) % COMMAND_QUEUE_LENGTH;
+    pendingCommandCount--;
+
+    switch (command.type) {
+      case COMMAND_MEASURE_NOW:
+        requestMeasurement();
+        break;
+      case COMMAND_ACK_ALERT:
+        outboxAcknowledge(command.alertId);
+        break;
+      case COMMAND_CONFIGURE:
+        applyConfig(command.config);
+        break;
+      case COMMAND_OTA_UPDATE:
+        startOtaUpdate(command.ota.request, command.ota.error);
+        break;
+      case COMMAND_GET_LOGS:
+        publishErrorLog(command.logs.beforeSeq, command.logs.limit);
+        break;
+      case COMMAND_RESTART:
+        LOG_INFO("Restarting on command");
+        logFlush(SLEEP_FLUSH_DELAY);
+        ESP.restart();
+        break;
     }
-  } else if (topicStr.endsWith("/commands")) {
-    // Handle commands
-    String command = doc["command"];
-    if (command == "measure_now") {
-      takeMeasurement();
-    } else if (command == "restart") {
-      ESP.restart();
+  }
+}
+
+void setupConfig() {
+  DeviceConfig defaults;
+  defaults.measurementInterval = MEASUREMENT_INTERVAL;
+  defaults.minMeasurementInterval = ADAPTIVE_MIN_INTERVAL;
+  defaults.maxMeasurementInterval = ADAPTIVE_MAX_INTERVAL;
+  defaults.heartbeatInterval = HEARTBEAT_INTERVAL;
+  defaults.feverThreshold = FEVER_THRESHOLD;
+  defaults.highFeverThreshold = HIGH_FEVER_THRESHOLD;
+  defaults.criticalTempThreshold = CRITICAL_TEMP_THRESHOLD;
+  defaults.deadbandThreshold = DEADBAND_THRESHOLD;
+  defaults.deadbandMaxSilence = DEADBAND_MAX_SILENCE;
+  defaults.batchMaxAge = BATCH_MAX_AGE;
+  defaults.batchSize = BATCH_SIZE;
+  defaults.telemetryFormat = TELEMETRY_FORMAT;
+
+  deviceConfigBegin(defaults);
+
+  // A wake keeps the adaptive cadence it went to sleep with
+  if (!wokeFromSleep) {
+    scheduledInterval = deviceConfigCurrent().measurementInterval;
+  }
+}
+
+void applyConfig(const DeviceConfig& config) {
+  // Omitted keys kept their value when the command was parsed, and
+  // everything is applied at once so no task sees a half-updated config
+  const DeviceConfig previous = deviceConfigCurrent();
+
+  // Checked first, so a rejected config changes nothing at all
+  if (!deviceConfigValidate(config)) {
+    LOG_WARN("Configuration rejected: values out of range");
+    return;
+  }
+
+  // Readings already waiting in a batch go out with the old settings
+  if (config.batchSize != previous.batchSize || config.telemetryFormat != previous.telemetryFormat) {
+    flushBatch();
+  }
+
+  deviceConfigApply(config);
+
+  if (config.deadbandThreshold != previous.deadbandThreshold) {
+    deadbandReset(reportDeadband);  // Report the next reading as a fresh baseline
+  }
+  if (config.measurementInterval != previous.measurementInterval ||
+      config.minMeasurementInterval != previous.minMeasurementInterval ||
+      config.maxMeasurementInterval != previous.maxMeasurementInterval) {
+    requestMeasurement();  // Take a reading now and continue at the new cadence
+  }
+
+  LOG_INFO("Configuration updated");
+}
+
+// error is set when the command itself didn't parse
+void startOtaUpdate(const OtaRequest& request, const char* error) {
+  // The backend may repeat a command the device has already carried out
+  if (strcmp(request.version, FIRMWARE_VERSION) == 0) {
+    LOG_INFO("OTA: already running %s", request.version);
+    return;
+  }
+  if (otaBusy()) {
+    LOG_WARN("OTA: update already in progress");
+    return;
+  }
+  snprintf(otaTargetVersion, sizeof(otaTargetVersion), "%s", request.version);
+
+  if (error == NULL && otaStart(request, &error)) {
+    LOG_INFO("OTA: downloading %s", request.version);
+  }
+
+  postOtaAlert(error == NULL ? "ota_started" : "ota_failed", error);
+}
+
+void serviceOta() {
+  // Firmware that can't get a heartbeat out in time goes back to the last
+  // image that could
+  if (otaAwaitingConfirmation() && millis() >= OTA_VERIFY_TIMEOUT) {
+    otaRollback();
+  }
+
+  const char* error = NULL;
+  OtaResult result = otaTakeResult(&error);
+  if (result == OTA_FAILED) {
+    postOtaAlert("ota_failed", error);
+  } else if (result == OTA_INSTALLED) {
+    postOtaAlert("ota_installed", NULL);
+    otaRestartPending = true;
+    otaRestartAt = millis() + OTA_RESTART_DELAY;
+  }
+
+  if (otaRestartPending && (long)(millis() - otaRestartAt) >= 0) {
+    LOG_INFO("OTA: restarting into %s", otaTargetVersion);
+    flushBatch();
+    if (mqttClient.connected()) {
+      mqttClient.disconnect();
     }
+    vTaskDelay(pdMS_TO_TICKS(SLEEP_FLUSH_DELAY));
+    logFlush(SLEEP_FLUSH_DELAY);
+    ESP.restart();
+  }
+}
+
+void postOtaAlert(const char* alertType, const char* error) {
+  StaticJsonDocument<256> doc;
+  doc["deviceId"] = (const char*)deviceId;
+  doc["alertType"] = alertType;
+  doc["version"] = (const char*)otaTargetVersion;
+  doc["currentVersion"] = FIRMWARE_VERSION;
+  if (error != NULL) {
+    doc["message"] = error;
   }
+  doc["timestamp"] = epochSeconds();
+
+  postAlert(doc);
 }
 
 void checkFeverAlert(float temperature) {
-  if (temperature >= FEVER_THRESHOLD) {
-    Serial.println("FEVER ALERT: " + String(temperature) + "°C");
+  const DeviceConfig config = deviceConfigCurrent();
+
+  AlertBands bands;
+  bands.feverThreshold = config.feverThreshold;
+  bands.highFeverThreshold = config.highFeverThreshold;
+  bands.criticalTempThreshold = config.criticalTempThreshold;
+  bands.hysteresis = ALERT_HYSTERESIS;
+  bands.realertInterval = ALERT_REALERT_INTERVAL;
+
+  AlertEvent event = alertUpdate(feverAlert, temperature, deviceMillis(), bands);
+  if (event == ALERT_EVENT_NONE) return;
+
+  const char* severity = feverSeverityName(feverAlert.severity);
+  LOG_WARN("Fever alert %s: %.2f°C (%s)", alertEventName(event), temperature, severity);
+
+  if (event != ALERT_EVENT_CLEARED) {
+    static const BuzzerPattern patterns[] = {
+      BUZZER_FEVER_MODERATE, BUZZER_FEVER_MODERATE, BUZZER_FEVER_HIGH, BUZZER_FEVER_CRITICAL
+    };
+    buzzerPlay(patterns[feverAlert.severity]);
+  }
+
+  StaticJsonDocument<256> doc;
+  doc["deviceId"] = (const char*)deviceId;
+  doc["alertType"] = alertEventName(event);
+  doc["temperature"] = temperature;
+  doc["severity"] = severity;
+  doc["timestamp"] = epochSeconds();
 
-    // Play alert sound
-    playAlert(1000, 2000);
-    delay(200);
-    playAlert(1000, 2000);
+  postAlert(doc);
+}
+
+// Queues the onset flagged by updateTrend(), unless it has already passed
+void serviceFeverOnset() {
+  if (!feverOnsetPending) return;
+  feverOnsetPending = false;
+
+  const TrendStats trend = trendSnapshot();
+  if (!trend.onset) return;
 
-    // Publish alert
-    StaticJsonDocument<256> doc;
-    doc["deviceId"] = deviceId;
-    doc["alertType"] = "fever_detected";
-    doc["temperature"] = temperature;
-    doc["severity"] = temperature >= HIGH_FEVER_THRESHOLD ? "high" : "moderate";
-    doc["timestamp"] = timeClient.getEpochTime();
+  StaticJsonDocument<256> doc;
+  doc["deviceId"] = (const char*)deviceId;
+  doc["alertType"] = "fever_onset";
+  doc["temperature"] = trend.ewma;
+  doc["slope"] = trend.slope;
+  doc["severity"] = "normal";
+  doc["timestamp"] = epochSeconds();
+
+  postAlert(doc);
+}
 
-    String payload;
-    serializeJson(doc, payload);
+// Alerts go out ahead of everything else and are repeated until the
+// backend acknowledges their ID
+void postAlert(JsonDocument& doc) {
+  uint32_t alertId = nextAlertId++;
+  if (nextAlertId == 0) nextAlertId = 1;
+  doc["alertId"] = alertId;
 
-    String topic = "botcareu/device/" + deviceId + "/alerts";
-    mqttClient.publish(topic.c_str(), payload.c_str());
+  if (measureJson(doc) >= ALERT_PAYLOAD_SIZE) {
+    LOG_ERROR("Alert too large, dropped");
+    metricsIncrement(COUNTER_OUTBOX_DROPPED);
+    return;
   }
+
+  char payload[ALERT_PAYLOAD_SIZE];
+  size_t length = serializeJson(doc, payload, sizeof(payload));
+  outboxPost(OUTBOX_ALERT, alertsTopic, (const uint8_t*)payload, length, alertId);
 }
 
-void playAlert(int duration, int frequency) {
-  tone(BUZZER_PIN, frequency, duration);
+// Replies to get_logs with stored errors, newest first. A reply holds at
+// most LOGS_PAGE_SIZE; the backend pages back with beforeSeq set to the
+// oldest seq it got.
+void publishErrorLog(uint32_t beforeSeq, uint8_t limit) {
+  static LogErrorRecord records[LOGS_PAGE_SIZE];   // Network task only
+  if (limit == 0 || limit > LOGS_PAGE_SIZE) limit = LOGS_PAGE_SIZE;
+  uint8_t count = logReadErrors(beforeSeq, records, limit);
+
+  StaticJsonDocument<768> doc;
+  doc["deviceId"] = (const char*)deviceId;
+  doc["dropped"] = logDropped();
+  JsonArray errors = doc.createNestedArray("errors");
+  for (uint8_t i = 0; i < count; i++) {
+    JsonObject error = errors.createNestedObject();
+    error["seq"] = records[i].seq;
+    error["timestamp"] = records[i].timestamp;
+    error["message"] = (const char*)records[i].text;
+  }
+
+  // Escaping can push a full page past the slot; drop the oldest until it fits
+  while (errors.size() > 0 && measureJson(doc) >= OUTBOX_PAYLOAD_SIZE) {
+    errors.remove(errors.size() - 1);
+  }
+
+  char payload[OUTBOX_PAYLOAD_SIZE];
+  size_t length = serializeJson(doc, payload, sizeof(payload));
+  outboxPost(OUTBOX_STATUS, logsTopic, (const uint8_t*)payload, length, 0);
 }
 
 void updateDeviceStatus() {
-  deviceStatus.wifiConnected = (WiFi.status() == WL_CONNECTED);
-  deviceStatus.mqttConnected = mqttClient.connected();
+  deviceStatus.wifiConnected = (wifiState == CONN_CONNECTED);
+  deviceStatus.mqttConnected = (mqttState == CONN_CONNECTED);
   deviceStatus.signalStrength = WiFi.RSSI();
   deviceStatus.uptime = millis();
 
@@ -557,9 +2016,141 @@ void updateDeviceStatus() {
 }
 
 void handleButtonPress() {
-  Serial.println("Button pressed - taking measurement");
-  takeMeasurement();
+  LOG_INFO("Button pressed - taking measurement");
+  lastInteraction = millis();
+  userActive = true;
+  wakeDisplay();
+  requestMeasurement();
 
   // Brief feedback
-  playAlert(100, 1000);
+  buzzerPlay(BUZZER_CHIRP);
+}
+
+static int64_t rtcClockUs() {
+  // The system clock is driven by the RTC timer and keeps running in deep
+  // sleep. SNTP steps it, but only while awake, never between the two reads
+  // around a sleep.
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (int64_t)now.tv_sec * 1000000LL + now.tv_usec;
+}
+
+void resumeFromSleep() {
+  esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+  if (cause != ESP_SLEEP_WAKEUP_TIMER && cause != ESP_SLEEP_WAKEUP_EXT0) {
+    return;  // Cold boot, RTC memory starts from its initial values
+  }
+  wokeFromSleep = true;
+
+  // Fall back to the scheduled length if the RTC clock reading is implausible,
+  // e.g. it was adjusted while asleep
+  int64_t sleptMs = (rtcClockUs() - sleepStartedUs) / 1000;
+  if (sleptMs < 0 || sleptMs > (int64_t)sleepScheduledMs + 1000) {
+    sleptMs = sleepScheduledMs;
+  }
+  clockOffset += (unsigned long)sleptMs;
+  wakeCount++;
+
+  // The connection state machines start afresh, but their backoff doesn't
+  unsigned long now = deviceMillis();
+  if (mqttBackoff.failures > 0 && (long)(mqttBackoff.nextAttempt - now) > 0) {
+    mqttState = CONN_BACKOFF;
+  }
+
+  // ext0 left the button pad under RTC control
+  rtc_gpio_deinit((gpio_num_t)BUTTON_PIN);
+
+  if (cause == ESP_SLEEP_WAKEUP_EXT0) {
+    // Woken by the button: stay up long enough to read the display. The
+    // wake already takes a measurement, so the press itself is consumed.
+    lastInteraction = millis();
+    userActive = true;
+    buttonLastState = LOW;
+    buttonStableState = LOW;
+  }
+
+  LOG_INFO("Woke from deep sleep (%s), wake %u after %lu ms",
+           cause == ESP_SLEEP_WAKEUP_EXT0 ? "button" : "timer",
+           (unsigned)wakeCount, (unsigned long)sleptMs);
+}
+
+unsigned long deviceMillis() {
+  return clockOffset + millis();
+}
+
+void serviceDutyCycle() {
+  // Short intervals would spend more energy rejoining WiFi than sleeping
+  // saves. This follows the adaptive cadence, so fever tracking stays awake
+  // and slow, stable stretches sleep. Builds taking espota uploads stay
+  // awake, where espota can reach them.
+  if (!SLEEP_MODE_ENABLED || DEV_OTA_ENABLED || scheduledInterval < DUTY_CYCLE_MIN_INTERVAL) return;
+
+  // Sleep would cut a download short, and waking goes through the boot
+  // loader, which rolls back firmware that hasn't confirmed itself
+  if (otaBusy() || otaAwaitingConfirmation()) return;
+
+  // Done once this wake's reading has been published or stored, the link has
+  // either come up or given up, any backlog has been replayed and no phone
+  // is connected over BLE
+  bool done = measurementsThisWake > 0 &&
+              uxQueueMessagesWaiting(readingQueue) == 0 &&
+              !linkPending() &&
+              (mqttState != CONN_CONNECTED || (offlineLogPending() == 0 && outboxPending() == 0)) &&
+              (!userActive || millis() - lastInteraction >= DISPLAY_TIMEOUT) &&
+              !bleThermometerConnected() &&
+              !buzzerBusy() &&
+              (!timeSyncPending || deviceMillis() - timeSyncRequestedAt >= NTP_SYNC_TIMEOUT);
+
+  if (done || millis() >= SLEEP_TIMEOUT) {
+    enterDeepSleep();
+  }
+}
+
+void enterDeepSleep() {
+  unsigned long interval = scheduledInterval;
+  unsigned long now = deviceMillis();
+
+  // Wake on the fixed measurement grid, so time spent awake and button
+  // wakes don't shift the cadence. A grid point more than an interval
+  // behind, as after a cold boot or a long awake stretch, or further ahead
+  // than the interval now is, starts the grid again from now. Unsigned
+  // differences keep this right across a millis() wrap.
+  if (nextScheduledWake - now - 1 >= interval) {
+    if (now - nextScheduledWake < interval) {
+      nextScheduledWake += interval;
+    } else {
+      nextScheduledWake = now + interval;
+    }
+  }
+  unsigned long sleepMs = nextScheduledWake - now;  // In (0, interval]
+
+  LOG_INFO("Entering deep sleep for %lu ms", sleepMs);
+
+  if (mqttClient.connected()) {
+    mqttClient.disconnect();
+  }
+  vTaskDelay(pdMS_TO_TICKS(SLEEP_FLUSH_DELAY));
+  logFlush(SLEEP_FLUSH_DELAY);
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+
+  // The bus is never given back; nothing runs after this
+  i2cBusAcquire(I2C_CLIENT_DISPLAY);
+  display.ssd1306_command(SSD1306_DISPLAYOFF);
+  buzzerStop();
+  digitalWrite(LED_PIN, LOW);
+
+  clockOffset = deviceMillis();
+  sleepScheduledMs = nextScheduledWake - clockOffset;
+  if ((long)sleepScheduledMs <= 0) {
+    sleepScheduledMs = 1;
+  }
+  sleepStartedUs = rtcClockUs();
+
+  // The button pulls BUTTON_PIN low
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepScheduledMs * 1000ULL);
+  rtc_gpio_pullup_en((gpio_num_t)BUTTON_PIN);
+  esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_PIN, 0);
+
+  esp_deep_sleep_start();
 }
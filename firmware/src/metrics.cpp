@@ -0,0 +1,152 @@
+#include "metrics.h"
+
+#if METRICS_ENABLED
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <string.h>
+
+// Four buckets per power of two from 1 µs up to 2^27 µs (~134 s); longer
+// durations land in the last bucket
+#define METRICS_SUB_BUCKETS 4
+#define METRICS_MAX_OCTAVE 26
+#define METRICS_BUCKETS ((METRICS_MAX_OCTAVE + 1) * METRICS_SUB_BUCKETS)
+
+struct StageStats {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint16_t buckets[METRICS_BUCKETS];
+};
+
+struct StageSummary {
+  uint32_t count;
+  uint32_t min;
+  uint32_t avg;
+  uint32_t max;
+  uint32_t p99;
+};
+
+static const char* const stageNames[STAGE_COUNT] = {
+  "sensorRead", "serialize", "publish", "displayFlush", "ntpUpdate", "networkLoop",
+  "encrypt", "tlsHandshake"
+};
+
+static const char* const counterNames[COUNTER_COUNT] = {
+  "wifiConnects", "mqttConnects", "droppedReadings", "publishFailures", "outboxDropped",
+  "alertRetries", "tlsResumed"
+};
+
+// Kept in RTC memory so a reporting window can span deep-sleep wakes
+RTC_DATA_ATTR static StageStats stages[STAGE_COUNT];
+RTC_DATA_ATTR static uint32_t counters[COUNTER_COUNT];
+static portMUX_TYPE metricsMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t bucketOf(uint32_t micros) {
+  if (micros < METRICS_SUB_BUCKETS) return micros;
+
+  uint32_t octave = 31 - __builtin_clz(micros);
+  uint32_t sub = (micros >> (octave - 2)) & (METRICS_SUB_BUCKETS - 1);
+  uint32_t bucket = (octave - 1) * METRICS_SUB_BUCKETS + sub;
+  return bucket < METRICS_BUCKETS ? bucket : METRICS_BUCKETS - 1;
+}
+
+// Largest duration that falls in bucket
+static uint32_t bucketUpperBound(uint32_t bucket) {
+  if (bucket < METRICS_SUB_BUCKETS) return bucket;
+
+  uint32_t octave = bucket / METRICS_SUB_BUCKETS + 1;
+  uint32_t sub = bucket % METRICS_SUB_BUCKETS;
+  uint32_t width = 1UL << (octave - 2);
+  return (METRICS_SUB_BUCKETS + sub) * width + width - 1;
+}
+
+static void summarize(const StageStats& stats, StageSummary& summary) {
+  summary.count = stats.count;
+  if (stats.count == 0) {
+    summary.min = summary.avg = summary.max = summary.p99 = 0;
+    return;
+  }
+
+  summary.min = stats.min;
+  summary.max = stats.max;
+  summary.avg = (uint32_t)(stats.total / stats.count);
+
+  // Bucket counts saturate, so a very long window can only overstate p99
+  uint32_t rank = stats.count - stats.count / 100;
+  uint32_t seen = 0;
+  summary.p99 = stats.max;
+  for (uint32_t i = 0; i < METRICS_BUCKETS; i++) {
+    seen += stats.buckets[i];
+    if (seen >= rank) {
+      uint32_t bound = bucketUpperBound(i);
+      summary.p99 = bound < stats.max ? bound : stats.max;
+      break;
+    }
+  }
+}
+
+void metricsRecord(MetricStage stage, MetricsStamp start) {
+  int64_t elapsed = esp_timer_get_time() - start;
+  uint32_t micros = elapsed < 0 ? 0 : (elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed);
+  uint32_t bucket = bucketOf(micros);
+
+  portENTER_CRITICAL(&metricsMux);
+  StageStats& stats = stages[stage];
+  if (stats.count == 0 || micros < stats.min) stats.min = micros;
+  if (micros > stats.max) stats.max = micros;
+  stats.total += micros;
+  stats.count++;
+  if (stats.buckets[bucket] < UINT16_MAX) stats.buckets[bucket]++;
+  portEXIT_CRITICAL(&metricsMux);
+}
+
+void metricsIncrement(MetricCounter counter) {
+  portENTER_CRITICAL(&metricsMux);
+  counters[counter]++;
+  portEXIT_CRITICAL(&metricsMux);
+}
+
+size_t metricsSerialize(char* out, size_t capacity, unsigned long windowMs) {
+  StageSummary summaries[STAGE_COUNT];
+  uint32_t counterValues[COUNTER_COUNT];
+
+  portENTER_CRITICAL(&metricsMux);
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    summarize(stages[i], summaries[i]);
+  }
+  memcpy(counterValues, counters, sizeof(counterValues));
+  portEXIT_CRITICAL(&metricsMux);
+
+  // Each stage is [count, min, avg, max, p99]
+  StaticJsonDocument<1024> doc;
+  doc["window"] = windowMs;
+
+  JsonObject stageObject = doc.createNestedObject("stages");
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    JsonArray values = stageObject.createNestedArray(stageNames[i]);
+    values.add(summaries[i].count);
+    values.add(summaries[i].min);
+    values.add(summaries[i].avg);
+    values.add(summaries[i].max);
+    values.add(summaries[i].p99);
+  }
+
+  JsonObject counterObject = doc.createNestedObject("counters");
+  for (uint8_t i = 0; i < COUNTER_COUNT; i++) {
+    counterObject[counterNames[i]] = counterValues[i];
+  }
+
+  if (doc.overflowed() || measureJson(doc) >= capacity) return 0;
+  return serializeJson(doc, out, capacity);
+}
+
+void metricsReset() {
+  portENTER_CRITICAL(&metricsMux);
+  memset(stages, 0, sizeof(stages));
+  memset(counters, 0, sizeof(counters));
+  portEXIT_CRITICAL(&metricsMux);
+}
+
+#endif // METRICS_ENABLED
@@ -0,0 +1,77 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Hot-path timing and event counters, reported on the /metrics topic.
+//
+// Each stage keeps count, min, max, sum and a log-linear histogram (four
+// buckets per power of two) of durations in microseconds, so p99 is
+// accurate to within a quarter octave. Release builds (RELEASE_MODE) compile
+// all of this out: the calls below become empty inlines.
+#ifdef RELEASE_MODE
+#define METRICS_ENABLED 0
+#else
+#define METRICS_ENABLED 1
+#endif
+
+enum MetricStage {
+  STAGE_SENSOR_READ,
+  STAGE_SERIALIZE,
+  STAGE_PUBLISH,
+  STAGE_DISPLAY_FLUSH,
+  STAGE_NTP_UPDATE,
+  STAGE_NETWORK_LOOP,
+  STAGE_ENCRYPT,
+  STAGE_TLS_HANDSHAKE,
+  STAGE_COUNT
+};
+
+enum MetricCounter {
+  COUNTER_WIFI_CONNECTS,
+  COUNTER_MQTT_CONNECTS,
+  COUNTER_DROPPED_READINGS,
+  COUNTER_PUBLISH_FAILURES,
+  COUNTER_OUTBOX_DROPPED,
+  COUNTER_ALERT_RETRIES,
+  COUNTER_TLS_RESUMED,
+  COUNTER_COUNT
+};
+
+// Largest payload metricsSerialize() produces
+#define METRICS_PAYLOAD_SIZE 640
+
+#if METRICS_ENABLED
+
+#include <esp_timer.h>
+
+typedef int64_t MetricsStamp;
+
+inline MetricsStamp metricsNow() {
+  return esp_timer_get_time();
+}
+
+// Records the time from start until now against stage. Safe from any task.
+void metricsRecord(MetricStage stage, MetricsStamp start);
+
+void metricsIncrement(MetricCounter counter);
+
+// Writes the current window as JSON, returning its length or 0 if it didn't
+// fit. Durations are in microseconds.
+size_t metricsSerialize(char* out, size_t capacity, unsigned long windowMs);
+
+// Starts a new reporting window
+void metricsReset();
+
+#else
+
+typedef int32_t MetricsStamp;
+
+inline MetricsStamp metricsNow() { return 0; }
+inline void metricsRecord(MetricStage, MetricsStamp) {}
+inline void metricsIncrement(MetricCounter) {}
+
+#endif // METRICS_ENABLED
+
+#endif // METRICS_H
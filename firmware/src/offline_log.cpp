@@ -0,0 +1,245 @@
+#include "offline_log.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "checksum.h"
+#include "config.h"
+#include "device_log.h"
+
+#define OFFLINE_LOG_DIR "/log"
+#define OFFLINE_LOG_CURSOR OFFLINE_LOG_DIR "/cursor"
+#define OFFLINE_LOG_CURSOR_TEMP OFFLINE_LOG_DIR "/cursor.tmp"
+
+// Upper bound on slots Peek() will step over per call, so a long run of
+// missing records can't stall the network task
+#define PEEK_SCAN_LIMIT (4 * REPLAY_BATCH_SIZE)
+
+static bool logReady = false;
+
+// RTC memory is only reinitialised on a cold boot, so after a deep-sleep
+// wake these still describe the files on flash
+RTC_DATA_ATTR static uint32_t nextSeq = 1;
+RTC_DATA_ATTR static uint32_t highWaterMark = 0;
+RTC_DATA_ATTR static bool countersRecovered = false;
+
+// Sequence numbers start at 1 so that a high-water mark of 0 means
+// "nothing delivered"; seq 1 occupies slot 0 of segment 0.
+static uint32_t segmentOf(uint32_t seq) {
+  return ((seq - 1) / OFFLINE_LOG_SEGMENT_RECORDS) % OFFLINE_LOG_SEGMENTS;
+}
+
+static uint32_t slotOf(uint32_t seq) {
+  return (seq - 1) % OFFLINE_LOG_SEGMENT_RECORDS;
+}
+
+// First sequence number of the segment after the one holding seq
+static uint32_t nextSegmentStart(uint32_t seq) {
+  return ((seq - 1) / OFFLINE_LOG_SEGMENT_RECORDS + 1) * OFFLINE_LOG_SEGMENT_RECORDS + 1;
+}
+
+static void segmentPath(uint32_t segment, char* path, size_t size) {
+  snprintf(path, size, OFFLINE_LOG_DIR "/seg%u", (unsigned)segment);
+}
+
+static uint32_t recordSeq(const uint8_t* record) {
+  return (uint32_t)record[0] | ((uint32_t)record[1] << 8) |
+         ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+}
+
+// Records in an older frame layout fail the version check and are skipped
+static bool recordValid(const uint8_t* record) {
+  return record[4] == TELEMETRY_BINARY_VERSION &&
+         crc8(record, OFFLINE_RECORD_SIZE - 1) == record[OFFLINE_RECORD_SIZE - 1];
+}
+
+// Oldest sequence number still held by the ring
+static uint32_t oldestRetained() {
+  if (nextSeq <= 1) return 1;
+
+  uint32_t newestSegment = (nextSeq - 2) / OFFLINE_LOG_SEGMENT_RECORDS;
+  if (newestSegment < OFFLINE_LOG_SEGMENTS - 1) {
+    return 1;
+  }
+  return (newestSegment - (OFFLINE_LOG_SEGMENTS - 1)) * OFFLINE_LOG_SEGMENT_RECORDS + 1;
+}
+
+static uint32_t firstPending() {
+  uint32_t oldest = oldestRetained();
+  return highWaterMark + 1 > oldest ? highWaterMark + 1 : oldest;
+}
+
+bool offlineLogBegin() {
+  if (!LittleFS.exists(OFFLINE_LOG_DIR) && !LittleFS.mkdir(OFFLINE_LOG_DIR)) {
+    LOG_ERROR("Offline log: could not create " OFFLINE_LOG_DIR);
+    return false;
+  }
+
+  if (countersRecovered) {
+    logReady = true;
+    return true;
+  }
+
+  File cursor = LittleFS.open(OFFLINE_LOG_CURSOR, FILE_READ);
+  if (cursor) {
+    uint8_t raw[4];
+    if (cursor.read(raw, sizeof(raw)) == sizeof(raw)) {
+      highWaterMark = recordSeq(raw);
+    }
+    cursor.close();
+  }
+
+  // The newest intact record across all segments gives the sequence counter.
+  // If its segment has a torn tail (power lost mid-write), appending there
+  // would break slot addressing, so continue from the next segment instead.
+  uint32_t newestSeq = 0;
+  bool newestAligned = true;
+  uint8_t record[OFFLINE_RECORD_SIZE];
+  char path[24];
+
+  for (uint32_t segment = 0; segment < OFFLINE_LOG_SEGMENTS; segment++) {
+    segmentPath(segment, path, sizeof(path));
+    File file = LittleFS.open(path, FILE_READ);
+    if (!file) continue;
+
+    size_t records = file.size() / OFFLINE_RECORD_SIZE;
+    if (records > 0 && file.seek((records - 1) * OFFLINE_RECORD_SIZE) &&
+        file.read(record, OFFLINE_RECORD_SIZE) == OFFLINE_RECORD_SIZE && recordValid(record)) {
+      uint32_t seq = recordSeq(record);
+      if (seq > newestSeq) {
+        newestSeq = seq;
+        newestAligned = (file.size() == (slotOf(seq) + 1) * OFFLINE_RECORD_SIZE);
+      }
+    }
+    file.close();
+  }
+
+  if (newestSeq > 0) {
+    nextSeq = newestAligned ? newestSeq + 1 : nextSegmentStart(newestSeq);
+  }
+  if (nextSeq <= highWaterMark) {
+    nextSeq = highWaterMark + 1;
+  }
+
+  logReady = true;
+  countersRecovered = true;
+  LOG_INFO("Offline log ready: next seq %u, high-water mark %u, %u pending",
+           (unsigned)nextSeq, (unsigned)highWaterMark, (unsigned)offlineLogPending());
+  return true;
+}
+
+bool offlineLogAppend(const uint8_t* frame) {
+  if (!logReady) return false;
+
+  uint8_t record[OFFLINE_RECORD_SIZE];
+  char path[24];
+
+  // At most two tries: if the current segment's length doesn't match the
+  // slot we expect, abandon the rest of it and start the next one
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    uint32_t seq = nextSeq;
+    segmentPath(segmentOf(seq), path, sizeof(path));
+
+    // Starting a segment truncates whatever the ring left there last time
+    File file = LittleFS.open(path, slotOf(seq) == 0 ? FILE_WRITE : FILE_APPEND);
+    if (!file) return false;
+
+    if (file.size() != slotOf(seq) * OFFLINE_RECORD_SIZE) {
+      file.close();
+      nextSeq = nextSegmentStart(seq);
+      continue;
+    }
+
+    record[0] = seq & 0xFF;
+    record[1] = (seq >> 8) & 0xFF;
+    record[2] = (seq >> 16) & 0xFF;
+    record[3] = seq >> 24;
+    memcpy(record + 4, frame, READING_FRAME_SIZE);
+    record[OFFLINE_RECORD_SIZE - 1] = crc8(record, OFFLINE_RECORD_SIZE - 1);
+
+    size_t written = file.write(record, OFFLINE_RECORD_SIZE);
+    file.close();
+
+    if (written != OFFLINE_RECORD_SIZE) {
+      nextSeq = nextSegmentStart(seq);
+      return false;
+    }
+    nextSeq = seq + 1;
+    return true;
+  }
+  return false;
+}
+
+uint32_t offlineLogPending() {
+  if (!logReady) return 0;
+  uint32_t first = firstPending();
+  return nextSeq > first ? nextSeq - first : 0;
+}
+
+uint8_t offlineLogPeek(uint8_t* out, size_t capacity, uint8_t maxRecords, uint32_t* lastSeq) {
+  uint8_t count = 0;
+  uint32_t seq = firstPending();
+  uint32_t scanned = 0;
+  *lastSeq = highWaterMark;
+
+  if (!logReady) return 0;
+
+  File file;
+  uint32_t openSegment = UINT32_MAX;
+  uint8_t record[OFFLINE_RECORD_SIZE];
+  char path[24];
+
+  while (seq < nextSeq && count < maxRecords && scanned < PEEK_SCAN_LIMIT &&
+         (size_t)(count + 1) * REPLAY_RECORD_SIZE <= capacity) {
+    if (segmentOf(seq) != openSegment) {
+      if (file) file.close();
+      openSegment = segmentOf(seq);
+      segmentPath(openSegment, path, sizeof(path));
+      file = LittleFS.open(path, FILE_READ);
+    }
+
+    // Slots that were never written or were torn are skipped, but still
+    // count as examined so acknowledging moves past them
+    if (file && file.seek(slotOf(seq) * OFFLINE_RECORD_SIZE) &&
+        file.read(record, OFFLINE_RECORD_SIZE) == OFFLINE_RECORD_SIZE &&
+        recordValid(record) && recordSeq(record) == seq) {
+      memcpy(out + count * REPLAY_RECORD_SIZE, record, REPLAY_RECORD_SIZE);
+      count++;
+    }
+
+    *lastSeq = seq;
+    seq++;
+    scanned++;
+  }
+
+  if (file) file.close();
+  return count;
+}
+
+// The new mark is written beside the old one and renamed over it, which
+// LittleFS does atomically. Rewriting the cursor in place could leave it
+// truncated after a power cut, and offlineLogBegin() would then replay
+// everything still on flash.
+void offlineLogAcknowledge(uint32_t seq) {
+  if (!logReady || seq <= highWaterMark) return;
+
+  highWaterMark = seq;
+
+  File cursor = LittleFS.open(OFFLINE_LOG_CURSOR_TEMP, FILE_WRITE);
+  if (!cursor) return;
+
+  uint8_t raw[4] = {
+    (uint8_t)(seq & 0xFF), (uint8_t)((seq >> 8) & 0xFF),
+    (uint8_t)((seq >> 16) & 0xFF), (uint8_t)(seq >> 24)
+  };
+  bool written = cursor.write(raw, sizeof(raw)) == sizeof(raw);
+  cursor.close();
+
+  if (!written || !LittleFS.rename(OFFLINE_LOG_CURSOR_TEMP, OFFLINE_LOG_CURSOR)) {
+    LOG_WARN("Offline log: could not store the high-water mark");
+  }
+}
+
+uint32_t offlineLogHighWaterMark() {
+  return highWaterMark;
+}
@@ -0,0 +1,54 @@
+#ifndef OFFLINE_LOG_H
+#define OFFLINE_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telemetry_codec.h"
+
+// Persistent store-and-forward log of readings that could not be published.
+//
+// Records are fixed size and live in OFFLINE_LOG_SEGMENTS segment files used
+// as a ring. Every record gets the next 32-bit sequence number, and a
+// sequence number alone gives its segment and slot, so nothing needs an
+// index. Segments are only ever appended to and are truncated when the ring
+// wraps onto them. That keeps flash writes sequential and spread across
+// files. Once the ring wraps, the oldest unsent records are overwritten.
+//
+// The high-water mark is the highest sequence number the backend has been
+// sent. It is persisted once per replayed batch, not once per record.
+//
+// Both counters are also kept in RTC memory, so waking from deep sleep
+// skips the segment scan that a cold boot needs.
+
+// seq(4) + reading frame + crc8(1)
+#define OFFLINE_RECORD_SIZE (4 + READING_FRAME_SIZE + 1)
+
+// seq(4) + reading frame, as carried in replay batches
+#define REPLAY_RECORD_SIZE (4 + READING_FRAME_SIZE)
+
+// Mounts the log directory and recovers the sequence counter and high-water
+// mark, from RTC memory after a deep-sleep wake. Returns false if storage is
+// unavailable; all calls then become no-ops.
+bool offlineLogBegin();
+
+// Appends one READING_FRAME_SIZE frame, returning false if it wasn't stored
+bool offlineLogAppend(const uint8_t* frame);
+
+// Slots appended but not yet acknowledged. May overcount slightly after a
+// torn write, since the rest of that segment is skipped.
+uint32_t offlineLogPending();
+
+// Copies up to maxRecords of the oldest pending records into out as
+// REPLAY_RECORD_SIZE entries without consuming them. Returns the number of
+// records copied; lastSeq is the last slot examined, which may be past the
+// last record copied if missing slots were skipped. Acknowledge lastSeq once
+// the batch is delivered, even when nothing was copied.
+uint8_t offlineLogPeek(uint8_t* out, size_t capacity, uint8_t maxRecords, uint32_t* lastSeq);
+
+// Marks everything up to and including seq as delivered
+void offlineLogAcknowledge(uint32_t seq);
+
+uint32_t offlineLogHighWaterMark();
+
+#endif // OFFLINE_LOG_H
@@ -0,0 +1,325 @@
+#include "ota_update.h"
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <esp_ota_ops.h>
+#include <esp32/rom/miniz.h>
+#include <sdkconfig.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/sha256.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+
+#include "secrets.h"
+#include "device_log.h"
+
+#if DEV_OTA_ENABLED
+#include <ArduinoOTA.h>
+#endif
+
+// Without rollback in the boot loader a pending image is simply kept, and
+// probation would never hand a broken update back
+#if !CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE
+#error "OTA needs a boot loader built with CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE"
+#endif
+
+#if DEV_OTA_ENABLED && defined(RELEASE_MODE)
+#error "DEV_OTA_ENABLED accepts unsigned images and is for development builds only"
+#endif
+
+enum OtaState : uint8_t {
+  OTA_STATE_IDLE,
+  OTA_STATE_RUNNING,
+  OTA_STATE_FINISHED      // Result not taken yet
+};
+
+// Everything one download needs, owned by the OTA task while it runs
+struct OtaJob {
+  OtaRequest request;
+  esp_ota_handle_t handle;
+  const esp_partition_t* partition;
+  mbedtls_sha256_context sha;
+  uint8_t* chunk;
+  tinfl_decompressor* inflator;   // Compressed images only
+  uint8_t* dictionary;            // Inflate output window, TINFL_LZ_DICT_SIZE
+  size_t dictionaryOffset;
+  bool inflated;                  // The zlib stream has ended
+  size_t imageSize;
+};
+
+static OtaJob job;
+static volatile OtaState state = OTA_STATE_IDLE;
+static OtaResult result = OTA_NONE;
+static const char* resultError = NULL;
+static bool awaitingConfirmation = false;
+
+// The Arduino core marks the image valid at boot unless this says otherwise;
+// the heartbeat decides instead
+bool verifyRollbackLater() {
+  return true;
+}
+
+static bool writeImage(const uint8_t* data, size_t length) {
+  if (esp_ota_write(job.handle, data, length) != ESP_OK) return false;
+  mbedtls_sha256_update_ret(&job.sha, data, length);
+  job.imageSize += length;
+  return true;
+}
+
+// Inflates compressed input into the circular window, writing out each
+// stretch as it is produced
+static bool inflateChunk(const uint8_t* input, size_t length, bool last) {
+  int flags = TINFL_FLAG_PARSE_ZLIB_HEADER | (last ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+
+  for (;;) {
+    size_t consumed = length;
+    size_t produced = TINFL_LZ_DICT_SIZE - job.dictionaryOffset;
+    tinfl_status status = tinfl_decompress(job.inflator, input, &consumed, job.dictionary,
+                                           job.dictionary + job.dictionaryOffset, &produced, flags);
+    input += consumed;
+    length -= consumed;
+
+    if (produced > 0 && !writeImage(job.dictionary + job.dictionaryOffset, produced)) return false;
+    job.dictionaryOffset = (job.dictionaryOffset + produced) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status < TINFL_STATUS_DONE) return false;
+    if (status == TINFL_STATUS_DONE) {
+      job.inflated = true;
+      return true;
+    }
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && length == 0) return true;
+    if (consumed == 0 && produced == 0) return false;
+  }
+}
+
+static const char* download() {
+  WiFiClientSecure client;
+  client.setCACert(OTA_CA_CERT);
+  client.setTimeout(OTA_READ_TIMEOUT / 1000);
+
+  HTTPClient http;
+  if (!http.begin(client, job.request.url)) return "bad url";
+  http.setTimeout(OTA_READ_TIMEOUT);
+
+  int status = http.GET();
+  if (status != HTTP_CODE_OK) {
+    http.end();
+    return "http error";
+  }
+
+  // Streamed by hand to keep memory flat; that needs a Content-Length
+  int total = http.getSize();
+  if (total <= 0) {
+    http.end();
+    return "no content length";
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  const char* error = NULL;
+  int received = 0;
+  unsigned long lastData = millis();
+  while (received < total && error == NULL) {
+    size_t available = stream->available();
+    if (available == 0) {
+      if (!stream->connected()) {
+        error = "connection lost";
+      } else if (millis() - lastData >= OTA_READ_TIMEOUT) {
+        error = "timed out";
+      } else {
+        vTaskDelay(pdMS_TO_TICKS(10));
+      }
+      continue;
+    }
+
+    size_t wanted = available < OTA_CHUNK_SIZE ? available : OTA_CHUNK_SIZE;
+    if ((int)wanted > total - received) wanted = total - received;
+    int count = stream->read(job.chunk, wanted);
+    if (count <= 0) continue;
+    received += count;
+    lastData = millis();
+
+    bool written = job.request.compressed ?
+                   inflateChunk(job.chunk, count, received == total) :
+                   writeImage(job.chunk, count);
+    if (!written) {
+      error = job.request.compressed ? "bad compressed image" : "flash write failed";
+    }
+  }
+  http.end();
+
+  if (error == NULL && job.request.compressed && !job.inflated) {
+    error = "truncated image";
+  }
+  return error;
+}
+
+static bool signatureValid(const uint8_t* digest) {
+  mbedtls_pk_context key;
+  mbedtls_pk_init(&key);
+
+  // PEM needs its terminating NUL counted
+  bool valid = mbedtls_pk_parse_public_key(&key, (const unsigned char*)OTA_SIGNING_KEY,
+                                           strlen(OTA_SIGNING_KEY) + 1) == 0 &&
+               mbedtls_pk_verify(&key, MBEDTLS_MD_SHA256, digest, 32,
+                                 job.request.signature, job.request.signatureLength) == 0;
+  mbedtls_pk_free(&key);
+  return valid;
+}
+
+static const char* install() {
+  job.partition = esp_ota_get_next_update_partition(NULL);
+  if (job.partition == NULL) return "no update partition";
+
+  // Sequential writes erase a sector at a time just ahead of the data,
+  // rather than the whole slot up front with the caches off for seconds
+  if (esp_ota_begin(job.partition, OTA_WITH_SEQUENTIAL_WRITES, &job.handle) != ESP_OK) {
+    return "ota begin failed";
+  }
+
+  mbedtls_sha256_init(&job.sha);
+  mbedtls_sha256_starts_ret(&job.sha, 0);
+
+  const char* error = download();
+
+  uint8_t digest[32];
+  mbedtls_sha256_finish_ret(&job.sha, digest);
+  mbedtls_sha256_free(&job.sha);
+
+  if (error == NULL && !signatureValid(digest)) {
+    error = "bad signature";
+  }
+  if (error != NULL) {
+    esp_ota_abort(job.handle);
+    return error;
+  }
+
+  // esp_ota_end checks the image header and checksum as well
+  if (esp_ota_end(job.handle) != ESP_OK) return "invalid image";
+  if (esp_ota_set_boot_partition(job.partition) != ESP_OK) return "set boot failed";
+  return NULL;
+}
+
+static void otaTask(void* parameter) {
+  job.chunk = (uint8_t*)malloc(OTA_CHUNK_SIZE);
+  if (job.request.compressed) {
+    job.inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+    job.dictionary = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+    if (job.inflator != NULL) tinfl_init(job.inflator);
+  }
+
+  const char* error;
+  if (job.chunk == NULL || (job.request.compressed && (job.inflator == NULL || job.dictionary == NULL))) {
+    error = "out of memory";
+  } else {
+    error = install();
+  }
+
+  free(job.chunk);
+  free(job.inflator);
+  free(job.dictionary);
+
+  if (error == NULL) {
+    LOG_INFO("OTA: %s installed, %u bytes", job.request.version, (unsigned)job.imageSize);
+  } else {
+    LOG_ERROR("OTA: %s failed, %s", job.request.version, error);
+  }
+  resultError = error;
+  result = error == NULL ? OTA_INSTALLED : OTA_FAILED;
+  state = OTA_STATE_FINISHED;
+  vTaskDelete(NULL);
+}
+
+void otaBegin() {
+  esp_ota_img_states_t imageState;
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  bool known = esp_ota_get_state_partition(running, &imageState) == ESP_OK;
+  awaitingConfirmation = known && imageState == ESP_OTA_IMG_PENDING_VERIFY;
+  if (awaitingConfirmation) {
+    LOG_INFO("OTA: new firmware on probation until its first heartbeat");
+  }
+
+  // A boot loader with rollback moves a new image on to pending-verify
+  // before starting it. One still marked new booted through a boot loader
+  // that can't roll back, which only a serial flash replaces.
+  if (known && imageState == ESP_OTA_IMG_NEW) {
+    LOG_ERROR("OTA: boot loader has no rollback, updates are unprotected");
+    esp_ota_mark_app_valid_cancel_rollback();
+  }
+}
+
+bool otaStart(const OtaRequest& request, const char** error) {
+  if (state != OTA_STATE_IDLE) {
+    *error = "update in progress";
+    return false;
+  }
+  // Updating from an image that may yet roll back would leave nothing to
+  // roll back to
+  if (awaitingConfirmation) {
+    *error = "firmware not confirmed";
+    return false;
+  }
+
+  memset(&job, 0, sizeof(job));
+  job.request = request;
+  state = OTA_STATE_RUNNING;
+  if (xTaskCreatePinnedToCore(otaTask, "ota", OTA_TASK_STACK, NULL,
+                              OTA_TASK_PRIORITY, NULL, OTA_TASK_CORE) != pdPASS) {
+    state = OTA_STATE_IDLE;
+    *error = "out of memory";
+    return false;
+  }
+  return true;
+}
+
+bool otaBusy() {
+  return state != OTA_STATE_IDLE || result == OTA_INSTALLED;
+}
+
+OtaResult otaTakeResult(const char** error) {
+  if (state != OTA_STATE_FINISHED) return OTA_NONE;
+  *error = resultError;
+  state = OTA_STATE_IDLE;
+  return result;
+}
+
+bool otaAwaitingConfirmation() {
+  return awaitingConfirmation;
+}
+
+void otaConfirmImage() {
+  if (!awaitingConfirmation) return;
+  if (esp_ota_mark_app_valid_cancel_rollback() == ESP_OK) {
+    awaitingConfirmation = false;
+    LOG_INFO("OTA: new firmware confirmed");
+  }
+}
+
+void otaRollback() {
+  LOG_WARN("OTA: rolling back to the previous firmware");
+  esp_ota_mark_app_invalid_rollback_and_reboot();
+}
+
+#if DEV_OTA_ENABLED
+
+void otaLocalBegin(const char* hostname) {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  ArduinoOTA.setHostname(hostname);
+  ArduinoOTA.setPort(DEV_OTA_PORT);
+  ArduinoOTA.setPassword(DEV_OTA_PASSWORD);
+  ArduinoOTA.onStart([]() { LOG_INFO("OTA: espota upload started"); });
+  ArduinoOTA.onEnd([]() { LOG_INFO("OTA: espota upload finished, restarting"); });
+  ArduinoOTA.onError([](ota_error_t error) { LOG_WARN("OTA: espota upload failed, error %d", (int)error); });
+  ArduinoOTA.begin();
+  LOG_WARN("OTA: accepting unsigned espota uploads on port %d", DEV_OTA_PORT);
+}
+
+void otaLocalService() {
+  ArduinoOTA.handle();
+}
+
+#endif // DEV_OTA_ENABLED
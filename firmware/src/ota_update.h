@@ -0,0 +1,86 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pull-based firmware updates into the inactive slot of the A/B partition
+// table (partitions_ota.csv).
+//
+// otaStart() hands the download to a background task on the network core,
+// below the network task's priority, so measurements, publishing and the
+// display carry on while it runs. The image is streamed over HTTPS in
+// OTA_CHUNK_SIZE pieces straight into flash, optionally zlib-compressed,
+// and is only made bootable once its SHA-256 verifies against the ECDSA
+// signature from the command and OTA_SIGNING_KEY.
+//
+// The new image boots on probation: unless otaConfirmImage() is called, the
+// boot loader falls back to the previous one at the next reset, and
+// otaRollback() forces that reset. That is the boot loader's doing, so it
+// has to be built with CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE, as the
+// Arduino core's is; the build checks the matching sdkconfig. An update
+// never replaces the boot loader, so a device flashed over serial with an
+// older one keeps it, and otaBegin() reports that.
+//
+// Development builds with DEV_OTA_ENABLED also accept espota uploads on
+// the local network (env:esp32dev_ota). Those skip the signature check and
+// must never ship.
+#define OTA_URL_SIZE 256
+#define OTA_VERSION_SIZE 24
+#define OTA_SIGNATURE_MAX_SIZE 72      // DER-encoded ECDSA P-256 signature
+#define OTA_CHUNK_SIZE 4096            // Bytes read from the socket at a time
+#define OTA_READ_TIMEOUT 15000         // ms without data before a download is abandoned
+#define OTA_TASK_STACK 6144
+#define OTA_TASK_PRIORITY 1
+#define OTA_TASK_CORE 0
+
+struct OtaRequest {
+  char url[OTA_URL_SIZE];
+  char version[OTA_VERSION_SIZE];
+  uint8_t signature[OTA_SIGNATURE_MAX_SIZE];
+  size_t signatureLength;
+  bool compressed;                     // zlib stream rather than a raw image
+};
+
+enum OtaResult {
+  OTA_NONE,
+  OTA_INSTALLED,                       // Boots from the new slot on the next restart
+  OTA_FAILED
+};
+
+// Checks whether the running image is still on probation. Call once at boot.
+void otaBegin();
+
+// Starts downloading request in the background. Returns false, with the
+// reason in error, if an update is already running or can't start.
+bool otaStart(const OtaRequest& request, const char** error);
+
+// An update is downloading or waiting to be restarted into
+bool otaBusy();
+
+// The outcome of the last update, returned once after it finishes.
+// error is set for OTA_FAILED.
+OtaResult otaTakeResult(const char** error);
+
+// The running image hasn't confirmed itself yet
+bool otaAwaitingConfirmation();
+
+// Keeps the running image. Cheap when there is nothing to confirm.
+void otaConfirmImage();
+
+// Marks the running image invalid and restarts into the previous one
+void otaRollback();
+
+#if DEV_OTA_ENABLED
+#define DEV_OTA_PORT 3232
+
+// Starts listening for espota uploads. Call once WiFi is up; again is
+// harmless.
+void otaLocalBegin(const char* hostname);
+
+// Serves a pending espota upload, blocking until it is done. Network task
+// only.
+void otaLocalService();
+#endif
+
+#endif // OTA_UPDATE_H
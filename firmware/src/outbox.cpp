@@ -0,0 +1,168 @@
+#include "outbox.h"
+
+#include <string.h>
+
+#include "metrics.h"
+
+struct OutboxSlot {
+  bool used;
+  OutboxPriority priority;
+  uint8_t attempts;
+  bool sealed;              // Payload holds the ciphertext sent on every attempt
+  uint32_t ackId;           // 0 when no ack is expected
+  uint32_t order;           // Post order, oldest first within a priority
+  unsigned long dueAt;      // ms, for repeats; never-sent messages are always due
+  const char* topic;
+  uint16_t length;
+  uint8_t payload[OUTBOX_PAYLOAD_SIZE + PAYLOAD_CRYPTO_OVERHEAD];
+};
+
+static OutboxSlot slots[OUTBOX_SLOTS];
+static OutboxPublish publishFn = NULL;
+static OutboxSeal sealFn = NULL;
+static uint32_t nextOrder = 0;
+static bool retryNow = false;   // Next service makes every repeat due
+
+static unsigned long retryDelay(uint8_t attempts) {
+  unsigned long delay = OUTBOX_RETRY_BASE;
+  for (uint8_t i = 1; i < attempts && delay < OUTBOX_RETRY_MAX; i++) {
+    delay *= 2;
+  }
+  return delay < OUTBOX_RETRY_MAX ? delay : OUTBOX_RETRY_MAX;
+}
+
+// True if a is less urgent than b. Within a priority the oldest goes first.
+static bool lessUrgent(const OutboxSlot& a, const OutboxSlot& b) {
+  if (a.priority != b.priority) return a.priority > b.priority;
+  return (int32_t)(a.order - b.order) > 0;
+}
+
+static OutboxSlot* findSlot(OutboxPriority priority, const char* topic, uint32_t ackId) {
+  OutboxSlot* freeSlot = NULL;
+  OutboxSlot* victim = NULL;
+
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    OutboxSlot& slot = slots[i];
+    if (!slot.used) {
+      if (!freeSlot) freeSlot = &slot;
+      continue;
+    }
+    // A newer status supersedes the queued one
+    if (ackId == 0 && slot.ackId == 0 && slot.priority == priority && slot.topic == topic) {
+      return &slot;
+    }
+    if (slot.ackId == 0 && slot.priority >= priority && (!victim || lessUrgent(slot, *victim))) {
+      victim = &slot;
+    }
+  }
+
+  if (freeSlot) return freeSlot;
+  if (victim) metricsIncrement(COUNTER_OUTBOX_DROPPED);
+  return victim;
+}
+
+void outboxBegin(OutboxPublish publish, OutboxSeal seal) {
+  publishFn = publish;
+  sealFn = seal;
+  memset(slots, 0, sizeof(slots));
+}
+
+bool outboxPost(OutboxPriority priority, const char* topic, const uint8_t* payload,
+                size_t length, uint32_t ackId) {
+  OutboxSlot* slot = length <= OUTBOX_PAYLOAD_SIZE ? findSlot(priority, topic, ackId) : NULL;
+  if (!slot) {
+    metricsIncrement(COUNTER_OUTBOX_DROPPED);
+    return false;
+  }
+
+  memcpy(slot->payload, payload, length);
+  slot->used = true;
+  slot->priority = priority;
+  slot->attempts = 0;
+  slot->sealed = sealFn == NULL;
+  slot->ackId = ackId;
+  slot->order = nextOrder++;
+  slot->topic = topic;
+  slot->length = length;
+  return true;
+}
+
+uint8_t outboxService(OutboxPriority through, unsigned long now) {
+  if (!publishFn) return 0;
+
+  if (retryNow) {
+    for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+      slots[i].dueAt = now;
+    }
+    retryNow = false;
+  }
+
+  uint8_t published = 0;
+  while (published < OUTBOX_BURST) {
+    OutboxSlot* next = NULL;
+    for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+      OutboxSlot& slot = slots[i];
+      if (!slot.used || slot.priority > through) continue;
+      if (slot.attempts > 0 && (long)(now - slot.dueAt) < 0) continue;
+      if (!next || lessUrgent(*next, slot)) next = &slot;
+    }
+    if (!next) break;
+
+    // Sealed only now the link is up, so the nonce comes from the RF
+    // noise source rather than the pseudo-random fallback
+    if (!next->sealed) {
+      size_t sealed = sealFn(next->topic, next->payload, next->length, sizeof(next->payload));
+      if (sealed == 0) {
+        next->used = false;
+        metricsIncrement(COUNTER_OUTBOX_DROPPED);
+        continue;
+      }
+      next->length = sealed;
+      next->sealed = true;
+    }
+
+    // A failed publish means the link is congested or down; keep the
+    // message and try again on the next call
+    if (!publishFn(next->topic, next->payload, next->length)) break;
+    published++;
+
+    if (next->ackId == 0) {
+      next->used = false;
+      continue;
+    }
+
+    if (next->attempts > 0) {
+      metricsIncrement(COUNTER_ALERT_RETRIES);
+    }
+    next->attempts++;
+    if (next->attempts >= OUTBOX_MAX_ATTEMPTS) {
+      next->used = false;  // Never acknowledged; stop repeating it
+      metricsIncrement(COUNTER_OUTBOX_DROPPED);
+    } else {
+      next->dueAt = now + retryDelay(next->attempts);
+    }
+  }
+
+  return published;
+}
+
+void outboxAcknowledge(uint32_t ackId) {
+  if (ackId == 0) return;
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    if (slots[i].used && slots[i].ackId == ackId) {
+      slots[i].used = false;
+    }
+  }
+}
+
+uint8_t outboxPending() {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < OUTBOX_SLOTS; i++) {
+    if (slots[i].used) count++;
+  }
+  return count;
+}
+
+void outboxRetryNow() {
+  retryNow = true;
+}
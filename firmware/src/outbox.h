@@ -0,0 +1,72 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "payload_crypto.h"
+
+// Outbound messages waiting for the MQTT link, drained most urgent first.
+// Network task only.
+//
+// Alerts go out before anything else. Readings are not held here: they
+// keep their own durable path through batching and the offline log, and
+// the network task services them between the two classes below, so a
+// heartbeat can never delay an alert or a reading.
+//
+// PubSubClient only publishes at QoS 0, so delivery of alerts is confirmed
+// at the application level. A message posted with an ack ID is repeated
+// with backoff until outboxAcknowledge() is called with that ID, which the
+// backend triggers with an "ack_alert" command, or until it has been sent
+// OUTBOX_MAX_ATTEMPTS times. Status messages without an ack ID are sent
+// once, and a newer one for the same topic replaces one still queued.
+//
+// When a seal function is given, each message is sealed once, just before
+// its first publish, and repeats resend the same ciphertext. Sealing waits
+// for the link because messages may be posted while WiFi is down.
+enum OutboxPriority : uint8_t {
+  OUTBOX_ALERT,
+  OUTBOX_STATUS
+};
+
+#define OUTBOX_SLOTS 6
+#define OUTBOX_PAYLOAD_SIZE 640     // Largest payload a slot holds
+#define OUTBOX_BURST 4              // Most messages published per service call
+#define OUTBOX_MAX_ATTEMPTS 6
+#define OUTBOX_RETRY_BASE 5000      // ms before the first repeat, doubling after that
+#define OUTBOX_RETRY_MAX 40000      // ms
+// ms from the first send to the last repeat: 5 + 10 + 20 + 40 + 40 s. The
+// device stays awake while an alert waits for its ack, so this has to fit
+// well inside one wake.
+#define OUTBOX_RETRY_WINDOW 115000
+
+typedef bool (*OutboxPublish)(const char* topic, const uint8_t* payload, size_t length);
+
+// Transforms payload in place within capacity, returning the new length or
+// 0 on failure
+typedef size_t (*OutboxSeal)(const char* topic, uint8_t* payload, size_t length, size_t capacity);
+
+// seal may be NULL
+void outboxBegin(OutboxPublish publish, OutboxSeal seal);
+
+// Copies the message into a free slot. When all slots are taken it evicts
+// the least urgent message that isn't waiting for an ack, if that is no
+// more urgent than this one; otherwise this one is dropped. topic must
+// outlive the message. Returns false if the message was dropped.
+bool outboxPost(OutboxPriority priority, const char* topic, const uint8_t* payload,
+                size_t length, uint32_t ackId);
+
+// Publishes due messages of priority through or more urgent, stopping at
+// the first failed publish. Returns the number published.
+uint8_t outboxService(OutboxPriority through, unsigned long now);
+
+void outboxAcknowledge(uint32_t ackId);
+
+// Messages still queued, including alerts waiting for their ack
+uint8_t outboxPending();
+
+// Makes every queued message due at once. Called after reconnecting, since
+// an alert sent just before the link dropped may never have arrived.
+void outboxRetryNow();
+
+#endif // OUTBOX_H
@@ -0,0 +1,94 @@
+#include "payload_crypto.h"
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include <mbedtls/gcm.h>
+#include <string.h>
+
+#include "device_log.h"
+
+#if CRYPTO_BENCHMARK
+#include <AES.h>
+#include <GCM.h>
+#include <esp_timer.h>
+#endif
+
+static mbedtls_gcm_context gcm;
+static bool cryptoReady = false;
+
+// A fresh 96-bit random nonce per message. esp_random() is only truly
+// random while WiFi or Bluetooth is running, so callers seal at publish
+// time, with the link up, never when a message is queued.
+static void nextNonce(uint8_t* nonce) {
+  for (uint8_t i = 0; i < PAYLOAD_NONCE_SIZE; i += 4) {
+    uint32_t word = esp_random();
+    memcpy(nonce + i, &word, sizeof(word));
+  }
+}
+
+bool payloadCryptoBegin(const uint8_t* key) {
+  mbedtls_gcm_init(&gcm);
+  cryptoReady = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, PAYLOAD_KEY_SIZE * 8) == 0;
+  if (!cryptoReady) {
+    LOG_ERROR("Payload encryption: key rejected");
+  }
+  return cryptoReady;
+}
+
+size_t payloadSeal(const char* topic, uint8_t* buffer, size_t length, size_t capacity) {
+  if (!cryptoReady || capacity < length + PAYLOAD_CRYPTO_OVERHEAD) return 0;
+
+  uint8_t* nonce = buffer + length;
+  uint8_t* tag = nonce + PAYLOAD_NONCE_SIZE;
+  nextNonce(nonce);
+
+  // mbedTLS GCM allows the output to overlap the input exactly
+  int result = mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, length,
+                                         nonce, PAYLOAD_NONCE_SIZE,
+                                         (const unsigned char*)topic, strlen(topic),
+                                         buffer, buffer, PAYLOAD_TAG_SIZE, tag);
+  return result == 0 ? length + PAYLOAD_CRYPTO_OVERHEAD : 0;
+}
+
+#if CRYPTO_BENCHMARK
+
+#define BENCHMARK_ROUNDS 200
+
+void payloadCryptoBenchmark() {
+  static const size_t sizes[] = {17, 256, 640};
+  static uint8_t buffer[640 + PAYLOAD_CRYPTO_OVERHEAD];
+  static const uint8_t key[PAYLOAD_KEY_SIZE] = {0};
+  static const char topic[] = "botcareu/device/benchmark/status";
+
+  if (!cryptoReady) payloadCryptoBegin(key);
+  GCM<AES256> software;
+  software.setKey(key, sizeof(key));
+
+  Serial.println("Payload encryption benchmark, µs per message:");
+  for (uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    size_t size = sizes[i];
+    memset(buffer, 0xA5, size);
+
+    int64_t start = esp_timer_get_time();
+    for (uint16_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+      payloadSeal(topic, buffer, size, sizeof(buffer));
+    }
+    int64_t hardware = (esp_timer_get_time() - start) / BENCHMARK_ROUNDS;
+
+    start = esp_timer_get_time();
+    for (uint16_t round = 0; round < BENCHMARK_ROUNDS; round++) {
+      uint8_t* nonce = buffer + size;
+      nextNonce(nonce);
+      software.setIV(nonce, PAYLOAD_NONCE_SIZE);
+      software.addAuthData(topic, sizeof(topic) - 1);
+      software.encrypt(buffer, buffer, size);
+      software.computeTag(nonce + PAYLOAD_NONCE_SIZE, PAYLOAD_TAG_SIZE);
+    }
+    int64_t softwareTime = (esp_timer_get_time() - start) / BENCHMARK_ROUNDS;
+
+    Serial.printf("  %4u bytes: mbedTLS %lld, rweather/Crypto %lld\n",
+                  (unsigned)size, (long long)hardware, (long long)softwareTime);
+  }
+}
+
+#endif // CRYPTO_BENCHMARK
@@ -0,0 +1,41 @@
+#ifndef PAYLOAD_CRYPTO_H
+#define PAYLOAD_CRYPTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Authenticated encryption of MQTT payloads with AES-256-GCM.
+//
+// Goes through mbedTLS, which ESP-IDF backs with the hardware AES engine,
+// and works in place on the serialized buffer. The nonce and tag are
+// appended rather than prepended, so nothing has to move:
+//
+//   ciphertext(length) | nonce(12) | tag(16)
+//
+// The topic is authenticated as associated data, so a payload can't be
+// replayed onto another topic. The key is shared by the fleet and no
+// device state survives a cold boot, so nonces can't come from a counter:
+// each one is 96 random bits. A repeat within the 2^32 messages NIST
+// allows one key that way is below 2^-32 likely, and the key has to be
+// rotated before the fleet sends that many.
+#define PAYLOAD_NONCE_SIZE 12
+#define PAYLOAD_TAG_SIZE 16
+#define PAYLOAD_CRYPTO_OVERHEAD (PAYLOAD_NONCE_SIZE + PAYLOAD_TAG_SIZE)
+
+// key is PAYLOAD_KEY_SIZE bytes. Returns false if mbedTLS rejected it.
+#define PAYLOAD_KEY_SIZE 32
+bool payloadCryptoBegin(const uint8_t* key);
+
+// Encrypts the first length bytes of buffer and appends the nonce and tag.
+// Returns the sealed length, or 0 if capacity is too small or encryption
+// failed. Call it only while WiFi is connected, for the nonce's sake. Not
+// thread-safe: the network task is the only caller.
+size_t payloadSeal(const char* topic, uint8_t* buffer, size_t length, size_t capacity);
+
+#if CRYPTO_BENCHMARK
+// Prints the time to seal typical payload sizes through mbedTLS and
+// through the software AES in rweather/Crypto
+void payloadCryptoBenchmark();
+#endif
+
+#endif // PAYLOAD_CRYPTO_H
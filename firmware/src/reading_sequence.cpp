@@ -0,0 +1,111 @@
+#include "reading_sequence.h"
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <bootloader_random.h>
+
+#include "device_log.h"
+
+#define READING_SEQUENCE_PATH "/reading_seq"
+#define READING_SEQUENCE_TEMP_PATH "/reading_seq.tmp"
+#define READING_SEQUENCE_BLOCK 256
+
+// bound(4) epoch(4), little-endian. Firmware before epochs stored the bound
+// alone; its numbering carries on as epoch 0.
+#define READING_SEQUENCE_FILE_SIZE 8
+#define READING_SEQUENCE_LEGACY_SIZE 4
+
+// All 0 until recovered; after a deep-sleep wake they are still valid
+RTC_DATA_ATTR static uint32_t nextSequence = 0;
+RTC_DATA_ATTR static uint32_t reservedUntil = 0;  // First number not covered by flash
+RTC_DATA_ATTR static uint32_t sequenceEpoch = 0;
+
+static void putU32(uint8_t* p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0xFF;
+  p[3] = value >> 24;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Drawn with the boot loader's entropy source on, since WiFi isn't up yet
+// and esp_random() alone is only pseudo-random. Never 0, which stays the
+// epoch of numbering from before epochs.
+static uint32_t newEpoch() {
+  uint32_t epoch = 0;
+  bootloader_random_enable();
+  while (epoch == 0) epoch = esp_random();
+  bootloader_random_disable();
+  return epoch;
+}
+
+// The new bound is written beside the old one and renamed over it, which
+// LittleFS does atomically, so a power cut leaves one bound or the other
+// and never a truncated file
+static bool reserve(uint32_t bound, uint32_t epoch) {
+  File file = LittleFS.open(READING_SEQUENCE_TEMP_PATH, FILE_WRITE);
+  if (!file) return false;
+
+  uint8_t raw[READING_SEQUENCE_FILE_SIZE];
+  putU32(raw, bound);
+  putU32(raw + 4, epoch);
+  bool written = file.write(raw, sizeof(raw)) == sizeof(raw);
+  file.close();
+
+  if (!written || !LittleFS.rename(READING_SEQUENCE_TEMP_PATH, READING_SEQUENCE_PATH)) {
+    return false;
+  }
+  reservedUntil = bound;
+  return true;
+}
+
+bool readingSequenceBegin() {
+  if (nextSequence != 0) return true;
+
+  // A device without a stored bound, never used or with its file system
+  // wiped, starts again from 1 under a new epoch. One whose bound can't be
+  // read gives no numbers at all rather than reusing old ones.
+  uint32_t stored = 1;
+  uint32_t epoch;
+  if (LittleFS.exists(READING_SEQUENCE_PATH)) {
+    File file = LittleFS.open(READING_SEQUENCE_PATH, FILE_READ);
+    uint8_t raw[READING_SEQUENCE_FILE_SIZE];
+    size_t length = file ? file.read(raw, sizeof(raw)) : 0;
+    if (file) file.close();
+    if (length != READING_SEQUENCE_FILE_SIZE && length != READING_SEQUENCE_LEGACY_SIZE) {
+      LOG_ERROR("Reading sequence: " READING_SEQUENCE_PATH " unreadable");
+      return false;
+    }
+    stored = getU32(raw);
+    epoch = length == READING_SEQUENCE_FILE_SIZE ? getU32(raw + 4) : 0;
+  } else {
+    epoch = newEpoch();
+  }
+  if (stored == 0) stored = 1;
+
+  if (!reserve(stored + READING_SEQUENCE_BLOCK, epoch)) {
+    LOG_ERROR("Reading sequence: could not write " READING_SEQUENCE_PATH);
+    return false;
+  }
+  nextSequence = stored;
+  sequenceEpoch = epoch;
+  LOG_INFO("Reading sequence continues from %u, epoch %08x", (unsigned)nextSequence,
+           (unsigned)sequenceEpoch);
+  return true;
+}
+
+uint32_t readingSequenceNext() {
+  if (nextSequence == 0) return 0;
+  if (nextSequence >= reservedUntil &&
+      !reserve(nextSequence + READING_SEQUENCE_BLOCK, sequenceEpoch)) {
+    return 0;
+  }
+  return nextSequence++;
+}
+
+uint32_t readingSequenceEpoch() {
+  return sequenceEpoch;
+}
@@ -0,0 +1,30 @@
+#ifndef READING_SEQUENCE_H
+#define READING_SEQUENCE_H
+
+#include <stdint.h>
+
+// Reading sequence numbers that a device never reuses within an epoch,
+// across deep sleep, power loss and reflashing, so the backend can key
+// readings on (device, epoch, seq).
+//
+// The counter lives in RTC memory. Flash holds only an upper bound: a cold
+// boot continues from the stored bound and reserves the next block, so
+// flash is written once per READING_SEQUENCE_BLOCK readings rather than once
+// per reading. Numbers reserved but unused before a reset are skipped.
+//
+// The epoch is a random number stored beside the bound. Losing the bound,
+// to a file system format, an uploadfs or a partition change, restarts the
+// numbering at 1 under a new epoch, so the new readings aren't mistaken for
+// repeats of old ones.
+
+// Recovers the counter. Needs LittleFS mounted. Returns false if storage is
+// unavailable, in which case readingSequenceNext() returns 0.
+bool readingSequenceBegin();
+
+// Next number, or 0 if it can't be guaranteed unique. Sensor task only.
+uint32_t readingSequenceNext();
+
+// Epoch the numbers from readingSequenceNext() belong to
+uint32_t readingSequenceEpoch();
+
+#endif // READING_SEQUENCE_H
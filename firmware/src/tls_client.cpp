@@ -0,0 +1,337 @@
+#include "tls_client.h"
+
+#include <esp_system.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/platform.h>
+#include <string.h>
+
+#include "metrics.h"
+#include "device_log.h"
+
+#define TLS_SESSION_CACHE_SIZE 512   // Serialized session without the peer certificate: ~120 bytes plus the ticket
+
+// Kept in RTC memory so a wake from deep sleep can resume
+struct TlsSessionCache {
+  uint16_t length;         // 0 when empty
+  unsigned long savedAt;   // By the client's clock
+  uint8_t data[TLS_SESSION_CACHE_SIZE];
+};
+
+RTC_DATA_ATTR static TlsSessionCache sessionCache = {0, 0, {0}};
+
+static const int ecdsaSuites[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+  0
+};
+
+static const mbedtls_ecp_group_id ecdsaCurves[] = {
+  MBEDTLS_ECP_DP_SECP256R1,
+  MBEDTLS_ECP_DP_NONE
+};
+
+// The hardware RNG is a true RNG while the radio is on, which it is for
+// as long as there is a connection to secure
+static int tlsRandom(void*, unsigned char* output, size_t length) {
+  esp_fill_random(output, length);
+  return 0;
+}
+
+static int tlsSend(void* context, const unsigned char* buf, size_t length) {
+  WiFiClient* tcp = (WiFiClient*)context;
+  if (!tcp->connected()) return MBEDTLS_ERR_NET_CONN_RESET;
+  size_t written = tcp->write(buf, length);
+  return written > 0 ? (int)written : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+static int tlsReceive(void* context, unsigned char* buf, size_t length) {
+  WiFiClient* tcp = (WiFiClient*)context;
+  if (tcp->available() <= 0) {
+    return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+  }
+  int received = tcp->read(buf, length);
+  return received > 0 ? received : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+void tlsSessionForget() {
+  sessionCache.length = 0;
+}
+
+TlsClient::TlsClient()
+    : caCert(NULL),
+      handshakeTimeout(5000),
+      sessionLifetime(0),
+      clock(NULL),
+      ecdsaOnly(false),
+      configured(false),
+      open(false),
+      sessionResumed(false),
+      peeked(-1) {}
+
+void TlsClient::setCACert(const char* pem) {
+  caCert = pem;
+}
+
+void TlsClient::setHandshakeTimeout(unsigned long ms) {
+  handshakeTimeout = ms;
+}
+
+void TlsClient::setTimeout(uint32_t seconds) {
+  tcp.setTimeout(seconds);
+  _timeout = seconds * 1000;
+}
+
+void TlsClient::setEcdsaOnly(bool only) {
+  ecdsaOnly = only;
+}
+
+void TlsClient::setSessionLifetime(unsigned long lifetime, unsigned long (*clockFn)()) {
+  sessionLifetime = lifetime;
+  clock = clockFn;
+}
+
+bool TlsClient::configure() {
+  if (configured) return true;
+  if (caCert == NULL) {
+    LOG_ERROR("TLS: no CA certificate set");
+    return false;
+  }
+
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_x509_crt_init(&ca);
+
+  // PEM needs its terminating NUL counted
+  int result = mbedtls_x509_crt_parse(&ca, (const unsigned char*)caCert, strlen(caCert) + 1);
+  if (result == 0) {
+    result = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                         MBEDTLS_SSL_TRANSPORT_STREAM,
+                                         MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (result != 0) {
+    LOG_ERROR("TLS: setup failed, -0x%04x", -result);
+    mbedtls_x509_crt_free(&ca);
+    mbedtls_ssl_config_free(&conf);
+    return false;
+  }
+
+  mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+  mbedtls_ssl_conf_ca_chain(&conf, &ca, NULL);
+  mbedtls_ssl_conf_rng(&conf, tlsRandom, NULL);
+  mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+  if (ecdsaOnly) {
+    mbedtls_ssl_conf_ciphersuites(&conf, ecdsaSuites);
+    mbedtls_ssl_conf_curves(&conf, ecdsaCurves);
+  }
+
+  configured = true;
+  return true;
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) {
+  if (!configure()) return 0;
+  if (open) stop();
+  if (!tcp.connect(ip, port)) return 0;
+  return handshake(NULL);
+}
+
+int TlsClient::connect(const char* host, uint16_t port) {
+  if (!configure()) return 0;
+  if (open) stop();
+  if (!tcp.connect(host, port)) return 0;
+  return handshake(host);
+}
+
+int TlsClient::handshake(const char* host) {
+  MetricsStamp start = metricsNow();
+
+  mbedtls_ssl_init(&ssl);
+  int result = mbedtls_ssl_setup(&ssl, &conf);
+  if (result == 0 && host != NULL) {
+    result = mbedtls_ssl_set_hostname(&ssl, host);
+  }
+  mbedtls_ssl_set_bio(&ssl, &tcp, tlsSend, tlsReceive, NULL);
+
+  if (sessionCache.length > 0 && clock != NULL &&
+      clock() - sessionCache.savedAt >= sessionLifetime) {
+    tlsSessionForget();
+  }
+
+  // Kept until the handshake is over, to tell whether the broker took it
+  mbedtls_ssl_session offered;
+  mbedtls_ssl_session_init(&offered);
+  bool offering = false;
+  if (result == 0 && sessionCache.length > 0) {
+    if (mbedtls_ssl_session_load(&offered, sessionCache.data, sessionCache.length) == 0 &&
+        mbedtls_ssl_set_session(&ssl, &offered) == 0) {
+      offering = true;
+    } else {
+      tlsSessionForget();
+    }
+  }
+
+  if (result == 0) {
+    unsigned long begun = millis();
+    while ((result = mbedtls_ssl_handshake(&ssl)) == MBEDTLS_ERR_SSL_WANT_READ ||
+           result == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      if (millis() - begun >= handshakeTimeout) {
+        result = MBEDTLS_ERR_SSL_TIMEOUT;
+        break;
+      }
+      delay(1);
+    }
+  }
+
+  if (result != 0) {
+    LOG_WARN("TLS: handshake failed, -0x%04x", -result);
+    // A session the broker chokes on would fail every attempt
+    if (offering) tlsSessionForget();
+    mbedtls_ssl_session_free(&offered);
+    mbedtls_ssl_free(&ssl);
+    tcp.stop();
+    return 0;
+  }
+
+  open = true;
+  peeked = -1;
+
+  // A resumed session carries its master secret over, where a full
+  // handshake derives a new one. mbedTLS 2.x has no accessor for this.
+  mbedtls_ssl_session negotiated;
+  mbedtls_ssl_session_init(&negotiated);
+  sessionResumed = false;
+  if (mbedtls_ssl_get_session(&ssl, &negotiated) == 0) {
+    sessionResumed = offering &&
+                     memcmp(negotiated.master, offered.master, sizeof(offered.master)) == 0;
+    // The broker may issue a fresh ticket on a resumed handshake too
+    bool sameTicket = negotiated.ticket_len == offered.ticket_len &&
+                      (offered.ticket_len == 0 ||
+                       memcmp(negotiated.ticket, offered.ticket, offered.ticket_len) == 0);
+    if (!sessionResumed || !sameTicket) {
+      saveSession(negotiated);
+    }
+  } else {
+    tlsSessionForget();
+  }
+  mbedtls_ssl_session_free(&negotiated);
+  mbedtls_ssl_session_free(&offered);
+
+  if (sessionResumed) {
+    metricsIncrement(COUNTER_TLS_RESUMED);
+  }
+  metricsRecord(STAGE_TLS_HANDSHAKE, start);
+  return 1;
+}
+
+void TlsClient::saveSession(mbedtls_ssl_session& session) {
+#if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
+  // Only a full handshake checks the certificate, and the chain's leaf
+  // alone would outgrow the cache. The Arduino core's mbedTLS is built to
+  // keep it, so it is dropped from the copy here.
+  if (session.peer_cert != NULL) {
+    mbedtls_x509_crt_free(session.peer_cert);
+    mbedtls_free(session.peer_cert);
+    session.peer_cert = NULL;
+  }
+#endif
+
+  size_t length = 0;
+  if (mbedtls_ssl_session_save(&session, sessionCache.data, sizeof(sessionCache.data), &length) == 0) {
+    sessionCache.length = (uint16_t)length;
+    sessionCache.savedAt = clock != NULL ? clock() : 0;
+  } else {
+    // A ticket too large to cache; full handshakes only
+    tlsSessionForget();
+    LOG_WARN("TLS: session too large to cache");
+  }
+}
+
+size_t TlsClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t TlsClient::write(const uint8_t* buf, size_t size) {
+  if (!open) return 0;
+
+  size_t written = 0;
+  unsigned long begun = millis();
+  while (written < size) {
+    int result = mbedtls_ssl_write(&ssl, buf + written, size - written);
+    if (result > 0) {
+      written += result;
+    } else if (result != MBEDTLS_ERR_SSL_WANT_WRITE && result != MBEDTLS_ERR_SSL_WANT_READ) {
+      stop();
+      break;
+    } else if (millis() - begun >= _timeout) {
+      break;
+    } else {
+      delay(1);
+    }
+  }
+  return written;
+}
+
+int TlsClient::available() {
+  if (!open) return 0;
+
+  // A zero-length read pulls in the next record, if one has arrived
+  int result = mbedtls_ssl_read(&ssl, NULL, 0);
+  if (result < 0 && result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    stop();
+    return peeked >= 0 ? 1 : 0;
+  }
+  return (int)mbedtls_ssl_get_bytes_avail(&ssl) + (peeked >= 0 ? 1 : 0);
+}
+
+int TlsClient::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsClient::read(uint8_t* buf, size_t size) {
+  if (size == 0) return 0;
+
+  int count = 0;
+  if (peeked >= 0) {
+    buf[count++] = (uint8_t)peeked;
+    peeked = -1;
+    if (size == 1) return count;
+  }
+  if (!open) return count > 0 ? count : -1;
+
+  int result = mbedtls_ssl_read(&ssl, buf + count, size - count);
+  if (result > 0) return count + result;
+  if (result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) {
+    stop();
+  }
+  return count > 0 ? count : -1;
+}
+
+int TlsClient::peek() {
+  if (peeked < 0) {
+    uint8_t b;
+    if (open && mbedtls_ssl_read(&ssl, &b, 1) == 1) peeked = b;
+  }
+  return peeked;
+}
+
+void TlsClient::flush() {
+  tcp.flush();
+}
+
+void TlsClient::stop() {
+  if (open) {
+    mbedtls_ssl_close_notify(&ssl);
+    mbedtls_ssl_free(&ssl);
+    open = false;
+  }
+  peeked = -1;
+  tcp.stop();
+}
+
+uint8_t TlsClient::connected() {
+  if (open && !tcp.connected() && mbedtls_ssl_get_bytes_avail(&ssl) == 0) {
+    stop();
+  }
+  return open || peeked >= 0;
+}
@@ -0,0 +1,81 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+
+// TLS transport for PubSubClient that resumes sessions across reconnects
+// and deep sleep.
+//
+// WiFiClientSecure runs a full handshake on every connect and has no way to
+// offer a saved session. This client drives mbedTLS directly over a
+// WiFiClient instead. After each handshake the session (its ID, master
+// secret and any ticket the broker issued, but not the peer certificate)
+// is serialized into RTC memory, and the next
+// connect offers it back, so a reconnect costs an abbreviated handshake:
+// no certificate chain, no ECDHE, one round trip fewer.
+//
+// The CA certificate is parsed once, and the SSL context (with its 32 KB of
+// record buffers) only exists while a connection is open.
+class TlsClient : public Client {
+ public:
+  TlsClient();
+
+  // Configuration is read on the first connect; set it up before then.
+  // pem must outlive the client. Connects fail until a CA is set.
+  void setCACert(const char* pem);
+  void setHandshakeTimeout(unsigned long ms);
+
+  // In seconds, as for WiFiClient, bounding socket reads and writes
+  void setTimeout(uint32_t seconds);
+
+  // Offer only ECDHE-ECDSA suites on P-256, for brokers with an ECDSA
+  // certificate. Those handshakes are smaller and the broker signs faster.
+  void setEcdsaOnly(bool ecdsaOnly);
+
+  // A cached session older than lifetime ms, by clock, is no longer
+  // offered. Should match the broker's ticket lifetime.
+  void setSessionLifetime(unsigned long lifetime, unsigned long (*clock)());
+
+  // Whether the current or last connection resumed a cached session
+  bool resumed() const { return sessionResumed; }
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char* host, uint16_t port) override;
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buf, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return connected(); }
+
+ private:
+  bool configure();
+  int handshake(const char* host);
+  void saveSession(mbedtls_ssl_session& session);
+
+  WiFiClient tcp;
+  mbedtls_ssl_config conf;
+  mbedtls_x509_crt ca;
+  mbedtls_ssl_context ssl;
+  const char* caCert;
+  unsigned long handshakeTimeout;
+  unsigned long sessionLifetime;
+  unsigned long (*clock)();
+  bool ecdsaOnly;
+  bool configured;
+  bool open;
+  bool sessionResumed;
+  int peeked;  // Byte returned by peek() and not read yet, or -1
+};
+
+// Drops the cached session, so the next connect does a full handshake
+void tlsSessionForget();
+
+#endif // TLS_CLIENT_H
@@ -0,0 +1,130 @@
+// Adaptive measurement cadence: fever bands, rising trend and steady slow-down
+#include <unity.h>
+
+#include "adaptive_schedule.h"
+
+#define MINUTE 60000UL
+#define BASE 60000UL
+
+static const ScheduleBounds bounds = {
+  5000,       // minInterval
+  BASE,       // baseInterval
+  600000,     // maxInterval
+  7200000,    // stablePeriod
+  0.2f,       // risingSlope
+  0.1f,       // steadySlope
+  37.5f,      // feverThreshold
+  38.5f,      // highFeverThreshold
+  40.0f       // criticalTempThreshold
+};
+
+static ScheduleState state;
+
+void setUp(void) {
+  scheduleReset(state);
+}
+
+void tearDown(void) {}
+
+void test_first_reading_uses_base(void) {
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.6f, 0, bounds));
+  TEST_ASSERT_TRUE(state.hasReading);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.slope);
+}
+
+void test_fever_bands_shorten_interval(void) {
+  TEST_ASSERT_EQUAL_UINT32(20000, scheduleNextInterval(state, 37.6f, 0, bounds));
+  TEST_ASSERT_EQUAL_UINT32(10000, scheduleNextInterval(state, 38.6f, MINUTE, bounds));
+  TEST_ASSERT_EQUAL_UINT32(5000, scheduleNextInterval(state, 40.2f, 2 * MINUTE, bounds));
+}
+
+void test_fever_never_slower_than_base(void) {
+  ScheduleBounds slowMin = bounds;
+  slowMin.minInterval = 20000;   // Four times this is past the base interval
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 37.8f, 0, slowMin));
+  TEST_ASSERT_EQUAL_UINT32(40000, scheduleNextInterval(state, 38.8f, MINUTE, slowMin));
+}
+
+void test_rising_trend_halves_base(void) {
+  scheduleNextInterval(state, 36.5f, 0, bounds);
+  TEST_ASSERT_EQUAL_UINT32(BASE / 2, scheduleNextInterval(state, 36.8f, MINUTE, bounds));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.3f, state.slope);
+
+  // Falling just as fast is not a reason to hurry
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.5f, 2 * MINUTE, bounds));
+}
+
+void test_steady_normal_slows_down(void) {
+  unsigned long t = 0;
+  for (; t < bounds.stablePeriod; t += MINUTE) {
+    TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.6f, t, bounds));
+  }
+  TEST_ASSERT_EQUAL_UINT32(bounds.maxInterval, scheduleNextInterval(state, 36.6f, t, bounds));
+  TEST_ASSERT_EQUAL_UINT32(bounds.maxInterval,
+                           scheduleNextInterval(state, 36.62f, t + bounds.maxInterval, bounds));
+}
+
+void test_movement_restarts_steady_period(void) {
+  unsigned long t = 0;
+  for (; t <= bounds.stablePeriod; t += MINUTE) {
+    scheduleNextInterval(state, 36.6f, t, bounds);
+  }
+  // 0.15 °C/min is not rising fast, but no longer flat
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.75f, t, bounds));
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.75f, t + MINUTE, bounds));
+  TEST_ASSERT_EQUAL_UINT32(bounds.maxInterval,
+                           scheduleNextInterval(state, 36.75f, t + bounds.stablePeriod, bounds));
+}
+
+void test_fever_restarts_steady_period(void) {
+  unsigned long t = 0;
+  for (; t <= bounds.stablePeriod; t += MINUTE) {
+    scheduleNextInterval(state, 37.6f, t, bounds);
+  }
+  // A flat fever that just broke counts as steady only from here on
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 37.45f, t, bounds));
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 37.45f, t + MINUTE, bounds));
+}
+
+void test_same_timestamp_has_no_slope(void) {
+  scheduleNextInterval(state, 36.5f, MINUTE, bounds);
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 37.0f, MINUTE, bounds));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.slope);
+}
+
+void test_equal_bounds_disable_adaptation(void) {
+  ScheduleBounds fixed = bounds;
+  fixed.minInterval = BASE;
+  fixed.maxInterval = BASE;
+  const float temperatures[] = {36.6f, 37.2f, 37.8f, 38.9f, 40.5f, 36.6f};
+  unsigned long t = 0;
+  for (unsigned i = 0; i < sizeof(temperatures) / sizeof(temperatures[0]); i++, t += MINUTE) {
+    TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, temperatures[i], t, fixed));
+  }
+  for (; t < 3 * fixed.stablePeriod; t += MINUTE) {
+    TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.6f, t, fixed));
+  }
+}
+
+void test_reset_forgets_history(void) {
+  scheduleNextInterval(state, 36.5f, 0, bounds);
+  scheduleReset(state);
+  // Without the earlier reading there is nothing to take a slope against
+  TEST_ASSERT_EQUAL_UINT32(BASE, scheduleNextInterval(state, 36.9f, MINUTE, bounds));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, state.slope);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_reading_uses_base);
+  RUN_TEST(test_fever_bands_shorten_interval);
+  RUN_TEST(test_fever_never_slower_than_base);
+  RUN_TEST(test_rising_trend_halves_base);
+  RUN_TEST(test_steady_normal_slows_down);
+  RUN_TEST(test_movement_restarts_steady_period);
+  RUN_TEST(test_fever_restarts_steady_period);
+  RUN_TEST(test_same_timestamp_has_no_slope);
+  RUN_TEST(test_equal_bounds_disable_adaptation);
+  RUN_TEST(test_reset_forgets_history);
+  return UNITY_END();
+}
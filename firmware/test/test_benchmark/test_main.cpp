@@ -0,0 +1,242 @@
+// Host timings of the per-reading hot path, and proof that it never touches
+// the heap. Budgets are loose enough for a shared CI runner; the BENCH
+// lines are what to compare between runs.
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "measurement.h"
+#include "sampling.h"
+#include "sensor_fusion.h"
+#include "sensor_source.h"
+#include "telemetry_codec.h"
+#include "telemetry_transport.h"
+#include "trend.h"
+
+#define BENCH_ITERATIONS 20000
+
+// Counts heap calls by standing in for the allocator, which also catches
+// operator new. Only glibc exports the underlying allocator to forward to.
+#if defined(__GLIBC__)
+#define BENCH_COUNTS_ALLOCATIONS 1
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+static volatile unsigned long allocations = 0;
+
+void* malloc(size_t size) {
+  allocations++;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  allocations++;
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  allocations++;
+  return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+typedef std::chrono::steady_clock BenchClock;
+
+static volatile size_t sink = 0;
+
+static TemperatureReading benchReading(uint32_t i) {
+  TemperatureReading reading;
+  memset(&reading, 0, sizeof(reading));
+  reading.infraredTemp = 36.5f + 0.01f * (i % 7);
+  reading.contactTemp = 36.8f;
+  reading.ambientTemp = 22.4f;
+  reading.infraredVariance = 0.0021f;
+  reading.probeCount = 2;
+  reading.probeTemps[0] = 36.8f;
+  reading.probeTemps[1] = 23.1f;
+  reading.probeTemps[2] = NAN;
+  reading.fusedTemp = 37.1f + 0.01f * (i % 5);
+  reading.confidence = 0.87f;
+  reading.timestamp = 1760000000000ULL + 60000ULL * i;
+  reading.seq = 1000 + i;
+  reading.isValid = true;
+  reading.clockSynced = true;
+  reading.measurementType = MEASUREMENT_COMBINED;
+  return reading;
+}
+
+static const TelemetrySource source = {"botcareu_0123456789ab", "1.0.0", 3.7f, -61};
+
+// Prints and returns nanoseconds per call of fn over BENCH_ITERATIONS
+template <typename Fn>
+static double bench(const char* name, Fn fn) {
+  for (uint32_t i = 0; i < 100; i++) fn(i);
+
+  BenchClock::time_point start = BenchClock::now();
+  for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) fn(i);
+  double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count() /
+              BENCH_ITERATIONS;
+
+  printf("BENCH %-28s %10.1f ns/op\n", name, ns);
+  return ns;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_bench_reading_frame(void) {
+  uint8_t frame[READING_FRAME_SIZE];
+  double ns = bench("encodeReadingFrame", [&](uint32_t i) {
+    TemperatureReading reading = benchReading(i);
+    sink += encodeReadingFrame(reading, 3.7f, -61, frame, sizeof(frame));
+  });
+  TEST_ASSERT_TRUE(ns < 5000);
+}
+
+void test_bench_reading_batch(void) {
+  TemperatureReading readings[READING_BATCH_MAX];
+  for (uint8_t i = 0; i < READING_BATCH_MAX; i++) readings[i] = benchReading(i);
+  static uint8_t frame[BATCH_FRAME_MAX_SIZE];
+  double ns = bench("encodeReadingBatch/32", [&](uint32_t) {
+    sink += encodeReadingBatch(source, readings, READING_BATCH_MAX, frame, sizeof(frame));
+  });
+  TEST_ASSERT_TRUE(ns < 50000);
+}
+
+void test_bench_reading_json(void) {
+  char out[READING_JSON_MAX_SIZE];
+  double ns = bench("encodeReadingJson", [&](uint32_t i) {
+    TemperatureReading reading = benchReading(i);
+    sink += encodeReadingJson(reading, source, true, out, sizeof(out));
+  });
+  TEST_ASSERT_TRUE(ns < 50000);
+}
+
+void test_bench_sample_filters(void) {
+  SampleBuffer buffer;
+  sampleBufferReset(buffer);
+  for (uint8_t i = 0; i < SAMPLE_BUFFER_CAPACITY; i++) {
+    sampleBufferPush(buffer, 36.5f + 0.03f * ((i * 7) % 11));
+  }
+  double median = bench("sampleBufferMedian/16", [&](uint32_t) {
+    sink += (size_t)sampleBufferMedian(buffer);
+  });
+  double trimmed = bench("sampleBufferTrimmedMean/16", [&](uint32_t) {
+    sink += (size_t)sampleBufferTrimmedMean(buffer, 2);
+  });
+  TEST_ASSERT_TRUE(median < 10000);
+  TEST_ASSERT_TRUE(trimmed < 10000);
+}
+
+void test_bench_fusion_and_trend(void) {
+  FusionParams fusion = {0.1f, 0.3f, 0.1f, 0.01f, 0.2f, 0.2f, 1.0f};
+  TrendParams trendParams = {600000, 38.0f, 0.8f, 0.02f, 4};
+  FusionState state;
+  TrendStats trend;
+  fusionReset(state);
+  trendReset(trend);
+
+  double fusionNs = bench("fusionUpdate", [&](uint32_t i) {
+    TemperatureReading reading = benchReading(i);
+    fusionUpdate(state, reading, 60000UL * i, fusion);
+    sink += reading.isValid;
+  });
+  double trendNs = bench("trendUpdate", [&](uint32_t i) {
+    sink += trendUpdate(trend, 36.8f + 0.01f * (i % 13), 60000UL * i, trendParams);
+  });
+  TEST_ASSERT_TRUE(fusionNs < 5000);
+  TEST_ASSERT_TRUE(trendNs < 5000);
+}
+
+// One measurement end to end, from scripted sensors to an accepted publish
+
+static float benchInfrared(void* context) {
+  uint32_t* n = (uint32_t*)context;
+  return 36.4f + 0.02f * ((*n)++ % 9);
+}
+
+static float benchAmbient(void*) {
+  return 22.4f;
+}
+
+static uint8_t benchProbes(void*, float* raw, uint8_t maxProbes) {
+  raw[0] = 36.8f;
+  if (maxProbes > 1) raw[1] = 23.1f;
+  return maxProbes > 1 ? 2 : 1;
+}
+
+static bool benchPublish(void*, const char*, uint8_t*, size_t length, size_t) {
+  sink += length;
+  return true;
+}
+
+static void runPipeline(const SensorSource& sensors, FusionState& state, uint32_t i,
+                        uint8_t format) {
+  static const SamplingParams sampling = {5, FILTER_MODE_MEDIAN, 1, 0.5f, 0.1f, 0};
+  static const FusionParams fusion = {0.1f, 0.3f, 0.1f, 0.01f, 0.2f, 0.2f, 1.0f};
+  static const ReadingTopics topics = {"botcareu/bench/temperature", "botcareu/bench/temperature/bin"};
+  static const TelemetryTransport transport = {NULL, benchPublish};
+
+  TemperatureReading reading = benchReading(i);
+  sampleSensors(sensors, sampling, reading);
+  fusionUpdate(state, reading, 60000UL * i, fusion);
+  publishReading(transport, topics, reading, source, format, false);
+}
+
+void test_bench_pipeline(void) {
+  uint32_t infraredCalls = 0;
+  SensorSource sensors = {&infraredCalls, NULL, NULL, benchInfrared, benchAmbient, benchProbes};
+  FusionState state;
+  fusionReset(state);
+
+  double binary = bench("pipeline/binary", [&](uint32_t i) {
+    runPipeline(sensors, state, i, TELEMETRY_FORMAT_BINARY);
+  });
+  double json = bench("pipeline/json", [&](uint32_t i) {
+    runPipeline(sensors, state, i, TELEMETRY_FORMAT_JSON);
+  });
+  TEST_ASSERT_TRUE(binary < 20000);
+  TEST_ASSERT_TRUE(json < 100000);
+}
+
+void test_pipeline_never_allocates(void) {
+#if BENCH_COUNTS_ALLOCATIONS
+  uint32_t infraredCalls = 0;
+  SensorSource sensors = {&infraredCalls, NULL, NULL, benchInfrared, benchAmbient, benchProbes};
+  FusionState state;
+  fusionReset(state);
+  TemperatureReading readings[READING_BATCH_MAX];
+  for (uint8_t i = 0; i < READING_BATCH_MAX; i++) readings[i] = benchReading(i);
+  static uint8_t frame[BATCH_FRAME_MAX_SIZE];
+
+  unsigned long before = allocations;
+  for (uint32_t i = 0; i < 1000; i++) {
+    runPipeline(sensors, state, i, i % 2 ? TELEMETRY_FORMAT_JSON : TELEMETRY_FORMAT_BINARY);
+  }
+  sink += encodeReadingBatch(source, readings, READING_BATCH_MAX, frame, sizeof(frame));
+  unsigned long counted = allocations - before;
+
+  printf("BENCH %-28s %10lu allocations\n", "pipeline/1000 readings", counted);
+  TEST_ASSERT_EQUAL_UINT32(0, counted);
+#else
+  TEST_IGNORE_MESSAGE("Allocation counting needs glibc");
+#endif
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_reading_frame);
+  RUN_TEST(test_bench_reading_batch);
+  RUN_TEST(test_bench_reading_json);
+  RUN_TEST(test_bench_sample_filters);
+  RUN_TEST(test_bench_fusion_and_trend);
+  RUN_TEST(test_bench_pipeline);
+  RUN_TEST(test_pipeline_never_allocates);
+  return UNITY_END();
+}
@@ -0,0 +1,56 @@
+// CRC-8 behind the flash records: reference value and corruption detection
+#include <string.h>
+#include <unity.h>
+
+#include "checksum.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_check_value(void) {
+  // CRC-8/SMBUS check value for "123456789"
+  const char* check = "123456789";
+  TEST_ASSERT_EQUAL_UINT8(0xF4, crc8((const uint8_t*)check, strlen(check)));
+}
+
+void test_empty_and_zero_input(void) {
+  uint8_t zeros[16] = {0};
+  TEST_ASSERT_EQUAL_UINT8(0x00, crc8(zeros, 0));
+  TEST_ASSERT_EQUAL_UINT8(0x00, crc8(zeros, sizeof(zeros)));
+}
+
+void test_single_byte(void) {
+  uint8_t one = 0x01;
+  TEST_ASSERT_EQUAL_UINT8(0x07, crc8(&one, 1));
+}
+
+void test_every_single_bit_flip_is_caught(void) {
+  uint8_t record[24];
+  for (size_t i = 0; i < sizeof(record); i++) record[i] = (uint8_t)(i * 37 + 11);
+  uint8_t expected = crc8(record, sizeof(record));
+
+  for (size_t i = 0; i < sizeof(record); i++) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      record[i] ^= (uint8_t)(1 << bit);
+      TEST_ASSERT_TRUE(crc8(record, sizeof(record)) != expected);
+      record[i] ^= (uint8_t)(1 << bit);
+    }
+  }
+}
+
+void test_truncated_record_differs(void) {
+  // A record cut short by a power loss must not verify against its stored CRC
+  uint8_t record[12] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80, 0x90, 0xA0, 0xB0, 0xC0};
+  TEST_ASSERT_TRUE(crc8(record, sizeof(record)) != crc8(record, sizeof(record) - 1));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_check_value);
+  RUN_TEST(test_empty_and_zero_input);
+  RUN_TEST(test_single_byte);
+  RUN_TEST(test_every_single_bit_flip_is_caught);
+  RUN_TEST(test_truncated_record_differs);
+  return UNITY_END();
+}
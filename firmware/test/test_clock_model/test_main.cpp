@@ -0,0 +1,88 @@
+// Wall clock from syncs and a drifting local clock
+#include <unity.h>
+
+#include "clock_model.h"
+
+#define EPOCH 1760000000000ULL
+#define HOUR 3600000UL
+#define MIN_INTERVAL 600000UL
+
+static ClockModel model;
+
+static int64_t errorAt(uint64_t expected, unsigned long localMs) {
+  return (int64_t)(clockModelNow(model, localMs) - expected);
+}
+
+void setUp(void) {
+  clockModelReset(model);
+}
+
+void tearDown(void) {}
+
+void test_first_sync_sets_clock(void) {
+  TEST_ASSERT_EQUAL_INT32(0, clockModelSync(model, EPOCH, 5000, MIN_INTERVAL));
+  TEST_ASSERT_TRUE(model.synced);
+  TEST_ASSERT_TRUE(clockModelNow(model, 6000) == EPOCH + 1000);
+  TEST_ASSERT_TRUE(clockModelNow(model, 4000) == EPOCH - 1000);
+}
+
+void test_sync_measures_drift(void) {
+  // Local clock 100 ppm fast
+  clockModelSync(model, EPOCH, 0, MIN_INTERVAL);
+  TEST_ASSERT_EQUAL_INT32(-360, clockModelSync(model, EPOCH + HOUR, HOUR + 360, MIN_INTERVAL));
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, model.driftPpm);
+  TEST_ASSERT_EQUAL_UINT8(1, model.driftSamples);
+
+  // The next hour is predicted to within a millisecond
+  unsigned long localHour = 2 * HOUR + 720;
+  TEST_ASSERT_TRUE(errorAt(EPOCH + 2 * HOUR, localHour) <= 1);
+  TEST_ASSERT_TRUE(errorAt(EPOCH + 2 * HOUR, localHour) >= -1);
+}
+
+void test_short_intervals_span_syncs(void) {
+  clockModelSync(model, EPOCH, 0, MIN_INTERVAL);
+  clockModelSync(model, EPOCH + 60000, 60006, MIN_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT8(0, model.driftSamples);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, model.driftPpm);
+
+  // Measured from the first sync, not the one a minute before
+  clockModelSync(model, EPOCH + HOUR, HOUR + 360, MIN_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT8(1, model.driftSamples);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, model.driftPpm);
+}
+
+void test_later_intervals_are_smoothed(void) {
+  clockModelSync(model, EPOCH, 0, MIN_INTERVAL);
+  clockModelSync(model, EPOCH + HOUR, HOUR + 360, MIN_INTERVAL);
+  clockModelSync(model, EPOCH + 2 * HOUR, 2 * HOUR + 360 + 720, MIN_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT8(2, model.driftSamples);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f + 0.3f * (200.0f - 100.0f), model.driftPpm);
+}
+
+void test_bad_sync_is_not_drift(void) {
+  clockModelSync(model, EPOCH, 0, MIN_INTERVAL);
+  // A 5% rate error is a bad sync, but the clock still follows it
+  clockModelSync(model, EPOCH + HOUR, HOUR + 180000, MIN_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT8(0, model.driftSamples);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 0, model.driftPpm);
+  TEST_ASSERT_TRUE(clockModelNow(model, HOUR + 180000) == EPOCH + HOUR);
+}
+
+void test_local_clock_wrap(void) {
+  unsigned long start = (unsigned long)-HOUR;
+  clockModelSync(model, EPOCH, start, MIN_INTERVAL);
+  clockModelSync(model, EPOCH + 2 * HOUR, start + 2 * HOUR + 720, MIN_INTERVAL);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 100.0f, model.driftPpm);
+  TEST_ASSERT_TRUE(clockModelNow(model, start + 2 * HOUR + 720) == EPOCH + 2 * HOUR);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_sync_sets_clock);
+  RUN_TEST(test_sync_measures_drift);
+  RUN_TEST(test_short_intervals_span_syncs);
+  RUN_TEST(test_later_intervals_are_smoothed);
+  RUN_TEST(test_bad_sync_is_not_drift);
+  RUN_TEST(test_local_clock_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,273 @@
+// Binary frames and JSON readings, checked byte by byte against the layout
+// the backend decoder expects
+#include <ArduinoJson.h>
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+#include "telemetry_codec.h"
+#include "trend.h"
+
+static uint16_t getU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t getU48(const uint8_t* p) {
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < 6; i++) value |= (uint64_t)p[i] << (8 * i);
+  return value;
+}
+
+static uint64_t getVarint(const uint8_t*& p) {
+  uint64_t value = 0;
+  for (uint8_t shift = 0;; shift += 7) {
+    uint8_t byte = *p++;
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return value;
+  }
+}
+
+static int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static TemperatureReading sampleReading() {
+  TemperatureReading reading;
+  memset(&reading, 0, sizeof(reading));
+  reading.infraredTemp = 36.5f;
+  reading.contactTemp = 36.81f;
+  reading.ambientTemp = 22.0f;
+  reading.infraredVariance = 0.0004f;
+  reading.probeCount = 2;
+  reading.probeTemps[0] = 36.81f;
+  reading.probeTemps[1] = 22.5f;
+  reading.probeTemps[2] = NAN;
+  reading.fusedTemp = 37.25f;
+  reading.confidence = 0.9f;
+  reading.timestamp = 1760000000123ULL;
+  reading.seq = 4242;
+  reading.seqEpoch = 0xA1B2C3D4;
+  reading.isValid = true;
+  reading.clockSynced = true;
+  reading.measurementType = MEASUREMENT_CONTACT;
+  return reading;
+}
+
+static TelemetrySource sampleSource() {
+  TelemetrySource source;
+  source.deviceId = "botcareu_0123456789ab";
+  source.firmwareVersion = "1.0.0";
+  source.batteryVoltage = 3.7f;
+  source.signalStrength = -61;
+  return source;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_reading_frame_layout(void) {
+  TemperatureReading reading = sampleReading();
+  reading.ambientTemp = NAN;
+  uint8_t frame[READING_FRAME_SIZE];
+
+  TEST_ASSERT_EQUAL_UINT32(READING_FRAME_SIZE,
+                           encodeReadingFrame(reading, 3.7f, -61, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_BINARY_VERSION, frame[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x01 | (MEASUREMENT_CONTACT << 1) | 0x08, frame[1]);
+  TEST_ASSERT_EQUAL_UINT32(4242, getU32(frame + 2));
+  TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4, getU32(frame + 6));
+  TEST_ASSERT_TRUE(getU48(frame + 10) == 1760000000123ULL);
+  TEST_ASSERT_EQUAL_INT16(3650, (int16_t)getU16(frame + 16));
+  TEST_ASSERT_EQUAL_INT16(3681, (int16_t)getU16(frame + 18));
+  TEST_ASSERT_EQUAL_INT16(TELEMETRY_TEMP_MISSING, (int16_t)getU16(frame + 20));
+  TEST_ASSERT_EQUAL_UINT16(4, getU16(frame + 22));
+  TEST_ASSERT_EQUAL_UINT16(3700, getU16(frame + 24));
+  TEST_ASSERT_EQUAL_INT8(-61, (int8_t)frame[26]);
+  TEST_ASSERT_EQUAL_UINT8(2, frame[27]);
+  TEST_ASSERT_EQUAL_INT16(3681, (int16_t)getU16(frame + 28));
+  TEST_ASSERT_EQUAL_INT16(2250, (int16_t)getU16(frame + 30));
+  TEST_ASSERT_EQUAL_INT16(TELEMETRY_TEMP_MISSING, (int16_t)getU16(frame + 32));
+  TEST_ASSERT_EQUAL_INT16(3725, (int16_t)getU16(frame + 34));
+  TEST_ASSERT_EQUAL_UINT8(90, frame[36]);
+}
+
+void test_reading_frame_needs_capacity(void) {
+  TemperatureReading reading = sampleReading();
+  uint8_t frame[READING_FRAME_SIZE];
+  TEST_ASSERT_EQUAL_UINT32(0, encodeReadingFrame(reading, 3.7f, -61, frame, sizeof(frame) - 1));
+}
+
+void test_status_frame_optional_sections(void) {
+  StatusFrame status;
+  memset(&status, 0, sizeof(status));
+  status.sensorsReady = true;
+  status.batteryVoltage = 3.9f;
+  status.firmwareVersion = "1.0.0";
+  uint8_t frame[STATUS_FRAME_MAX_SIZE];
+
+  TEST_ASSERT_EQUAL_UINT32(STATUS_FRAME_FIXED_SIZE + 5, encodeStatusFrame(status, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_HEX8(0x01, frame[1]);
+
+  TrendStats trend;
+  trendReset(trend);
+  status.trend = &trend;
+  TEST_ASSERT_EQUAL_UINT32(STATUS_FRAME_FIXED_SIZE + 5, encodeStatusFrame(status, frame, sizeof(frame)));
+
+  trend.samples = 3;
+  trend.onset = true;
+  status.hasHealth = true;
+  status.infraredHealth = 80;
+  status.contactHealth = 95;
+  size_t length = encodeStatusFrame(status, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_UINT32(STATUS_FRAME_FIXED_SIZE + 5 + STATUS_TREND_SIZE + STATUS_HEALTH_SIZE, length);
+  TEST_ASSERT_EQUAL_HEX8(0x01 | 0x02 | 0x04 | 0x08, frame[1]);
+  TEST_ASSERT_EQUAL_UINT8(80, frame[length - 2]);
+  TEST_ASSERT_EQUAL_UINT8(95, frame[length - 1]);
+
+  TEST_ASSERT_EQUAL_UINT32(0, encodeStatusFrame(status, frame, length - 1));
+}
+
+void test_batch_deltas_decode(void) {
+  TemperatureReading readings[2] = {sampleReading(), sampleReading()};
+  readings[1].seq += 1;
+  readings[1].timestamp += 60000;
+  readings[1].fusedTemp = 37.2f;
+  uint8_t frame[BATCH_FRAME_MAX_SIZE];
+
+  size_t length = encodeReadingBatch(sampleSource(), readings, 2, frame, sizeof(frame));
+  TEST_ASSERT_TRUE(length > 0);
+
+  const uint8_t* p = frame;
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_BINARY_VERSION, *p++);
+  uint8_t idLength = *p++;
+  TEST_ASSERT_EQUAL_MEMORY("botcareu_0123456789ab", p, idLength);
+  p += idLength;
+  p += 1 + *p;                      // Firmware version
+  TEST_ASSERT_EQUAL_UINT16(3700, getU16(p));
+  p += 3;
+  TEST_ASSERT_EQUAL_UINT32(4242, getU32(p));
+  p += 4;
+  TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4, getU32(p));
+  p += 4;
+  TEST_ASSERT_TRUE(getU48(p) == 1760000000123ULL);
+  p += 6;
+  TEST_ASSERT_EQUAL_UINT8(2, *p++);
+
+  // The first reading deltas against the base and zero temperatures
+  p++;
+  TEST_ASSERT_TRUE(getVarint(p) == 0);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 0);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 3650);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 3681);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 2200);
+  TEST_ASSERT_TRUE(getVarint(p) == 4);
+  TEST_ASSERT_EQUAL_UINT8(2, *p++);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 3681);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 2250);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 3725);
+  TEST_ASSERT_EQUAL_UINT8(90, *p++);
+
+  // The second only carries what changed
+  p++;
+  TEST_ASSERT_TRUE(getVarint(p) == 1);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == 60000);
+  for (uint8_t i = 0; i < 3; i++) TEST_ASSERT_TRUE(getVarint(p) == 0);
+  TEST_ASSERT_TRUE(getVarint(p) == 4);
+  TEST_ASSERT_EQUAL_UINT8(2, *p++);
+  TEST_ASSERT_TRUE(getVarint(p) == 0);
+  TEST_ASSERT_TRUE(getVarint(p) == 0);
+  TEST_ASSERT_TRUE(unzigzag(getVarint(p)) == -5);
+  TEST_ASSERT_EQUAL_UINT8(90, *p++);
+  TEST_ASSERT_EQUAL_UINT32(length, p - frame);
+}
+
+void test_batch_steady_patient_is_compact(void) {
+  TemperatureReading readings[24];
+  for (uint8_t i = 0; i < 24; i++) {
+    readings[i] = sampleReading();
+    readings[i].probeCount = 1;
+    readings[i].seq += i;
+    readings[i].timestamp += 60000ULL * i;
+  }
+  uint8_t frame[BATCH_FRAME_MAX_SIZE];
+  size_t one = encodeReadingBatch(sampleSource(), readings, 1, frame, sizeof(frame));
+  size_t all = encodeReadingBatch(sampleSource(), readings, 24, frame, sizeof(frame));
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(13, (all - one) / 23);
+}
+
+void test_batch_rejects_bad_counts(void) {
+  TemperatureReading reading = sampleReading();
+  uint8_t frame[BATCH_FRAME_MAX_SIZE];
+  TEST_ASSERT_EQUAL_UINT32(0, encodeReadingBatch(sampleSource(), &reading, 0, frame, sizeof(frame)));
+  TEST_ASSERT_EQUAL_UINT32(0, encodeReadingBatch(sampleSource(), &reading, 1, frame, 16));
+}
+
+void test_json_reading(void) {
+  TemperatureReading reading = sampleReading();
+  char out[READING_JSON_MAX_SIZE];
+  size_t length = encodeReadingJson(reading, sampleSource(), false, out, sizeof(out));
+  TEST_ASSERT_TRUE(length > 0);
+  TEST_ASSERT_EQUAL_UINT32(strlen(out), length);
+
+  StaticJsonDocument<1024> doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, out, length));
+  TEST_ASSERT_EQUAL_STRING("botcareu_0123456789ab", doc["deviceId"].as<const char*>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 37.25f, doc["temperature"].as<float>());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.9f, doc["confidence"].as<float>());
+  TEST_ASSERT_EQUAL_STRING("contact", doc["measurementType"].as<const char*>());
+  TEST_ASSERT_EQUAL_UINT32(4242, doc["seq"].as<uint32_t>());
+  TEST_ASSERT_EQUAL_UINT32(0xA1B2C3D4, doc["seqEpoch"].as<uint32_t>());
+  TEST_ASSERT_TRUE(doc["timestamp"].as<uint64_t>() == 1760000000123ULL);
+  TEST_ASSERT_EQUAL_UINT32(2, doc["probes"].size());
+  TEST_ASSERT_FALSE(doc.containsKey("infraredTemp"));
+  TEST_ASSERT_EQUAL_INT(-61, doc["metadata"]["signalStrength"].as<int>());
+}
+
+void test_json_worst_case_fits(void) {
+  TemperatureReading reading = sampleReading();
+  reading.infraredTemp = 36.123457f;
+  reading.contactTemp = 36.876543f;
+  reading.ambientTemp = 22.345679f;
+  reading.infraredVariance = 0.0123457f;
+  reading.probeCount = READING_PROBE_MAX;
+  for (uint8_t i = 0; i < READING_PROBE_MAX; i++) reading.probeTemps[i] = 36.876543f - i;
+  reading.seq = UINT32_MAX;
+  reading.seqEpoch = UINT32_MAX;
+  reading.measurementType = MEASUREMENT_INFRARED;
+  TelemetrySource source = sampleSource();
+  source.firmwareVersion = "10.20.30-rc.40";
+  source.batteryVoltage = 3.789123f;
+  source.signalStrength = -100;
+
+  char out[READING_JSON_MAX_SIZE];
+  TEST_ASSERT_TRUE(encodeReadingJson(reading, source, true, out, sizeof(out)) > 0);
+
+  StaticJsonDocument<1024> doc;
+  TEST_ASSERT_FALSE(deserializeJson(doc, out));
+  TEST_ASSERT_EQUAL_UINT32(READING_PROBE_MAX, doc["probes"].size());
+  TEST_ASSERT_TRUE(doc["metadata"].containsKey("firmwareVersion"));
+}
+
+void test_json_needs_capacity(void) {
+  TemperatureReading reading = sampleReading();
+  char out[64];
+  TEST_ASSERT_EQUAL_UINT32(0, encodeReadingJson(reading, sampleSource(), false, out, sizeof(out)));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_reading_frame_layout);
+  RUN_TEST(test_reading_frame_needs_capacity);
+  RUN_TEST(test_status_frame_optional_sections);
+  RUN_TEST(test_batch_deltas_decode);
+  RUN_TEST(test_batch_steady_patient_is_compact);
+  RUN_TEST(test_batch_rejects_bad_counts);
+  RUN_TEST(test_json_reading);
+  RUN_TEST(test_json_worst_case_fits);
+  RUN_TEST(test_json_needs_capacity);
+  return UNITY_END();
+}
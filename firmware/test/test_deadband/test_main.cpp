@@ -0,0 +1,79 @@
+// Deadband reporting decisions
+#include <unity.h>
+
+#include "deadband.h"
+
+#define BAND 0.2f
+#define SILENCE 300000UL
+#define FEVER 38.0f
+
+static DeadbandFilter filter;
+
+void setUp(void) {
+  deadbandReset(filter);
+}
+
+void tearDown(void) {}
+
+void test_first_reading_reports(void) {
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 36.8f, 1000, BAND, SILENCE, FEVER));
+}
+
+void test_inside_band_is_suppressed(void) {
+  deadbandShouldReport(filter, 36.8f, 0, BAND, SILENCE, FEVER);
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.95f, 60000, BAND, SILENCE, FEVER));
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.65f, 120000, BAND, SILENCE, FEVER));
+}
+
+void test_outside_band_reports_and_moves_reference(void) {
+  deadbandShouldReport(filter, 36.8f, 0, BAND, SILENCE, FEVER);
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 37.1f, 60000, BAND, SILENCE, FEVER));
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.95f, 120000, BAND, SILENCE, FEVER));
+}
+
+void test_small_drift_does_not_accumulate(void) {
+  deadbandShouldReport(filter, 36.8f, 0, BAND, SILENCE, FEVER);
+  // Small steps stay inside the band only until they add up past it
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.9f, 10000, BAND, SILENCE, FEVER));
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.98f, 20000, BAND, SILENCE, FEVER));
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 37.1f, 30000, BAND, SILENCE, FEVER));
+}
+
+void test_fever_crossing_always_reports(void) {
+  deadbandShouldReport(filter, 37.9f, 0, BAND, SILENCE, FEVER);
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 38.0f, 60000, BAND, SILENCE, FEVER));
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 37.95f, 120000, BAND, SILENCE, FEVER));
+}
+
+void test_max_silence_forces_report(void) {
+  deadbandShouldReport(filter, 36.8f, 0, BAND, SILENCE, FEVER);
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.8f, SILENCE - 1, BAND, SILENCE, FEVER));
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 36.8f, SILENCE, BAND, SILENCE, FEVER));
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.8f, SILENCE + 1, BAND, SILENCE, FEVER));
+}
+
+void test_max_silence_across_millis_wrap(void) {
+  unsigned long start = (unsigned long)-1000;
+  deadbandShouldReport(filter, 36.8f, start, BAND, SILENCE, FEVER);
+  TEST_ASSERT_FALSE(deadbandShouldReport(filter, 36.8f, start + 2000, BAND, SILENCE, FEVER));
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 36.8f, start + SILENCE, BAND, SILENCE, FEVER));
+}
+
+void test_zero_band_disables_filter(void) {
+  deadbandShouldReport(filter, 36.8f, 0, 0, SILENCE, FEVER);
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 36.8f, 1, 0, SILENCE, FEVER));
+  TEST_ASSERT_TRUE(deadbandShouldReport(filter, 36.8f, 2, -1.0f, SILENCE, FEVER));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_reading_reports);
+  RUN_TEST(test_inside_band_is_suppressed);
+  RUN_TEST(test_outside_band_reports_and_moves_reference);
+  RUN_TEST(test_small_drift_does_not_accumulate);
+  RUN_TEST(test_fever_crossing_always_reports);
+  RUN_TEST(test_max_silence_forces_report);
+  RUN_TEST(test_max_silence_across_millis_wrap);
+  RUN_TEST(test_zero_band_disables_filter);
+  return UNITY_END();
+}
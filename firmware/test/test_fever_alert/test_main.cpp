@@ -0,0 +1,134 @@
+// Fever alert state machine: hysteresis, escalation, reminders and clearing
+#include <math.h>
+#include <unity.h>
+
+#include "fever_alert.h"
+
+#define REALERT 1800000UL
+
+static const AlertBands bands = {
+  37.5f,    // feverThreshold
+  38.5f,    // highFeverThreshold
+  40.0f,    // criticalTempThreshold
+  0.3f,     // hysteresis
+  REALERT
+};
+
+static AlertState state;
+
+void setUp(void) {
+  alertReset(state);
+}
+
+void tearDown(void) {}
+
+void test_normal_temperatures_stay_quiet(void) {
+  for (unsigned long t = 0; t < 10 * REALERT; t += 60000) {
+    TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 36.8f, t, bands));
+  }
+  TEST_ASSERT_EQUAL(FEVER_NONE, state.severity);
+}
+
+void test_fever_raises_once(void) {
+  TEST_ASSERT_EQUAL(ALERT_EVENT_RAISED, alertUpdate(state, 37.5f, 0, bands));
+  TEST_ASSERT_EQUAL(FEVER_MODERATE, state.severity);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.6f, 60000, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.5f, 120000, bands));
+}
+
+void test_hysteresis_holds_the_band(void) {
+  alertUpdate(state, 37.6f, 0, bands);
+  // Hovering just under the threshold neither clears nor re-raises
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.4f, 60000, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.55f, 120000, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.25f, 180000, bands));
+  TEST_ASSERT_EQUAL(FEVER_MODERATE, state.severity);
+
+  TEST_ASSERT_EQUAL(ALERT_EVENT_CLEARED, alertUpdate(state, 37.1f, 240000, bands));
+  TEST_ASSERT_EQUAL(FEVER_NONE, state.severity);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.1f, 300000, bands));
+
+  // The next fever is a new one
+  TEST_ASSERT_EQUAL(ALERT_EVENT_RAISED, alertUpdate(state, 37.5f, 360000, bands));
+}
+
+void test_escalation_is_immediate(void) {
+  alertUpdate(state, 37.8f, 0, bands);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_ESCALATED, alertUpdate(state, 38.5f, 60000, bands));
+  TEST_ASSERT_EQUAL(FEVER_HIGH, state.severity);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_ESCALATED, alertUpdate(state, 40.1f, 120000, bands));
+  TEST_ASSERT_EQUAL(FEVER_CRITICAL, state.severity);
+}
+
+void test_falling_back_does_not_re_escalate(void) {
+  alertUpdate(state, 37.8f, 0, bands);
+  alertUpdate(state, 38.6f, 60000, bands);
+  // Down a band, then back up into the one already announced
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 38.1f, 120000, bands));
+  TEST_ASSERT_EQUAL(FEVER_MODERATE, state.severity);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 38.6f, 180000, bands));
+  TEST_ASSERT_EQUAL(FEVER_HIGH, state.severity);
+}
+
+void test_straight_to_critical_raises(void) {
+  TEST_ASSERT_EQUAL(ALERT_EVENT_RAISED, alertUpdate(state, 40.2f, 0, bands));
+  TEST_ASSERT_EQUAL(FEVER_CRITICAL, state.severity);
+}
+
+void test_reminder_after_interval(void) {
+  alertUpdate(state, 37.8f, 1000, bands);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.8f, 1000 + REALERT - 1, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_REMINDER, alertUpdate(state, 37.8f, 1000 + REALERT, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.8f, 1000 + REALERT + 60000, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_REMINDER, alertUpdate(state, 37.8f, 1000 + 2 * REALERT, bands));
+}
+
+void test_escalation_restarts_reminder_interval(void) {
+  alertUpdate(state, 37.8f, 0, bands);
+  alertUpdate(state, 38.6f, REALERT - 60000, bands);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 38.6f, REALERT, bands));
+  TEST_ASSERT_EQUAL(ALERT_EVENT_REMINDER, alertUpdate(state, 38.6f, 2 * REALERT - 60000, bands));
+}
+
+void test_zero_interval_never_reminds(void) {
+  AlertBands quiet = bands;
+  quiet.realertInterval = 0;
+  alertUpdate(state, 37.8f, 0, quiet);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 37.8f, 100 * REALERT, quiet));
+}
+
+void test_failed_reading_holds_state(void) {
+  alertUpdate(state, 38.6f, 0, bands);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, NAN, 60000, bands));
+  TEST_ASSERT_EQUAL(FEVER_HIGH, state.severity);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, 38.6f, 120000, bands));
+
+  // Nor does one raise a fever from nothing
+  alertReset(state);
+  TEST_ASSERT_EQUAL(ALERT_EVENT_NONE, alertUpdate(state, NAN, 0, bands));
+  TEST_ASSERT_EQUAL(FEVER_NONE, state.severity);
+}
+
+void test_event_names(void) {
+  TEST_ASSERT_EQUAL_STRING("fever_detected", alertEventName(ALERT_EVENT_RAISED));
+  TEST_ASSERT_EQUAL_STRING("fever_escalated", alertEventName(ALERT_EVENT_ESCALATED));
+  TEST_ASSERT_EQUAL_STRING("fever_reminder", alertEventName(ALERT_EVENT_REMINDER));
+  TEST_ASSERT_EQUAL_STRING("fever_cleared", alertEventName(ALERT_EVENT_CLEARED));
+  TEST_ASSERT_EQUAL_STRING("none", alertEventName(ALERT_EVENT_NONE));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_normal_temperatures_stay_quiet);
+  RUN_TEST(test_fever_raises_once);
+  RUN_TEST(test_hysteresis_holds_the_band);
+  RUN_TEST(test_escalation_is_immediate);
+  RUN_TEST(test_falling_back_does_not_re_escalate);
+  RUN_TEST(test_straight_to_critical_raises);
+  RUN_TEST(test_reminder_after_interval);
+  RUN_TEST(test_escalation_restarts_reminder_interval);
+  RUN_TEST(test_zero_interval_never_reminds);
+  RUN_TEST(test_failed_reading_holds_state);
+  RUN_TEST(test_event_names);
+  return UNITY_END();
+}
@@ -0,0 +1,122 @@
+// Health Thermometer Temperature Measurement values as generic BLE apps
+// parse them: flags, IEEE 11073 FLOAT and the date-time field
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+#include "health_thermometer.h"
+
+static TemperatureReading reading;
+static uint8_t out[HTS_MEASUREMENT_MAX_SIZE + 4];
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Decodes an IEEE 11073 FLOAT the way a receiving app would
+static float decodeFloat(uint32_t value) {
+  int32_t mantissa = value & 0x00FFFFFF;
+  if (mantissa & 0x00800000) mantissa -= 0x01000000;
+  int8_t exponent = (int8_t)(value >> 24);
+  return (float)(mantissa * pow(10.0, exponent));
+}
+
+void setUp(void) {
+  memset(&reading, 0, sizeof(reading));
+  memset(out, 0xAA, sizeof(out));
+  reading.fusedTemp = 37.25f;
+  reading.isValid = true;
+}
+
+void tearDown(void) {}
+
+void test_unsynced_reading_has_no_timestamp(void) {
+  reading.timestamp = 123456;   // ms since power-up, meaningless as a date
+  TEST_ASSERT_EQUAL(5, encodeHealthThermometerMeasurement(reading, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_HEX8(0x00, out[0]);
+  TEST_ASSERT_EQUAL_UINT32(0xFE000E8D, getU32(out + 1));   // 3725 × 10^-2
+  TEST_ASSERT_EQUAL_HEX8(0xAA, out[5]);
+}
+
+void test_synced_reading_carries_date_time(void) {
+  reading.clockSynced = true;
+  reading.timestamp = 1709214330000ULL;   // 2024-02-29 13:45:30 UTC
+  TEST_ASSERT_EQUAL(HTS_MEASUREMENT_MAX_SIZE,
+                    encodeHealthThermometerMeasurement(reading, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_HEX8(0x02, out[0]);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 37.25f, decodeFloat(getU32(out + 1)));
+  TEST_ASSERT_EQUAL_UINT16(2024, (uint16_t)(out[5] | (out[6] << 8)));
+  TEST_ASSERT_EQUAL_UINT8(2, out[7]);
+  TEST_ASSERT_EQUAL_UINT8(29, out[8]);
+  TEST_ASSERT_EQUAL_UINT8(13, out[9]);
+  TEST_ASSERT_EQUAL_UINT8(45, out[10]);
+  TEST_ASSERT_EQUAL_UINT8(30, out[11]);
+}
+
+void test_date_around_month_and_year_boundaries(void) {
+  reading.clockSynced = true;
+
+  reading.timestamp = 1704067199000ULL;   // 2023-12-31 23:59:59
+  encodeHealthThermometerMeasurement(reading, out, sizeof(out));
+  TEST_ASSERT_EQUAL_UINT16(2023, (uint16_t)(out[5] | (out[6] << 8)));
+  TEST_ASSERT_EQUAL_UINT8(12, out[7]);
+  TEST_ASSERT_EQUAL_UINT8(31, out[8]);
+  TEST_ASSERT_EQUAL_UINT8(23, out[9]);
+  TEST_ASSERT_EQUAL_UINT8(59, out[10]);
+  TEST_ASSERT_EQUAL_UINT8(59, out[11]);
+
+  reading.timestamp = 1704067200000ULL;   // One second later
+  encodeHealthThermometerMeasurement(reading, out, sizeof(out));
+  TEST_ASSERT_EQUAL_UINT16(2024, (uint16_t)(out[5] | (out[6] << 8)));
+  TEST_ASSERT_EQUAL_UINT8(1, out[7]);
+  TEST_ASSERT_EQUAL_UINT8(1, out[8]);
+  TEST_ASSERT_EQUAL_UINT8(0, out[9]);
+
+  reading.timestamp = 951868800000ULL;    // 2000-03-01, after a century leap day
+  encodeHealthThermometerMeasurement(reading, out, sizeof(out));
+  TEST_ASSERT_EQUAL_UINT16(2000, (uint16_t)(out[5] | (out[6] << 8)));
+  TEST_ASSERT_EQUAL_UINT8(3, out[7]);
+  TEST_ASSERT_EQUAL_UINT8(1, out[8]);
+}
+
+void test_rounds_to_two_decimals(void) {
+  reading.fusedTemp = 36.876f;
+  encodeHealthThermometerMeasurement(reading, out, sizeof(out));
+  TEST_ASSERT_EQUAL_UINT32(0xFE000E68, getU32(out + 1));   // 3688 × 10^-2
+}
+
+void test_negative_temperature_keeps_sign(void) {
+  reading.fusedTemp = -5.5f;
+  encodeHealthThermometerMeasurement(reading, out, sizeof(out));
+  TEST_ASSERT_EQUAL_UINT32(0xFEFFFDDA, getU32(out + 1));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, -5.5f, decodeFloat(getU32(out + 1)));
+}
+
+void test_missing_temperature_is_float_nan(void) {
+  reading.fusedTemp = NAN;
+  TEST_ASSERT_EQUAL(5, encodeHealthThermometerMeasurement(reading, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_UINT32(0x007FFFFF, getU32(out + 1));
+}
+
+void test_short_buffer_is_rejected(void) {
+  TEST_ASSERT_EQUAL(0, encodeHealthThermometerMeasurement(reading, out, 4));
+  TEST_ASSERT_EQUAL_HEX8(0xAA, out[0]);
+
+  reading.clockSynced = true;
+  reading.timestamp = 1709214330000ULL;
+  TEST_ASSERT_EQUAL(0, encodeHealthThermometerMeasurement(reading, out, HTS_MEASUREMENT_MAX_SIZE - 1));
+  TEST_ASSERT_EQUAL(HTS_MEASUREMENT_MAX_SIZE,
+                    encodeHealthThermometerMeasurement(reading, out, HTS_MEASUREMENT_MAX_SIZE));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsynced_reading_has_no_timestamp);
+  RUN_TEST(test_synced_reading_carries_date_time);
+  RUN_TEST(test_date_around_month_and_year_boundaries);
+  RUN_TEST(test_rounds_to_two_decimals);
+  RUN_TEST(test_negative_temperature_keeps_sign);
+  RUN_TEST(test_missing_temperature_is_float_nan);
+  RUN_TEST(test_short_buffer_is_rejected);
+  return UNITY_END();
+}
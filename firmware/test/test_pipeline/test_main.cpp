@@ -0,0 +1,229 @@
+// The measurement pipeline against scripted sensors and a recording
+// transport: sampling, fusion, encoding and publishing
+#include <math.h>
+#include <string.h>
+#include <unity.h>
+
+#include "measurement.h"
+#include "sensor_fusion.h"
+#include "sensor_source.h"
+#include "telemetry_transport.h"
+
+#define SCRIPT_MAX 16
+
+struct ScriptedSensors {
+  float infrared[SCRIPT_MAX];
+  uint8_t infraredCount;
+  uint8_t infraredNext;
+  float ambient;
+  float probes[READING_PROBE_MAX];
+  uint8_t probeCount;
+  uint8_t begins;
+  uint8_t waits;
+  bool probesRead;
+};
+
+struct RecordingTransport {
+  const char* topic;
+  uint8_t payload[READING_JSON_MAX_SIZE];
+  size_t length;
+  size_t capacity;
+  uint8_t calls;
+  bool accept;
+};
+
+static void scriptedBegin(void* context) {
+  ((ScriptedSensors*)context)->begins++;
+}
+
+static void scriptedWait(void* context) {
+  ((ScriptedSensors*)context)->waits++;
+}
+
+static float scriptedInfrared(void* context) {
+  ScriptedSensors* sensors = (ScriptedSensors*)context;
+  if (sensors->infraredNext >= sensors->infraredCount) return NAN;
+  return sensors->infrared[sensors->infraredNext++];
+}
+
+static float scriptedAmbient(void* context) {
+  return ((ScriptedSensors*)context)->ambient;
+}
+
+static uint8_t scriptedProbes(void* context, float* raw, uint8_t maxProbes) {
+  ScriptedSensors* sensors = (ScriptedSensors*)context;
+  uint8_t count = sensors->probeCount < maxProbes ? sensors->probeCount : maxProbes;
+  memcpy(raw, sensors->probes, count * sizeof(float));
+  sensors->probesRead = true;
+  return count;
+}
+
+static bool recordPublish(void* context, const char* topic, uint8_t* payload, size_t length,
+                          size_t capacity) {
+  RecordingTransport* transport = (RecordingTransport*)context;
+  transport->topic = topic;
+  transport->length = length < sizeof(transport->payload) ? length : sizeof(transport->payload);
+  memcpy(transport->payload, payload, transport->length);
+  transport->capacity = capacity;
+  transport->calls++;
+  return transport->accept;
+}
+
+static const SamplingParams sampling = {
+  5,                          // samples
+  FILTER_MODE_MEDIAN,
+  1,                          // filterTrim
+  0.5f,                       // infraredOffset
+  0.1f,                       // contactOffset
+  0                           // primaryProbe
+};
+
+static const FusionParams fusion = {0.1f, 0.3f, 0.1f, 0.01f, 0.2f, 0.2f, 1.0f};
+
+static const ReadingTopics topics = {"botcareu/test/temperature", "botcareu/test/temperature/bin"};
+
+static ScriptedSensors sensors;
+static RecordingTransport recorder;
+
+static SensorSource scriptedSource() {
+  SensorSource source = {&sensors, scriptedBegin, scriptedWait, scriptedInfrared,
+                         scriptedAmbient, scriptedProbes};
+  return source;
+}
+
+static TelemetryTransport recordingTransport() {
+  TelemetryTransport transport = {&recorder, recordPublish};
+  return transport;
+}
+
+static TelemetrySource telemetrySource() {
+  TelemetrySource source = {"botcareu_0123456789ab", "1.0.0", 3.7f, -61};
+  return source;
+}
+
+static TemperatureReading emptyReading() {
+  TemperatureReading reading;
+  memset(&reading, 0, sizeof(reading));
+  reading.seq = 7;
+  reading.timestamp = 1760000000000ULL;
+  reading.clockSynced = true;
+  return reading;
+}
+
+void setUp(void) {
+  memset(&sensors, 0, sizeof(sensors));
+  const float infrared[] = {36.2f, 36.3f, 36.1f, 36.3f, 36.2f};
+  memcpy(sensors.infrared, infrared, sizeof(infrared));
+  sensors.infraredCount = 5;
+  sensors.ambient = 22.0f;
+  sensors.probes[0] = 36.7f;
+  sensors.probes[1] = 23.0f;
+  sensors.probeCount = 2;
+
+  memset(&recorder, 0, sizeof(recorder));
+  recorder.accept = true;
+}
+
+void tearDown(void) {}
+
+void test_sampling_drives_sensors_in_order(void) {
+  TemperatureReading reading = emptyReading();
+  sampleSensors(scriptedSource(), sampling, reading);
+
+  TEST_ASSERT_EQUAL_UINT8(1, sensors.begins);
+  TEST_ASSERT_EQUAL_UINT8(sampling.samples - 1, sensors.waits);
+  TEST_ASSERT_EQUAL_UINT8(sampling.samples, sensors.infraredNext);
+  TEST_ASSERT_TRUE(sensors.probesRead);
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 36.7f, reading.infraredTemp);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 22.0f, reading.ambientTemp);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 36.8f, reading.contactTemp);
+  TEST_ASSERT_EQUAL_UINT8(2, reading.probeCount);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 36.8f, reading.probeTemps[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 23.0f, reading.probeTemps[1]);
+  TEST_ASSERT_FLOAT_IS_NAN(reading.probeTemps[2]);
+}
+
+void test_sampling_drops_implausible_samples(void) {
+  sensors.infrared[1] = NAN;
+  sensors.infrared[3] = 80.0f;
+  TemperatureReading reading = emptyReading();
+  sampleSensors(scriptedSource(), sampling, reading);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 36.7f, reading.infraredTemp);
+
+  // Too few left for a majority
+  setUp();
+  sensors.infraredCount = 2;
+  reading = emptyReading();
+  sampleSensors(scriptedSource(), sampling, reading);
+  TEST_ASSERT_FLOAT_IS_NAN(reading.infraredTemp);
+  TEST_ASSERT_FLOAT_IS_NAN(reading.infraredVariance);
+}
+
+void test_sampling_without_optional_callbacks(void) {
+  SensorSource source = scriptedSource();
+  source.begin = NULL;
+  source.waitSample = NULL;
+  sensors.probeCount = 0;
+  TemperatureReading reading = emptyReading();
+  sampleSensors(source, sampling, reading);
+
+  TEST_ASSERT_EQUAL_UINT8(0, sensors.begins);
+  TEST_ASSERT_EQUAL_UINT8(0, sensors.waits);
+  TEST_ASSERT_EQUAL_UINT8(0, reading.probeCount);
+  TEST_ASSERT_EQUAL_FLOAT(PROBE_DISCONNECTED, reading.contactTemp);
+}
+
+void test_binary_reading_reaches_transport(void) {
+  TemperatureReading reading = emptyReading();
+  FusionState state;
+  fusionReset(state);
+  sampleSensors(scriptedSource(), sampling, reading);
+  fusionUpdate(state, reading, 60000, fusion);
+  TEST_ASSERT_TRUE(reading.isValid);
+
+  TEST_ASSERT_TRUE(publishReading(recordingTransport(), topics, reading, telemetrySource(),
+                                  TELEMETRY_FORMAT_BINARY, false));
+  TEST_ASSERT_EQUAL_UINT8(1, recorder.calls);
+  TEST_ASSERT_EQUAL_STRING(topics.binary, recorder.topic);
+  TEST_ASSERT_EQUAL_UINT32(READING_FRAME_SIZE, recorder.length);
+  TEST_ASSERT_TRUE(recorder.capacity >= READING_FRAME_SIZE + TELEMETRY_TRANSPORT_RESERVE);
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_BINARY_VERSION, recorder.payload[0]);
+  TEST_ASSERT_EQUAL_UINT8(7, recorder.payload[2]);
+  TEST_ASSERT_EQUAL_UINT8(2, recorder.payload[27]);
+}
+
+void test_json_reading_reaches_transport(void) {
+  TemperatureReading reading = emptyReading();
+  FusionState state;
+  fusionReset(state);
+  sampleSensors(scriptedSource(), sampling, reading);
+  fusionUpdate(state, reading, 60000, fusion);
+
+  TEST_ASSERT_TRUE(publishReading(recordingTransport(), topics, reading, telemetrySource(),
+                                  TELEMETRY_FORMAT_JSON, true));
+  TEST_ASSERT_EQUAL_STRING(topics.json, recorder.topic);
+  TEST_ASSERT_TRUE(recorder.length > 0);
+  TEST_ASSERT_EQUAL_UINT8('{', recorder.payload[0]);
+  TEST_ASSERT_EQUAL_UINT8('}', recorder.payload[recorder.length - 1]);
+  TEST_ASSERT_TRUE(recorder.capacity >= recorder.length + TELEMETRY_TRANSPORT_RESERVE);
+}
+
+void test_transport_refusal_propagates(void) {
+  recorder.accept = false;
+  TemperatureReading reading = emptyReading();
+  TEST_ASSERT_FALSE(publishReading(recordingTransport(), topics, reading, telemetrySource(),
+                                   TELEMETRY_FORMAT_BINARY, false));
+  TEST_ASSERT_EQUAL_UINT8(1, recorder.calls);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sampling_drives_sensors_in_order);
+  RUN_TEST(test_sampling_drops_implausible_samples);
+  RUN_TEST(test_sampling_without_optional_callbacks);
+  RUN_TEST(test_binary_reading_reaches_transport);
+  RUN_TEST(test_json_reading_reaches_transport);
+  RUN_TEST(test_transport_refusal_propagates);
+  return UNITY_END();
+}
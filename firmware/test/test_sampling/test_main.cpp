@@ -0,0 +1,130 @@
+// Sample filters and the measurement rules built on them
+#include <math.h>
+#include <unity.h>
+
+#include "measurement.h"
+#include "sampling.h"
+
+static SampleBuffer bufferOf(const float* values, uint8_t count) {
+  SampleBuffer buffer;
+  sampleBufferReset(buffer);
+  for (uint8_t i = 0; i < count; i++) {
+    sampleBufferPush(buffer, values[i]);
+  }
+  return buffer;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_empty_buffer_gives_nan(void) {
+  SampleBuffer buffer;
+  sampleBufferReset(buffer);
+  TEST_ASSERT_FLOAT_IS_NAN(sampleBufferMedian(buffer));
+  TEST_ASSERT_FLOAT_IS_NAN(sampleBufferTrimmedMean(buffer, 1));
+  TEST_ASSERT_FLOAT_IS_NAN(sampleBufferVariance(buffer));
+}
+
+void test_median_odd_and_even(void) {
+  const float odd[] = {37.0f, 36.0f, 45.0f, 36.5f, 36.8f};
+  SampleBuffer buffer = bufferOf(odd, 5);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 36.8f, sampleBufferMedian(buffer));
+
+  const float even[] = {36.0f, 37.0f, 36.4f, 36.6f};
+  buffer = bufferOf(even, 4);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 36.5f, sampleBufferMedian(buffer));
+}
+
+void test_trimmed_mean_drops_outliers(void) {
+  const float values[] = {36.5f, 20.0f, 36.6f, 36.4f, 49.0f};
+  SampleBuffer buffer = bufferOf(values, 5);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 36.5f, sampleBufferTrimmedMean(buffer, 1));
+}
+
+void test_trimmed_mean_never_trims_everything(void) {
+  const float values[] = {36.0f, 37.0f};
+  SampleBuffer buffer = bufferOf(values, 2);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 36.5f, sampleBufferTrimmedMean(buffer, 1));
+}
+
+void test_variance(void) {
+  const float values[] = {36.0f, 37.0f, 38.0f};
+  SampleBuffer buffer = bufferOf(values, 3);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 1.0f, sampleBufferVariance(buffer));
+
+  buffer = bufferOf(values, 1);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, sampleBufferVariance(buffer));
+}
+
+void test_ring_keeps_the_newest_samples(void) {
+  SampleBuffer buffer;
+  sampleBufferReset(buffer);
+  for (uint8_t i = 0; i < SAMPLE_BUFFER_CAPACITY + 4; i++) {
+    sampleBufferPush(buffer, i < 4 ? 0.0f : 40.0f);
+  }
+  TEST_ASSERT_EQUAL_UINT8(SAMPLE_BUFFER_CAPACITY, buffer.count);
+  TEST_ASSERT_EQUAL_FLOAT(40.0f, sampleBufferMedian(buffer));
+}
+
+void test_validate_temperature(void) {
+  TEST_ASSERT_TRUE(validateTemperature(36.6f));
+  TEST_ASSERT_FALSE(validateTemperature(NAN));
+  TEST_ASSERT_FALSE(validateTemperature(PROBE_DISCONNECTED));
+  TEST_ASSERT_FALSE(validateTemperature(55.0f));
+}
+
+void test_infrared_needs_a_majority_of_samples(void) {
+  TemperatureReading reading;
+  const float values[] = {36.5f, 36.7f};
+  SampleBuffer buffer = bufferOf(values, 2);
+
+  resolveInfrared(reading, buffer, 5, FILTER_MODE_MEDIAN, 0, 0.5f);
+  TEST_ASSERT_FLOAT_IS_NAN(reading.infraredTemp);
+  TEST_ASSERT_FLOAT_IS_NAN(reading.infraredVariance);
+
+  resolveInfrared(reading, buffer, 4, FILTER_MODE_MEDIAN, 0, 0.5f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 37.1f, reading.infraredTemp);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.02f, reading.infraredVariance);
+}
+
+void test_probes_calibrate_only_the_primary(void) {
+  TemperatureReading reading;
+  const float raw[] = {22.0f, 36.6f, PROBE_DISCONNECTED};
+
+  resolveProbes(reading, raw, 3, 1, 0.2f);
+  TEST_ASSERT_EQUAL_UINT8(3, reading.probeCount);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 22.0f, reading.probeTemps[0]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 36.8f, reading.probeTemps[1]);
+  TEST_ASSERT_FLOAT_IS_NAN(reading.probeTemps[2]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 36.8f, reading.contactTemp);
+}
+
+void test_missing_primary_probe_reads_disconnected(void) {
+  TemperatureReading reading;
+  resolveProbes(reading, NULL, 0, 0, 0.2f);
+  TEST_ASSERT_EQUAL_UINT8(0, reading.probeCount);
+  TEST_ASSERT_EQUAL_FLOAT(PROBE_DISCONNECTED, reading.contactTemp);
+}
+
+void test_classify_fever(void) {
+  TEST_ASSERT_EQUAL(FEVER_NONE, classifyFever(37.4f, 37.5f, 38.5f, 40.0f));
+  TEST_ASSERT_EQUAL(FEVER_MODERATE, classifyFever(37.5f, 37.5f, 38.5f, 40.0f));
+  TEST_ASSERT_EQUAL(FEVER_HIGH, classifyFever(39.0f, 37.5f, 38.5f, 40.0f));
+  TEST_ASSERT_EQUAL(FEVER_CRITICAL, classifyFever(40.0f, 37.5f, 38.5f, 40.0f));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_buffer_gives_nan);
+  RUN_TEST(test_median_odd_and_even);
+  RUN_TEST(test_trimmed_mean_drops_outliers);
+  RUN_TEST(test_trimmed_mean_never_trims_everything);
+  RUN_TEST(test_variance);
+  RUN_TEST(test_ring_keeps_the_newest_samples);
+  RUN_TEST(test_validate_temperature);
+  RUN_TEST(test_infrared_needs_a_majority_of_samples);
+  RUN_TEST(test_probes_calibrate_only_the_primary);
+  RUN_TEST(test_missing_primary_probe_reads_disconnected);
+  RUN_TEST(test_classify_fever);
+  return UNITY_END();
+}
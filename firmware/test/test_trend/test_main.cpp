@@ -0,0 +1,117 @@
+// Trend statistics: time-based EWMA, window slope and fever onset
+#include <math.h>
+#include <unity.h>
+
+#include "trend.h"
+
+static const TrendParams params = {
+  600000,   // ewmaTimeConstant
+  38.0f,    // feverThreshold
+  0.8f,     // onsetMargin
+  0.02f,    // onsetSlope, °C per minute
+  4         // onsetMinSamples
+};
+
+static TrendStats stats;
+
+void setUp(void) {
+  trendReset(stats);
+}
+
+void tearDown(void) {}
+
+void test_first_reading_seeds_statistics(void) {
+  trendUpdate(stats, 36.8f, 5000, params);
+  TEST_ASSERT_EQUAL_FLOAT(36.8f, stats.ewma);
+  TEST_ASSERT_EQUAL_FLOAT(36.8f, stats.minTemperature);
+  TEST_ASSERT_EQUAL_FLOAT(36.8f, stats.maxTemperature);
+  TEST_ASSERT_EQUAL_FLOAT(0, stats.slope);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.samples);
+}
+
+void test_ewma_decays_with_elapsed_time(void) {
+  trendUpdate(stats, 37.0f, 0, params);
+  trendUpdate(stats, 38.0f, params.ewmaTimeConstant, params);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 37.0f + (1.0f - expf(-1.0f)), stats.ewma);
+
+  // Same elapsed time in many short steps lands in the same place
+  TrendStats stepped;
+  trendReset(stepped);
+  trendUpdate(stepped, 37.0f, 0, params);
+  for (unsigned long t = 10000; t <= params.ewmaTimeConstant; t += 10000) {
+    trendUpdate(stepped, 38.0f, t, params);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, stats.ewma, stepped.ewma);
+}
+
+void test_slope_of_linear_rise(void) {
+  for (uint8_t i = 0; i < 10; i++) {
+    trendUpdate(stats, 36.5f + 0.05f * i, 30000UL * i, params);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.1f, stats.slope);
+}
+
+void test_slope_survives_window_wraps(void) {
+  // Three wraps of the window, each rebasing the sums
+  for (uint8_t i = 0; i < 3 * TREND_WINDOW + 5; i++) {
+    trendUpdate(stats, 36.0f + 0.01f * i, 3600000UL + 60000UL * i, params);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-3f, 0.01f, stats.slope);
+  TEST_ASSERT_EQUAL_UINT8(TREND_WINDOW, stats.windowCount);
+}
+
+void test_flat_window_has_no_slope(void) {
+  for (uint8_t i = 0; i < TREND_WINDOW + 3; i++) {
+    trendUpdate(stats, 36.9f, 60000UL * i, params);
+  }
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0, stats.slope);
+}
+
+void test_fever_time_counts_intervals_after_fever_readings(void) {
+  trendUpdate(stats, 38.5f, 0, params);
+  trendUpdate(stats, 38.5f, 60000, params);
+  trendUpdate(stats, 37.0f, 120000, params);
+  trendUpdate(stats, 37.0f, 180000, params);
+  TEST_ASSERT_EQUAL_UINT32(120000, stats.feverTime);
+  TEST_ASSERT_EQUAL_FLOAT(37.0f, stats.minTemperature);
+  TEST_ASSERT_EQUAL_FLOAT(38.5f, stats.maxTemperature);
+}
+
+void test_one_rise_raises_one_onset(void) {
+  uint8_t onsets = 0;
+  unsigned long t = 0;
+  for (uint8_t i = 0; i < 40; i++, t += 60000) {
+    if (trendUpdate(stats, 36.8f + 0.05f * i, t, params)) onsets++;
+  }
+  TEST_ASSERT_EQUAL_UINT8(1, onsets);
+  TEST_ASSERT_TRUE(stats.onset);
+
+  // Back to normal clears the latch, and the next rise raises again
+  for (uint8_t i = 0; i < 30; i++, t += 60000) {
+    trendUpdate(stats, 36.5f, t, params);
+  }
+  TEST_ASSERT_FALSE(stats.onset);
+  for (uint8_t i = 0; i < 40; i++, t += 60000) {
+    if (trendUpdate(stats, 36.8f + 0.05f * i, t, params)) onsets++;
+  }
+  TEST_ASSERT_EQUAL_UINT8(2, onsets);
+}
+
+void test_no_onset_when_already_feverish(void) {
+  for (uint8_t i = 0; i < 10; i++) {
+    TEST_ASSERT_FALSE(trendUpdate(stats, 38.2f + 0.05f * i, 60000UL * i, params));
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_reading_seeds_statistics);
+  RUN_TEST(test_ewma_decays_with_elapsed_time);
+  RUN_TEST(test_slope_of_linear_rise);
+  RUN_TEST(test_slope_survives_window_wraps);
+  RUN_TEST(test_flat_window_has_no_slope);
+  RUN_TEST(test_fever_time_counts_intervals_after_fever_readings);
+  RUN_TEST(test_one_rise_raises_one_onset);
+  RUN_TEST(test_no_onset_when_already_feverish);
+  return UNITY_END();
+}
@@ -1,19 +1,18 @@
 import { BleManager, Device, Characteristic, Service } from 'react-native-ble-plx';
 import { PermissionsAndroid, Platform } from 'react-native';
 
+// Readings stream over the standard Health Thermometer service
+const HEALTH_THERMOMETER_SERVICE_UUID = '00001809-0000-1000-8000-00805f9b34fb';
+const INTERMEDIATE_TEMPERATURE_CHARACTERISTIC_UUID = '00002a1e-0000-1000-8000-00805f9b34fb';
+
 // BotCareU Device Service UUIDs
 const BOTCAREU_SERVICE_UUID = '12345678-1234-1234-1234-123456789abc';
-const TEMPERATURE_CHARACTERISTIC_UUID = '12345678-1234-1234-1234-123456789abd';
 const DEVICE_INFO_CHARACTERISTIC_UUID = '12345678-1234-1234-1234-123456789abe';
 const CONFIG_CHARACTERISTIC_UUID = '12345678-1234-1234-1234-123456789abf';
 
 export interface TemperatureReading {
-  infraredTemp: number;
-  contactTemp: number;
-  ambientTemp: number;
+  temperature: number | null;  // Fused core temperature, °C
   timestamp: number;
-  batteryLevel: number;
-  signalStrength: number;
 }
 
 export interface DeviceInfo {
@@ -33,6 +32,34 @@ export interface DeviceConfig {
   soundEnabled: boolean;
 }
 
+// Decodes a Health Thermometer temperature measurement: a flags byte, an
+// IEEE 11073 FLOAT, then a date-time when flag bit 1 is set
+function parseTemperatureMeasurement(value: string): TemperatureReading {
+  const byte = (i: number) => value.charCodeAt(i) & 0xff;
+  if (value.length < 5) {
+    throw new Error(`Temperature measurement too short: ${value.length} bytes`);
+  }
+
+  const flags = byte(0);
+  let mantissa = byte(1) | (byte(2) << 8) | (byte(3) << 16);
+  const exponent = (byte(4) << 24) >> 24;
+  let temperature: number | null = null;
+  if (mantissa !== 0x7fffff) {
+    if (mantissa & 0x800000) mantissa -= 0x1000000;
+    temperature = mantissa * Math.pow(10, exponent);
+    if ((flags & 0x01) !== 0) {
+      temperature = (temperature - 32) * 5 / 9;  // Sent in Fahrenheit
+    }
+  }
+
+  let timestamp = Date.now();
+  if ((flags & 0x02) !== 0 && value.length >= 12) {
+    timestamp = Date.UTC(byte(5) | (byte(6) << 8), byte(7) - 1, byte(8), byte(9), byte(10), byte(11));
+  }
+
+  return { temperature, timestamp };
+}
+
 class BluetoothService {
   private manager: BleManager;
   private connectedDevice: Device | null = null;
@@ -103,9 +130,9 @@ class BluetoothService {
       this.isScanning = true;
       console.log('Starting device scan...');
 
-      // Start scanning for devices with BotCareU service
+      // Start scanning for devices advertising a thermometer
       this.manager.startDeviceScan(
-        [BOTCAREU_SERVICE_UUID],
+        [HEALTH_THERMOMETER_SERVICE_UUID],
         { allowDuplicates: false },
         (error, device) => {
           if (error) {
@@ -227,8 +254,8 @@ class BluetoothService {
     try {
       // Subscribe to temperature characteristic notifications
       this.connectedDevice.monitorCharacteristicForService(
-        BOTCAREU_SERVICE_UUID,
-        TEMPERATURE_CHARACTERISTIC_UUID,
+        HEALTH_THERMOMETER_SERVICE_UUID,
+        INTERMEDIATE_TEMPERATURE_CHARACTERISTIC_UUID,
         (error, characteristic) => {
           if (error) {
             console.error('Temperature monitoring error:', error);
@@ -237,16 +264,7 @@ class BluetoothService {
 
           if (characteristic?.value) {
             try {
-              const data = JSON.parse(atob(characteristic.value));
-              const reading: TemperatureReading = {
-                infraredTemp: data.infraredTemp,
-                contactTemp: data.contactTemp,
-                ambientTemp: data.ambientTemp,
-                timestamp: data.timestamp || Date.now(),
-                batteryLevel: data.batteryLevel,
-                signalStrength: data.signalStrength,
-              };
-
+              const reading = parseTemperatureMeasurement(atob(characteristic.value));
               this.notifyListeners('temperatureReading', reading);
             } catch (parseError) {
               console.error('Failed to parse temperature data:', parseError);